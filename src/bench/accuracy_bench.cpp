@@ -0,0 +1,261 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+/**
+ * Accuracy against speed of the engines that skip small binomial weights.
+ * Every engine runs on synthetic inputs over a grid of rows and thresholds, and its output is compared
+ * with the exact result of the same computation, e.g. `convolve_2d_fast` with `convolve_2d`.
+ * Errors are reported for the whole column and for the first and last tenth of the rows, where
+ * the convolved values are smallest.
+ *
+ * Relative errors reach 1 where the exact values are tiny and the skipped weights leave 0, so the
+ * Pareto front uses the error scaled by the largest exact value of the column: a configuration is on
+ * the front if no other configuration of the same rows, input and reference is both faster and more accurate.
+ *
+ * Usage:
+ *   accuracy_bench [--engines all|<name>,...] [--rows 1000,4000,10000] [--inputs smooth,step,peaked]
+ *                  [--threshold 1e-6,1e-9,1e-12,1e-15,-1] [--threads 1] [--warmup 1] [--repeat 3]
+ *                  [--csv <file>] [--json <file>] [--list]
+ *
+ * All benchmarks take [--save-baseline <file>] [--baseline <file>] [--tolerance 5] [--alpha 0.05]
+ * to store results and fail with status 2 on a regression against stored results, see `check_baseline`.
+ */
+#include <cmath>
+#include <cfloat>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+#include "bench_util.h"
+#include "baseline.h"
+#include "../convolution/convolution.h"
+#include "../convolution/sliding_window.h"
+#include "../io/progress.h"
+
+using namespace std;
+
+namespace {
+    using Engine2d = function<vector<vector<double>>(vector<vector<double>>&, int threads, double threshold)>;
+
+    struct Engine{
+        string name;
+        string reference_name;
+        Engine2d run;
+        Engine2d reference;   // exact result of the same computation
+    };
+
+    vector<vector<double>> exact_convolution(vector<vector<double>>& data, int threads, double){
+        return convolve_2d(data, threads);
+    }
+
+    vector<Engine> engines(){
+        return {
+                {"convolve_2d_fast", "convolve_2d", [](vector<vector<double>>& d, int threads, double threshold){
+                    return convolve_2d_fast(d, threads, threshold);
+                }, exact_convolution},
+                {"run_multi_fast", "convolve_2d", [](vector<vector<double>>& d, int threads, double threshold){
+                    return Convolution(threads).run_multi_fast(d, threshold);
+                }, exact_convolution},
+                {"sliding_window", "convolve_2d", [](vector<vector<double>>& d, int, double threshold){
+                    SlidingWindowConvolution window(d.size(), threshold);
+                    vector<vector<double>> out;
+                    for(auto& row : d){
+                        window.push(row);
+                        while (window.ready()) out.push_back(window.pop());
+                    }
+                    while (window.ready()) out.push_back(window.pop());
+                    return out;
+                }, exact_convolution},
+                {"convolve_2d_fast_diff", "convolve_2d_fast_diff(-1)", [](vector<vector<double>>& d, int threads, double threshold){
+                    return convolve_2d_fast_diff(d, threads, 1, threshold);
+                }, [](vector<vector<double>>& d, int threads, double){
+                    return convolve_2d_fast_diff(d, threads, 1, -1);
+                }},
+        };
+    }
+
+    /**
+     * One column of `n_rows` values of x in [0, 1]:
+     *   smooth : sin(2 pi x) + x^2
+     *   step   : 0 below x = 1/2 and 1 above
+     *   peaked : narrow gaussian at x = 1/2, a hundredth wide
+     */
+    vector<vector<double>> synthetic_input(const string& input, size_t n_rows){
+        vector<vector<double>> data(n_rows, vector<double>(1));
+        for(size_t r{}; r < n_rows; ++r){
+            double x = n_rows > 1 ? double(r) / double(n_rows - 1) : 0.0;
+            double& value = data[r][0];
+            if(input == "smooth")      value = sin(2 * M_PI * x) + x * x;
+            else if(input == "step")   value = x < 0.5 ? 0.0 : 1.0;
+            else if(input == "peaked") value = exp(-pow((x - 0.5) / 0.01, 2));
+            else throw std::invalid_argument("unknown input " + input + ". use smooth, step or peaked");
+        }
+        return data;
+    }
+
+    struct Errors{
+        double max_relative{};
+        double rms_relative{};
+        double max_scaled{};   // absolute error over the largest exact value of the column
+    };
+
+    /**
+     * Errors of the rows from `first` to `last` of the first column
+     */
+    Errors errors(const vector<vector<double>>& values, const vector<vector<double>>& exact,
+                  size_t first, size_t last){
+        double scale{};
+        for(auto& row : exact) scale = max(scale, fabs(row[0]));
+        Errors e;
+        double total{};
+        for(size_t r{first}; r < last; ++r){
+            double difference = fabs(values[r][0] - exact[r][0]);
+            double relative = difference == 0 ? 0.0 : difference / max(fabs(exact[r][0]), DBL_MIN);
+            e.max_relative = max(e.max_relative, relative);
+            e.max_scaled = max(e.max_scaled, scale > 0 ? difference / scale : difference);
+            total += relative * relative;
+        }
+        if(last > first) e.rms_relative = sqrt(total / double(last - first));
+        return e;
+    }
+
+    vector<Engine> select_engines(const vector<string>& names){
+        auto all = engines();
+        if(names.size() == 1 && names[0] == "all") return all;
+        vector<Engine> selected;
+        for(auto& name : names){
+            auto found = find_if(all.begin(), all.end(), [&](const Engine& e){ return e.name == name;});
+            if(found == all.end()) throw std::invalid_argument("unknown engine " + name + ". see --list");
+            selected.push_back(*found);
+        }
+        return selected;
+    }
+
+    double metric(const BenchResult& r, const string& key){
+        for(auto& m : r.metrics) if(m.first == key) return m.second;
+        return NAN;
+    }
+
+    string parameter(const BenchResult& r, const string& key){
+        for(auto& p : r.parameters) if(p.first == key) return p.second;
+        return "";
+    }
+
+    /**
+     * Mark the whole column results that no other result of the same rows, input and reference beats
+     * in both time and maximum scaled error
+     */
+    void mark_pareto(vector<BenchResult>& results){
+        for(auto& r : results){
+            bool whole = parameter(r, "region") == "all";
+            bool dominated = false;
+            for(auto& other : results){
+                if(!whole || &other == &r || parameter(other, "region") != "all") continue;
+                bool same = parameter(other, "rows") == parameter(r, "rows") && parameter(other, "input") == parameter(r, "input")
+                            && parameter(other, "reference") == parameter(r, "reference");
+                if(!same) continue;
+                double t = r.seconds.median, t_other = other.seconds.median;
+                double e = metric(r, "max_scaled_error"), e_other = metric(other, "max_scaled_error");
+                if(t_other <= t && e_other <= e && (t_other < t || e_other < e)){
+                    dominated = true;
+                    break;
+                }
+            }
+            r.metric("pareto", whole && !dominated ? 1 : 0);
+        }
+    }
+}
+
+int main(int argc, char** argv){
+    try {
+        BenchArgs args(argc, argv);
+        if(args.has("list") || args.has("help")){
+            for(auto& e : engines()) cout << e.name << " against " << e.reference_name << endl;
+            return 0;
+        }
+        auto selected = select_engines(args.get_strings("engines", "all"));
+        auto rows_list = args.get_longs("rows", "1000,4000,10000");
+        auto inputs = args.get_strings("inputs", "smooth,step,peaked");
+        auto thresholds = args.get_doubles("threshold", "1e-6,1e-9,1e-12,1e-15,-1");
+        int threads = args.get_int("threads", 1);
+        int warmup = args.get_int("warmup", 1);
+        int repeat = args.get_int("repeat", 3);
+
+        set_progress_reporting(false);
+        vector<BenchResult> results;
+        for(long n_rows : rows_list){
+            for(auto& input : inputs){
+                auto data = synthetic_input(input, size_t(n_rows));
+                size_t edge = max<size_t>(1, size_t(n_rows) / 10);
+                const vector<pair<string, pair<size_t, size_t>>> regions = {
+                        {"all", {0, size_t(n_rows)}},
+                        {"first_tenth", {0, edge}},
+                        {"middle", {edge, size_t(n_rows) - edge}},
+                        {"last_tenth", {size_t(n_rows) - edge, size_t(n_rows)}},
+                };
+                // exact results, computed once per reference
+                vector<pair<string, vector<vector<double>>>> exact;
+                vector<pair<string, Summary>> exact_seconds;
+                for(auto& engine : selected){
+                    auto found = find_if(exact.begin(), exact.end(), [&](const pair<string, vector<vector<double>>>& x){
+                        return x.first == engine.reference_name;
+                    });
+                    if(found != exact.end()) continue;
+                    cerr << engine.reference_name << " rows=" << n_rows << " input=" << input << endl;
+                    vector<vector<double>> out;
+                    auto seconds = time_repeated(warmup, repeat, [&](){ out = engine.reference(data, threads, -1);});
+                    exact.emplace_back(engine.reference_name, out);
+                    exact_seconds.emplace_back(engine.reference_name, summarize(seconds));
+                }
+                for(auto& engine : selected){
+                    size_t k = size_t(find_if(exact.begin(), exact.end(), [&](const pair<string, vector<vector<double>>>& x){
+                        return x.first == engine.reference_name;
+                    }) - exact.begin());
+                    for(double threshold : thresholds){
+                        cerr << engine.name << " rows=" << n_rows << " input=" << input
+                             << " threshold=" << threshold << endl;
+                        vector<vector<double>> out;
+                        auto samples = time_repeated(warmup, repeat, [&](){
+                            out = engine.run(data, threads, threshold);
+                        });
+                        auto seconds = summarize(samples);
+                        if(out.size() != data.size()) throw std::runtime_error(engine.name + " gave a wrong number of rows");
+                        for(auto& region : regions){
+                            auto e = errors(out, exact[k].second, region.second.first, region.second.second);
+                            BenchResult r;
+                            r.name = engine.name;
+                            r.parameter("rows", double(n_rows));
+                            r.parameter("input", input);
+                            r.parameter("threshold", threshold);
+                            r.parameter("region", region.first);
+                            r.parameter("reference", engine.reference_name);
+                            r.timings(samples);
+                            r.metric("max_rel_error", e.max_relative);
+                            r.metric("rms_rel_error", e.rms_relative);
+                            r.metric("max_scaled_error", e.max_scaled);
+                            r.metric("speedup", exact_seconds[k].second.median / max(seconds.median, 1e-300));
+                            results.push_back(r);
+                        }
+                    }
+                }
+            }
+        }
+        mark_pareto(results);
+        print_table(cout, results);
+
+        vector<BenchResult> front;
+        copy_if(results.begin(), results.end(), back_inserter(front), [](const BenchResult& r){
+            return metric(r, "pareto") > 0;
+        });
+        cout << endl << "Pareto front (time against maximum scaled error over all rows)" << endl;
+        print_table(cout, front);
+        save_results(results, args.get("csv", ""), args.get("json", ""));
+        return check_baseline(args, results);
+    } catch (std::exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,263 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#include "baseline.h"
+
+#include <omp.h>
+#include <sys/utsname.h>
+#include <cmath>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+    string cpu_model(){
+        ifstream fin("/proc/cpuinfo");
+        string line;
+        while (getline(fin, line)){
+            if(line.compare(0, 10, "model name") != 0) continue;
+            auto colon = line.find(':');
+            if(colon != string::npos) return line.substr(line.find_first_not_of(' ', colon + 1));
+        }
+        return "unknown";
+    }
+
+    double median_of(vector<double> values){
+        sort(values.begin(), values.end());
+        return percentile(values, 0.5);
+    }
+
+    /**
+     * Number of arrangements of n values of one sample and m of the other for every value of U,
+     * the number of pairs in which the first sample is larger
+     */
+    vector<double> u_distribution(size_t n, size_t m){
+        // counts[j] for the current n and j values of the other sample
+        vector<vector<double>> counts(m + 1);
+        for(size_t j{}; j <= m; ++j) counts[j].assign(1, 1.0);  // n = 0: U = 0 only
+        for(size_t i{1}; i <= n; ++i){
+            vector<vector<double>> next(m + 1);
+            next[0].assign(1, 1.0);
+            for(size_t j{1}; j <= m; ++j){
+                // the largest value is either from the first sample (beats all j) or from the second
+                next[j].assign(i * j + 1, 0.0);
+                for(size_t u{}; u < counts[j].size(); ++u) next[j][u + j] += counts[j][u];
+                for(size_t u{}; u < next[j-1].size(); ++u) next[j][u] += next[j-1][u];
+            }
+            counts.swap(next);
+        }
+        return counts[m];
+    }
+}
+
+/**
+ * Machine, compiler and build that produced the results
+ */
+std::map<std::string, std::string> machine_fingerprint(){
+    map<string, string> fingerprint;
+    fingerprint["cpu"] = cpu_model();
+    fingerprint["cpus"] = to_string(thread::hardware_concurrency());
+    fingerprint["omp_threads"] = to_string(omp_get_max_threads());
+#if defined(__clang__)
+    fingerprint["compiler"] = string("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+    fingerprint["compiler"] = string("gcc ") + __VERSION__;
+#else
+    fingerprint["compiler"] = "unknown";
+#endif
+#ifdef BENCH_CXX_FLAGS
+    fingerprint["flags"] = BENCH_CXX_FLAGS;
+#endif
+    utsname name{};
+    if(uname(&name) == 0){
+        fingerprint["os"] = string(name.sysname) + " " + name.release + " " + name.machine;
+    }
+    return fingerprint;
+}
+
+/**
+ * Name and parameters of a result, which identify it in a baseline
+ */
+std::string result_key(const BenchResult& result){
+    string key = result.name;
+    for(auto& p : result.parameters) key += " " + p.first + "=" + p.second;
+    return key;
+}
+
+/**
+ * One-sided Mann-Whitney U test
+ * @return : p-value of the values of `a` tending to be larger than the ones of `b`.
+ *           exact for up to 50 values per sample, normal approximation above
+ */
+double mann_whitney_p_value(const std::vector<double>& a, const std::vector<double>& b){
+    if(a.empty() || b.empty()) return 1;
+    double u{};
+    for(double x : a){
+        for(double y : b){
+            if(x > y) u += 1;
+            else if(x == y) u += 0.5;
+        }
+    }
+    size_t n = a.size(), m = b.size();
+    if(n <= 50 && m <= 50){
+        auto counts = u_distribution(n, m);
+        double total{}, above{};
+        for(size_t k{}; k < counts.size(); ++k){
+            total += counts[k];
+            if(double(k) >= u - 1e-9) above += counts[k];
+        }
+        return above / total;
+    }
+    double mean = double(n * m) / 2;
+    double sd = sqrt(double(n * m) * double(n + m + 1) / 12);
+    double z = (u - 0.5 - mean) / sd;
+    return 0.5 * erfc(z / sqrt(2.0));
+}
+
+Baseline Baseline::load(const std::string &filename) {
+    ifstream fin(filename);
+    if(!fin) throw std::runtime_error("Could not find/open file " + filename);
+    Baseline baseline;
+    string line;
+    while (getline(fin, line)){
+        if(line.empty() || line[0] == '#') continue;
+        auto first_tab = line.find('\t');
+        auto second_tab = line.find('\t', first_tab + 1);
+        if(first_tab == string::npos || second_tab == string::npos){
+            throw std::runtime_error("Bad line in baseline " + filename + ": " + line);
+        }
+        string kind = line.substr(0, first_tab);
+        string key = line.substr(first_tab + 1, second_tab - first_tab - 1);
+        string value = line.substr(second_tab + 1);
+        if(kind == "fingerprint"){
+            baseline._fingerprint[key] = value;
+        }else if(kind == "result"){
+            istringstream iss(value);
+            vector<double> samples;
+            double s;
+            while (iss >> s) samples.push_back(s);
+            baseline._samples[key] = samples;
+        }
+    }
+    return baseline;
+}
+
+void Baseline::save(const std::string &filename) const {
+    ofstream fout(filename);
+    if(!fout) throw std::runtime_error("Could not create file " + filename);
+    fout << "# benchmark baseline: fingerprint of the machine and seconds of every measured run" << '\n';
+    for(auto& f : _fingerprint) fout << "fingerprint\t" << f.first << '\t' << f.second << '\n';
+    fout << setprecision(10);
+    for(auto& s : _samples){
+        fout << "result\t" << s.first << '\t';
+        for(size_t i{}; i < s.second.size(); ++i) fout << (i == 0 ? "" : " ") << s.second[i];
+        fout << '\n';
+    }
+    fout.close();
+    if(!fout) throw std::runtime_error("Could not write to " + filename);
+}
+
+/**
+ * Take the results of this machine. Results with the same key are replaced
+ */
+void Baseline::add(const std::vector<BenchResult> &results) {
+    _fingerprint = machine_fingerprint();
+    for(auto& r : results) _samples[result_key(r)] = r.samples;
+}
+
+const std::vector<double>* Baseline::samples(const std::string &key) const {
+    auto found = _samples.find(key);
+    return found == _samples.end() ? nullptr : &found->second;
+}
+
+/**
+ * @param tolerance : percent of slowdown of the median that is accepted
+ * @param alpha     : significance level of the Mann-Whitney U test
+ */
+std::vector<Comparison> compare(const Baseline& baseline, const std::vector<BenchResult>& results,
+                                double tolerance, double alpha){
+    vector<Comparison> comparisons;
+    for(auto& r : results){
+        Comparison c;
+        c.key = result_key(r);
+        c.median = median_of(r.samples);
+        auto old = baseline.samples(c.key);
+        if(old == nullptr || old->empty()){
+            c.status = "new";
+            comparisons.push_back(c);
+            continue;
+        }
+        c.baseline_median = median_of(*old);
+        c.change = c.baseline_median > 0 ? (c.median / c.baseline_median - 1) * 100 : 0;
+        c.p_slower = mann_whitney_p_value(r.samples, *old);
+        c.p_faster = mann_whitney_p_value(*old, r.samples);
+        if(c.change > tolerance && c.p_slower <= alpha) c.status = "regression";
+        else if(c.change < -tolerance && c.p_faster <= alpha) c.status = "faster";
+        else c.status = "ok";
+        comparisons.push_back(c);
+    }
+    return comparisons;
+}
+
+/**
+ * Baseline options common to the benchmark programs:
+ *   --save-baseline <file> : add the results to a baseline file, replacing results with the same key
+ *   --baseline <file>      : compare the results with a baseline file
+ *   --tolerance <percent>  : slowdown of the median that is accepted. default 5
+ *   --alpha <p>            : significance level of the test. default 0.05
+ * @return : exit status of the program. 2 if a result regressed
+ */
+int check_baseline(const BenchArgs& args, const std::vector<BenchResult>& results){
+    int status{0};
+    if(args.has("baseline")){
+        double tolerance = args.get_doubles("tolerance", "5").front();
+        double alpha = args.get_doubles("alpha", "0.05").front();
+        auto baseline = Baseline::load(args.get("baseline", ""));
+        auto current = machine_fingerprint();
+        for(auto& f : baseline.fingerprint()){
+            auto found = current.find(f.first);
+            if(found != current.end() && found->second != f.second){
+                cerr << "warning: baseline " << f.first << " is \"" << f.second << "\", this run \""
+                     << found->second << "\"" << endl;
+            }
+        }
+        auto comparisons = compare(baseline, results, tolerance, alpha);
+        size_t width = 3;
+        for(auto& c : comparisons) width = max(width, c.key.size());
+        cout << endl << "Against baseline " << args.get("baseline", "") << " (tolerance " << tolerance
+             << "%, alpha " << alpha << ")" << endl;
+        cout << left << setw(int(width + 2)) << "key" << setw(14) << "baseline [s]" << setw(14) << "median [s]"
+             << setw(10) << "change" << setw(12) << "p-value" << "status" << right << endl;
+        size_t regressions{};
+        for(auto& c : comparisons){
+            ostringstream change, p;
+            if(c.status != "new"){
+                change << fixed << setprecision(1) << showpos << c.change << "%";
+                p << setprecision(3) << (c.change >= 0 ? c.p_slower : c.p_faster);
+            }
+            cout << left << setw(int(width + 2)) << c.key << setw(14) << (c.status == "new" ? "-" : format_number(c.baseline_median))
+                 << setw(14) << format_number(c.median) << setw(10) << change.str() << setw(12) << p.str()
+                 << c.status << right << endl;
+            if(c.status == "regression") ++regressions;
+        }
+        if(regressions > 0){
+            cerr << regressions << " result(s) regressed by more than " << tolerance << "%" << endl;
+            status = 2;
+        }
+    }
+    if(args.has("save-baseline")){
+        string filename = args.get("save-baseline", "");
+        Baseline baseline;
+        if(ifstream(filename)) baseline = Baseline::load(filename);
+        baseline.add(results);
+        baseline.save(filename);
+    }
+    return status;
+}
@@ -0,0 +1,59 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#ifndef CONVOLUTION_BASELINE_H
+#define CONVOLUTION_BASELINE_H
+
+/**
+ * Stored benchmark results to compare later runs against.
+ * A baseline file keeps the measured times of every result together with a fingerprint of the
+ * machine and the compiler, one line each, so that it can be diffed and merged by hand:
+ *      fingerprint <tab> cpu <tab> ...
+ *      result <tab> run_multi_fast rows=10000 columns=4 threshold=1e-15 threads=8 <tab> 0.0121 0.0119 0.0123
+ * A result is a regression if its median is slower by more than the tolerance and a one-sided
+ * Mann-Whitney U test finds it slower at the significance level, so that noise alone does not flag it.
+ */
+#include <map>
+#include <string>
+#include <vector>
+
+#include "bench_util.h"
+
+std::map<std::string, std::string> machine_fingerprint();
+std::string result_key(const BenchResult& result);
+double mann_whitney_p_value(const std::vector<double>& a, const std::vector<double>& b);
+
+class Baseline{
+    std::map<std::string, std::string> _fingerprint;
+    std::map<std::string, std::vector<double>> _samples;
+public:
+    ~Baseline() = default;
+    Baseline() = default;
+
+    static Baseline load(const std::string& filename);
+    void save(const std::string& filename) const;
+    void add(const std::vector<BenchResult>& results);
+
+    const std::map<std::string, std::string>& fingerprint() const { return _fingerprint;}
+    const std::vector<double>* samples(const std::string& key) const;
+};
+
+/**
+ * One result against the baseline
+ */
+struct Comparison{
+    std::string key;
+    double baseline_median{};
+    double median{};
+    double change{};           // percent. positive is slower
+    double p_slower{1};        // p-value of the new run being slower
+    double p_faster{1};
+    std::string status;        // "ok", "regression", "faster" or "new"
+};
+
+std::vector<Comparison> compare(const Baseline& baseline, const std::vector<BenchResult>& results,
+                                double tolerance, double alpha);
+int check_baseline(const BenchArgs& args, const std::vector<BenchResult>& results);
+
+#endif //CONVOLUTION_BASELINE_H
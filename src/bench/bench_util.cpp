@@ -0,0 +1,278 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#include "bench_util.h"
+
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * Value below which a fraction `p` of the values lie, interpolated between neighbours
+ * @param sorted : values in increasing order
+ * @param p      : fraction between 0 and 1
+ */
+double percentile(const std::vector<double>& sorted, double p){
+    if(sorted.empty()) return 0;
+    double position = p * double(sorted.size() - 1);
+    size_t below = size_t(floor(position));
+    size_t above = min(sorted.size() - 1, below + 1);
+    double weight = position - double(below);
+    return sorted[below] * (1 - weight) + sorted[above] * weight;
+}
+
+Summary summarize(std::vector<double> values){
+    Summary s;
+    s.count = values.size();
+    if(values.empty()) return s;
+    sort(values.begin(), values.end());
+    s.min = values.front();
+    s.max = values.back();
+    s.p10 = percentile(values, 0.1);
+    s.median = percentile(values, 0.5);
+    s.p90 = percentile(values, 0.9);
+    double total{};
+    for(double v : values) total += v;
+    s.mean = total / double(values.size());
+    return s;
+}
+
+/**
+ * Wall time of `repeat` runs after `warmup` runs that are not measured
+ * @param prepare : called before every run and not measured, e.g. to drop a file from the page cache
+ * @return : seconds of every measured run
+ */
+std::vector<double> time_repeated(int warmup, int repeat, const std::function<void()>& run,
+                                  const std::function<void()>& prepare){
+    for(int i{}; i < warmup; ++i){
+        if(prepare) prepare();
+        run();
+    }
+    vector<double> seconds;
+    for(int i{}; i < repeat; ++i){
+        if(prepare) prepare();
+        auto t0 = chrono::steady_clock::now();
+        run();
+        seconds.push_back(chrono::duration<double>(chrono::steady_clock::now() - t0).count());
+    }
+    return seconds;
+}
+
+std::string format_number(double value){
+    ostringstream out;
+    out << setprecision(10) << value;
+    return out.str();
+}
+
+void BenchResult::parameter(const std::string &key, double value) {
+    parameters.emplace_back(key, format_number(value));
+}
+
+namespace {
+    const vector<pair<string, double Summary::*>> SUMMARY_FIELDS = {
+            {"min", &Summary::min}, {"p10", &Summary::p10}, {"median", &Summary::median},
+            {"p90", &Summary::p90}, {"max", &Summary::max}, {"mean", &Summary::mean}
+    };
+
+    string csv_field(const string& text){
+        if(text.find_first_of(",\"\n") == string::npos) return text;
+        string quoted = "\"";
+        for(char c : text){
+            if(c == '"') quoted += '"';
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+
+    string json_string(const string& text){
+        string out = "\"";
+        for(char c : text){
+            if(c == '"' || c == '\\') out += '\\';
+            out += c;
+        }
+        return out + "\"";
+    }
+
+    string json_number(double value){
+        if(!std::isfinite(value)) return "null";
+        return format_number(value);
+    }
+}
+
+/**
+ * One line per result. Columns are taken from the first result
+ */
+void write_csv(std::ostream& out, const std::vector<BenchResult>& results){
+    if(results.empty()) return;
+    const auto& first = results.front();
+    out << "name";
+    for(auto& p : first.parameters) out << ',' << csv_field(p.first);
+    out << ",repeat";
+    for(auto& f : SUMMARY_FIELDS) out << ",seconds_" << f.first;
+    for(auto& m : first.metrics) out << ',' << csv_field(m.first);
+    out << '\n';
+    for(auto& r : results){
+        out << csv_field(r.name);
+        for(auto& p : r.parameters) out << ',' << csv_field(p.second);
+        out << ',' << r.seconds.count;
+        for(auto& f : SUMMARY_FIELDS) out << ',' << format_number(r.seconds.*(f.second));
+        for(auto& m : r.metrics) out << ',' << format_number(m.second);
+        out << '\n';
+    }
+}
+
+void write_json(std::ostream& out, const std::vector<BenchResult>& results){
+    out << "[";
+    for(size_t i{}; i < results.size(); ++i){
+        auto& r = results[i];
+        out << (i == 0 ? "\n" : ",\n") << "  {\"name\": " << json_string(r.name);
+        for(auto& p : r.parameters) out << ", " << json_string(p.first) << ": " << json_string(p.second);
+        out << ", \"repeat\": " << r.seconds.count << ", \"seconds\": {";
+        for(size_t k{}; k < SUMMARY_FIELDS.size(); ++k){
+            out << (k == 0 ? "" : ", ") << json_string(SUMMARY_FIELDS[k].first) << ": "
+                << json_number(r.seconds.*(SUMMARY_FIELDS[k].second));
+        }
+        out << "}";
+        for(auto& m : r.metrics) out << ", " << json_string(m.first) << ": " << json_number(m.second);
+        out << "}";
+    }
+    out << (results.empty() ? "]\n" : "\n]\n");
+}
+
+/**
+ * Aligned columns for the terminal: parameters, median and spread of the time and the metrics
+ */
+void print_table(std::ostream& out, const std::vector<BenchResult>& results){
+    if(results.empty()) return;
+    vector<string> header{"name"};
+    for(auto& p : results.front().parameters) header.push_back(p.first);
+    header.insert(header.end(), {"median [s]", "p10 [s]", "p90 [s]"});
+    for(auto& m : results.front().metrics) header.push_back(m.first);
+    vector<vector<string>> rows;
+    for(auto& r : results){
+        vector<string> row{r.name};
+        for(auto& p : r.parameters) row.push_back(p.second);
+        for(double v : {r.seconds.median, r.seconds.p10, r.seconds.p90}){
+            ostringstream s;
+            s << setprecision(4) << v;
+            row.push_back(s.str());
+        }
+        for(auto& m : r.metrics){
+            ostringstream s;
+            s << setprecision(4) << m.second;
+            row.push_back(s.str());
+        }
+        rows.push_back(row);
+    }
+    vector<size_t> width(header.size());
+    for(size_t c{}; c < header.size(); ++c){
+        width[c] = header[c].size();
+        for(auto& row : rows) if(c < row.size()) width[c] = max(width[c], row[c].size());
+    }
+    auto print_row = [&](const vector<string>& row){
+        for(size_t c{}; c < row.size(); ++c) out << left << setw(int(width[c] + 2)) << row[c];
+        out << right << '\n';
+    };
+    print_row(header);
+    for(auto& row : rows) print_row(row);
+    out << flush;
+}
+
+/**
+ * Write the results to the files that are named. Empty names are skipped
+ */
+void save_results(const std::vector<BenchResult>& results, const std::string& csv_filename,
+                  const std::string& json_filename){
+    if(!csv_filename.empty()){
+        ofstream fout(csv_filename);
+        if(!fout) throw std::runtime_error("Could not create file " + csv_filename);
+        write_csv(fout, results);
+    }
+    if(!json_filename.empty()){
+        ofstream fout(json_filename);
+        if(!fout) throw std::runtime_error("Could not create file " + json_filename);
+        write_json(fout, results);
+    }
+}
+
+BenchArgs::BenchArgs(int argc, char **argv) {
+    for(int i{1}; i < argc; ++i){
+        string key = argv[i];
+        if(key.compare(0, 2, "--") != 0) throw std::invalid_argument("unexpected argument " + key);
+        key = key.substr(2);
+        if(i + 1 < argc && string(argv[i+1]).compare(0, 2, "--") != 0){
+            _values[key] = argv[++i];
+        }else{
+            _values[key] = "";
+        }
+    }
+}
+
+std::string BenchArgs::get(const std::string &key, const std::string &default_value) const {
+    auto found = _values.find(key);
+    return found == _values.end() ? default_value : found->second;
+}
+
+int BenchArgs::get_int(const std::string &key, int default_value) const {
+    return has(key) ? stoi(get(key, "")) : default_value;
+}
+
+std::vector<std::string> BenchArgs::get_strings(const std::string &key, const std::string &default_value) const {
+    vector<string> values;
+    stringstream ss(get(key, default_value));
+    string item;
+    while (getline(ss, item, ',')){
+        if(!item.empty()) values.push_back(item);
+    }
+    return values;
+}
+
+std::vector<long> BenchArgs::get_longs(const std::string &key, const std::string &default_value) const {
+    vector<long> values;
+    for(auto& s : get_strings(key, default_value)) values.push_back(long(stod(s)));
+    return values;
+}
+
+std::vector<double> BenchArgs::get_doubles(const std::string &key, const std::string &default_value) const {
+    vector<double> values;
+    for(auto& s : get_strings(key, default_value)) values.push_back(stod(s));
+    return values;
+}
+
+/**
+ * Uniform random values in [0, 1). Same values for the same seed
+ */
+std::vector<std::vector<double>> random_matrix(size_t n_rows, size_t n_columns, unsigned seed){
+    mt19937_64 generator(seed);
+    uniform_real_distribution<double> uniform(0, 1);
+    vector<vector<double>> data(n_rows, vector<double>(n_columns));
+    for(auto& row : data) for(auto& v : row) v = uniform(generator);
+    return data;
+}
+
+/**
+ * Delimiter from "tab", "space", "comma" or the character itself
+ */
+char delimiter_from_name(const std::string& name){
+    if(name == "tab") return '\t';
+    if(name == "space") return ' ';
+    if(name == "comma") return ',';
+    if(name.size() == 1) return name[0];
+    throw std::invalid_argument("unknown delimiter " + name + ". use tab, space, comma or a character");
+}
+
+std::string delimiter_name(char delimiter){
+    if(delimiter == '\t') return "tab";
+    if(delimiter == ' ') return "space";
+    if(delimiter == ',') return "comma";
+    return string(1, delimiter);
+}
@@ -0,0 +1,83 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#ifndef CONVOLUTION_BENCH_UTIL_H
+#define CONVOLUTION_BENCH_UTIL_H
+
+/**
+ * Common parts of the benchmark programs: timing with warm-up runs and repetitions,
+ * summary statistics, command line lists and CSV / JSON output of the results.
+ */
+#include <map>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <ostream>
+#include <functional>
+
+/**
+ * Order statistics of repeated measurements
+ */
+struct Summary{
+    size_t count{};
+    double min{};
+    double p10{};
+    double median{};
+    double p90{};
+    double max{};
+    double mean{};
+};
+
+Summary summarize(std::vector<double> values);
+double percentile(const std::vector<double>& sorted, double p);
+
+std::vector<double> time_repeated(int warmup, int repeat, const std::function<void()>& run,
+                                  const std::function<void()>& prepare=nullptr);
+
+/**
+ * One measured configuration. `parameters` and `metrics` become columns of the CSV and keys of the JSON,
+ * in the order they are added
+ */
+struct BenchResult{
+    std::string name;
+    std::vector<std::pair<std::string, std::string>> parameters;
+    Summary seconds;
+    std::vector<double> samples;  // seconds of every measured run
+    std::vector<std::pair<std::string, double>> metrics;
+
+    void timings(const std::vector<double>& measured) { samples = measured; seconds = summarize(measured);}
+
+    void parameter(const std::string& key, const std::string& value) { parameters.emplace_back(key, value);}
+    void parameter(const std::string& key, double value);
+    void metric(const std::string& key, double value) { metrics.emplace_back(key, value);}
+};
+
+void write_csv(std::ostream& out, const std::vector<BenchResult>& results);
+void write_json(std::ostream& out, const std::vector<BenchResult>& results);
+void print_table(std::ostream& out, const std::vector<BenchResult>& results);
+void save_results(const std::vector<BenchResult>& results, const std::string& csv_filename,
+                  const std::string& json_filename);
+
+/**
+ * Options of the form `--key value` and `--flag`
+ */
+class BenchArgs{
+    std::map<std::string, std::string> _values;
+public:
+    BenchArgs(int argc, char** argv);
+
+    bool has(const std::string& key) const { return _values.count(key) > 0;}
+    std::string get(const std::string& key, const std::string& default_value) const;
+    int get_int(const std::string& key, int default_value) const;
+    std::vector<long> get_longs(const std::string& key, const std::string& default_value) const;
+    std::vector<double> get_doubles(const std::string& key, const std::string& default_value) const;
+    std::vector<std::string> get_strings(const std::string& key, const std::string& default_value) const;
+};
+
+std::vector<std::vector<double>> random_matrix(size_t n_rows, size_t n_columns, unsigned seed=1);
+std::string format_number(double value);
+char delimiter_from_name(const std::string& name);
+std::string delimiter_name(char delimiter);
+
+#endif //CONVOLUTION_BENCH_UTIL_H
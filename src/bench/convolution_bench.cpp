@@ -0,0 +1,328 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+/**
+ * Micro-benchmark of the convolution kernels on random data.
+ * Sweeps the number of rows, the number of columns, the threshold and the number of threads,
+ * runs every kernel a few times after warm-up runs and reports median and percentiles.
+ *
+ * Usage:
+ *   convolution_bench [--kernels all|<name>,...] [--rows 1000,10000,100000] [--columns 1,4]
+ *                     [--threshold 1e-15,1e-9] [--threads 1,<max>] [--warmup 1] [--repeat 5]
+ *                     [--max-full-rows 10000] [--csv <file>] [--json <file>] [--list]
+ *
+ * All benchmarks take [--save-baseline <file>] [--baseline <file>] [--tolerance 5] [--alpha 0.05]
+ * to store results and fail with status 2 on a regression against stored results, see `check_baseline`.
+ *
+ * Kernels of the full convolution cost N^2 and are skipped for more than `--max-full-rows` rows.
+ *
+ * With `--mode scaling` the parallel kernels run on a growing number of threads instead:
+ *   convolution_bench --mode scaling [--scaling strong,weak] [--kernels <name>,...] [--rows 20000]
+ *                     [--columns 4] [--threshold 1e-15] [--threads 1,2,4,...,<max>] [--pin none|compact|spread]
+ * Strong scaling keeps the rows, weak scaling grows them so that the work per thread stays the same.
+ * The number of OpenMP threads is raised to each number of threads, also beyond OMP_NUM_THREADS.
+ * Speed-up, parallel efficiency and the imbalance of the time the threads spent on rows in the last
+ * run are reported. With --pin the OpenMP threads and the threads of the task pool, on which the
+ * pthread kernels run as well, are pinned. The main thread is not pinned.
+ */
+#include <omp.h>
+#include <cmath>
+#include <iostream>
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+
+#include "bench_util.h"
+#include "baseline.h"
+#include "../convolution/convolution.h"
+#include "../convolution/sliding_window.h"
+#include "../parallel/parallel.h"
+#include "../parallel/numa.h"
+#include "../io/progress.h"
+#include "../io/trace.h"
+
+using namespace std;
+
+namespace {
+    /**
+     * Input of a kernel. `columns` holds the 2D data, `column` its first column for 1D kernels
+     */
+    struct BenchData{
+        vector<vector<double>> columns;
+        vector<double> column;
+    };
+
+    PinMode pin_mode = PinMode::none;  // pinning of the threads in scaling mode
+
+    struct Kernel{
+        string name;
+        bool two_d;           // takes rows of several columns
+        bool uses_threshold;  // full convolution otherwise
+        bool serial;          // ignores the number of threads
+        function<void(BenchData&, int threads, double threshold)> run;
+    };
+
+    vector<Kernel> kernels(){
+        return {
+                {"run", false, false, true, [](BenchData& d, int, double){
+                    Convolution(1).run(d.column);
+                }},
+                {"run_omp", false, false, false, [](BenchData& d, int threads, double){
+                    // runs on the default number of OpenMP threads
+                    int previous = omp_get_max_threads();
+                    omp_set_num_threads(threads);
+                    Convolution(threads).run_omp(d.column);
+                    omp_set_num_threads(previous);
+                }},
+                {"run_pthread", false, false, false, [](BenchData& d, int threads, double){
+                    Convolution(threads).run_pthread(d.column);
+                }},
+                {"convolve_1d", false, false, false, [](BenchData& d, int threads, double){
+                    convolve_1d(d.column, threads);
+                }},
+                {"convolve_1d_fast", false, true, false, [](BenchData& d, int threads, double threshold){
+                    convolve_1d_fast(d.column, threads, threshold);
+                }},
+                {"convolve_1d_fast_diff", false, true, false, [](BenchData& d, int threads, double threshold){
+                    convolve_1d_fast_diff(d.column, threads, 1, threshold);
+                }},
+                {"run_multi", true, false, true, [](BenchData& d, int, double){
+                    Convolution(1).run_multi(d.columns);
+                }},
+                {"run_multi_omp", true, false, false, [](BenchData& d, int threads, double){
+                    Convolution(threads).run_multi_omp(d.columns);
+                }},
+                {"run_multi_omp_v2", true, false, false, [](BenchData& d, int threads, double){
+                    Convolution(threads).run_multi_omp_v2(d.columns);
+                }},
+                {"run_multi_pthread", true, false, false, [](BenchData& d, int threads, double){
+                    Convolution(threads).run_multi_pthread(d.columns);
+                }},
+                {"run_multi_fast", true, true, false, [](BenchData& d, int threads, double threshold){
+                    Convolution(threads).run_multi_fast(d.columns, threshold);
+                }},
+                {"run_multi_fast_tasks", true, true, false, [](BenchData& d, int threads, double threshold){
+                    set_parallel_backend(ParallelBackend::tasks, threads, pin_order(pin_mode, size_t(threads)));
+                    Convolution(threads).run_multi_fast(d.columns, threshold);
+                    set_parallel_backend(ParallelBackend::openmp, threads, pin_order(pin_mode, size_t(threads)));
+                }},
+                {"convolve_2d", true, false, false, [](BenchData& d, int threads, double){
+                    convolve_2d(d.columns, threads);
+                }},
+                {"convolve_2d_fast", true, true, false, [](BenchData& d, int threads, double threshold){
+                    convolve_2d_fast(d.columns, threads, threshold);
+                }},
+                {"convolve_2d_fast_diff", true, true, false, [](BenchData& d, int threads, double threshold){
+                    convolve_2d_fast_diff(d.columns, threads, 1, threshold);
+                }},
+                {"sliding_window", true, true, true, [](BenchData& d, int, double threshold){
+                    SlidingWindowConvolution window(d.columns.size(), threshold);
+                    for(auto& row : d.columns){
+                        window.push(row);
+                        while (window.ready()) window.pop();
+                    }
+                    while (window.ready()) window.pop();
+                }},
+        };
+    }
+
+    vector<Kernel> select_kernels(const vector<string>& names){
+        auto all = kernels();
+        if(names.size() == 1 && names[0] == "all") return all;
+        vector<Kernel> selected;
+        for(auto& name : names){
+            auto found = find_if(all.begin(), all.end(), [&](const Kernel& k){ return k.name == name;});
+            if(found == all.end()) throw std::invalid_argument("unknown kernel " + name + ". see --list");
+            selected.push_back(*found);
+        }
+        return selected;
+    }
+
+    vector<long> sorted_threads(const BenchArgs& args, const string& default_value){
+        auto threads_list = args.get_longs("threads", default_value);
+        sort(threads_list.begin(), threads_list.end());
+        threads_list.erase(unique(threads_list.begin(), threads_list.end()), threads_list.end());
+        return threads_list;
+    }
+
+    /**
+     * Every kernel over rows, columns, thresholds and threads
+     */
+    vector<BenchResult> sweep(const BenchArgs& args){
+        auto selected = select_kernels(args.get_strings("kernels", "all"));
+        auto rows_list = args.get_longs("rows", "1000,10000,100000");
+        auto columns_list = args.get_longs("columns", "1,4");
+        auto thresholds = args.get_doubles("threshold", "1e-15,1e-9");
+        auto threads_list = sorted_threads(args, "1," + to_string(omp_get_max_threads()));
+        int warmup = args.get_int("warmup", 1);
+        int repeat = args.get_int("repeat", 5);
+        long max_full_rows = args.get_int("max-full-rows", 10000);
+
+        vector<BenchResult> results;
+        for(long n_rows : rows_list){
+            for(long n_columns : columns_list){
+                BenchData data;
+                data.columns = random_matrix(size_t(n_rows), size_t(n_columns));
+                for(auto& row : data.columns) data.column.push_back(row[0]);
+                for(auto& kernel : selected){
+                    // 1D kernels once per number of rows
+                    if(!kernel.two_d && n_columns != columns_list.front()) continue;
+                    vector<double> kernel_thresholds = kernel.uses_threshold ? thresholds : vector<double>{-1};
+                    for(double threshold : kernel_thresholds){
+                        if(threshold < 0 && n_rows > max_full_rows) continue;
+                        for(long threads : threads_list){
+                            if(kernel.serial && threads != threads_list.front()) continue;
+                            int used_threads = kernel.serial ? 1 : int(threads);
+                            cerr << kernel.name << " rows=" << n_rows << " columns=" << n_columns
+                                 << " threshold=" << threshold << " threads=" << used_threads << endl;
+                            auto seconds = time_repeated(warmup, repeat, [&](){
+                                kernel.run(data, used_threads, threshold);
+                            });
+                            BenchResult r;
+                            r.name = kernel.name;
+                            r.parameter("rows", double(n_rows));
+                            r.parameter("columns", double(kernel.two_d ? n_columns : 1));
+                            r.parameter("threshold", threshold);
+                            r.parameter("threads", double(used_threads));
+                            r.timings(seconds);
+                            double median = r.seconds.median > 0 ? r.seconds.median : 1e-300;
+                            r.metric("rows_per_second", n_rows / median);
+                            r.metric("values_per_second", double(n_rows) * (kernel.two_d ? n_columns : 1) / median);
+                            results.push_back(r);
+                        }
+                    }
+                }
+            }
+        }
+        return results;
+    }
+
+    /**
+     * Rows of a weak scaling run, so that every thread gets as much work as the single thread of the first run.
+     * A full kernel does N^2 work. With a threshold each row sums over a window of order sqrt(N) rows,
+     * which makes N^1.5.
+     */
+    long weak_rows(long base_rows, long threads, bool uses_threshold){
+        double exponent = uses_threshold ? 1.0 / 1.5 : 0.5;
+        return long(llround(double(base_rows) * pow(double(threads), exponent)));
+    }
+
+    /**
+     * Largest over mean of the time the threads spent on rows, taken from the trace.
+     * 1 is a perfect balance. NaN for kernels that do not trace their rows
+     */
+    double imbalance(long long since, long threads){
+        auto busy = trace_busy_seconds("rows", since);
+        sort(busy.rbegin(), busy.rend());
+        busy.resize(size_t(threads));  // threads without rows count as idle
+        double total{}, most{};
+        for(double b : busy){
+            total += b;
+            most = max(most, b);
+        }
+        return total > 0 ? most / (total / double(threads)) : NAN;
+    }
+
+    /**
+     * Strong scaling (same rows for every number of threads) and weak scaling (rows grow with the threads)
+     * of the parallel kernels. Speed-up and efficiency are relative to the first number of threads
+     */
+    vector<BenchResult> scaling(const BenchArgs& args){
+        auto selected = select_kernels(args.get_strings("kernels", "run_multi_omp,run_multi_pthread,convolve_2d_fast,run_multi_fast"));
+        auto rows_list = args.get_longs("rows", "20000");
+        long n_columns = args.get_int("columns", 4);
+        double threshold = args.get_doubles("threshold", "1e-15").front();
+        string default_threads;
+        for(int t{1}; t < omp_get_max_threads(); t *= 2) default_threads += to_string(t) + ",";
+        auto threads_list = sorted_threads(args, default_threads + to_string(omp_get_max_threads()));
+        auto kinds = args.get_strings("scaling", "strong,weak");
+        int warmup = args.get_int("warmup", 1);
+        int repeat = args.get_int("repeat", 5);
+        pin_mode = parse_pin_mode(args.get("pin", "none"));
+
+        set_tracing(true);
+        vector<BenchResult> results;
+        for(auto& kind : kinds){
+            if(kind != "strong" && kind != "weak") throw std::invalid_argument("scaling must be strong or weak");
+            for(long base_rows : rows_list){
+                for(auto& kernel : selected){
+                    if(kernel.serial) continue;
+                    double kernel_threshold = kernel.uses_threshold ? threshold : -1;
+                    double first_median{};
+                    long first_threads{1};
+                    for(long threads : threads_list){
+                        // `Convolution` takes no more than omp_get_max_threads() threads
+                        int previous = omp_get_max_threads();
+                        omp_set_num_threads(int(threads));
+                        long used = Convolution(int(threads)).threads();
+                        long n_rows = kind == "strong" ? base_rows : weak_rows(base_rows, used, kernel.uses_threshold);
+                        BenchData data;
+                        data.columns = random_matrix(size_t(n_rows), size_t(n_columns));
+                        for(auto& row : data.columns) data.column.push_back(row[0]);
+                        set_parallel_backend(ParallelBackend::openmp, int(threads), pin_order(pin_mode, size_t(threads)));
+                        cerr << kind << " " << kernel.name << " rows=" << n_rows << " threads=" << used << endl;
+
+                        long long since{};
+                        auto samples = time_repeated(warmup, repeat, [&](){
+                            since = trace_clock();
+                            kernel.run(data, int(threads), kernel_threshold);
+                        });
+                        omp_set_num_threads(previous);
+                        auto seconds = summarize(samples);
+                        if(threads == threads_list.front()){
+                            first_median = seconds.median;
+                            first_threads = used;
+                        }
+                        double speedup = first_median / max(seconds.median, 1e-300) * double(first_threads);
+                        if(kind == "weak") speedup *= double(used) / double(first_threads);
+
+                        BenchResult r;
+                        r.name = kernel.name;
+                        r.parameter("scaling", kind);
+                        r.parameter("rows", double(n_rows));
+                        r.parameter("columns", double(kernel.two_d ? n_columns : 1));
+                        r.parameter("threshold", kernel_threshold);
+                        r.parameter("threads", double(used));
+                        r.parameter("pin", args.get("pin", "none"));
+                        r.timings(samples);
+                        r.metric("speedup", speedup);
+                        r.metric("efficiency", speedup / double(used));
+                        r.metric("imbalance", imbalance(since, used));
+                        r.metric("values_per_second", double(n_rows) * (kernel.two_d ? n_columns : 1) / max(seconds.median, 1e-300));
+                        results.push_back(r);
+                    }
+                }
+            }
+        }
+        set_tracing(false);
+        set_parallel_backend(ParallelBackend::openmp);
+        return results;
+    }
+}
+
+int main(int argc, char** argv){
+    try {
+        BenchArgs args(argc, argv);
+        if(args.has("list") || args.has("help")){
+            for(auto& k : kernels()){
+                cout << k.name << (k.two_d ? " 2d" : " 1d") << (k.uses_threshold ? " threshold" : " full")
+                     << (k.serial ? " serial" : "") << endl;
+            }
+            return 0;
+        }
+        set_progress_reporting(false);
+        string mode = args.get("mode", "sweep");
+        vector<BenchResult> results;
+        if(mode == "sweep") results = sweep(args);
+        else if(mode == "scaling") results = scaling(args);
+        else throw std::invalid_argument("mode must be sweep or scaling");
+        print_table(cout, results);
+        save_results(results, args.get("csv", ""), args.get("json", ""));
+        return check_baseline(args, results);
+    } catch (std::exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,53 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+/**
+ * Writes a synthetic percolation data file (see `write_synthetic_data`) for reproducible workloads.
+ * The same options always give the same file.
+ *
+ * Usage:
+ *   generate_data [--out data.txt|-] [--rows 10000] [--columns 5] [--length 100] [--ensemble 10000]
+ *                 [--seed 1] [--noise 1] [--header json|raw|none] [--delimiter tab|space|comma]
+ *                 [--threads 1] [--compress gzip|zstd[:level]]
+ *
+ * e.g. a million rows to convolve:
+ *   generate_data --rows 1000000 --out big.txt && convolution --in big.txt -a 0 -b 1,2,3,4 --skip 1
+ */
+#include <iostream>
+#include <stdexcept>
+
+#include "bench_util.h"
+#include "../io/synthetic_data.h"
+
+using namespace std;
+
+int main(int argc, char** argv){
+    try {
+        BenchArgs args(argc, argv);
+        if(args.has("help")){
+            cout << "generate_data [--out data.txt|-] [--rows 10000] [--columns 5] [--length 100] [--ensemble 10000]" << endl
+                 << "              [--seed 1] [--noise 1] [--header json|raw|none] [--delimiter tab|space|comma]" << endl
+                 << "              [--threads 1] [--compress gzip|zstd[:level]]" << endl;
+            return 0;
+        }
+        SyntheticData spec;
+        spec.rows = size_t(args.get_longs("rows", "10000").front());
+        spec.columns = size_t(args.get_int("columns", 5));
+        spec.length = unsigned(args.get_int("length", 100));
+        spec.ensemble_size = unsigned(args.get_int("ensemble", 10000));
+        spec.seed = stoull(args.get("seed", "1"));
+        spec.noise = args.get_doubles("noise", "1").front();
+        spec.header = args.get("header", "json");
+        spec.delimiter = delimiter_from_name(args.get("delimiter", "tab"));
+        auto compression = parse_compression(args.get("compress", ""));
+        string filename = args.get("out", "data.txt");
+        if(filename != "-") filename += compressed_extension(compression);
+        write_synthetic_data(filename, spec, args.get_int("threads", 1), compression);
+        if(filename != "-") cerr << "wrote " << spec.rows << " rows to " << filename << endl;
+    } catch (std::exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
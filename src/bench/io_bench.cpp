@@ -0,0 +1,398 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+/**
+ * Benchmark of the readers and writers of the data files.
+ * Generates text files shaped like sample-data/data_json.txt (see `write_synthetic_data`) and measures
+ * every reader on them and every writer on the parsed data.
+ *
+ * With a cold cache the file is dropped from the page cache before each run, so a reader has to go
+ * to the storage device. A writer with a cold cache also waits for its file to reach the device.
+ *
+ * Usage:
+ *   io_bench [--rows 10000,100000] [--columns 5] [--delimiter tab,space,comma] [--threads 1,<max>]
+ *            [--cache warm,cold] [--readers all|<name>,...] [--writers all|<name>,...]
+ *            [--warmup 1] [--repeat 3] [--dir /tmp] [--keep] [--csv <file>] [--json <file>] [--list]
+ *
+ * All benchmarks take [--save-baseline <file>] [--baseline <file>] [--tolerance 5] [--alpha 0.05]
+ * to store results and fail with status 2 on a regression against stored results, see `check_baseline`.
+ */
+#include <omp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+#include "bench_util.h"
+#include "baseline.h"
+#include "../io/data_reader.h"
+#include "../io/data_writer.h"
+#include "../io/binary_format.h"
+#include "../io/npy_format.h"
+#include "../io/stream_io.h"
+#include "../io/compression.h"
+#include "../io/run_report.h"
+#include "../io/progress.h"
+#include "../io/synthetic_data.h"
+
+using namespace std;
+
+namespace {
+    /**
+     * Generated input file and the data parsed from it
+     */
+    struct BenchFile{
+        string filename;
+        char delimiter{'\t'};
+        size_t n_rows{};
+        size_t n_columns{};
+        vector<int> usecols;                    // all columns but the first
+        string header;
+        vector<vector<double>> a_data;          // first column
+        vector<vector<double>> b_data;          // the other columns
+        vector<string> a_names, b_names;
+    };
+
+    struct Reader{
+        string name;
+        bool whitespace_only;  // splits on white space whatever the delimiter is
+        bool probe;            // reads only the first lines of the file
+        bool threaded;
+        // file the reader is measured on, made from the text file if it is not the text file itself
+        function<string(const BenchFile&, const string& dir)> input;
+        function<void(const BenchFile&, const string& filename, int threads)> run;
+    };
+
+    struct Writer{
+        string name;
+        bool threaded;
+        string extension;
+        function<void(const BenchFile&, const string& filename, int threads)> run;
+    };
+
+    /**
+     * Write a file's dirty pages to the device and drop the file from the page cache
+     */
+    void drop_file_cache(const string& filename){
+        int fd = open(filename.c_str(), O_RDONLY);
+        if(fd < 0) return;
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+
+    void sync_file(const string& filename){
+        int fd = open(filename.c_str(), O_RDONLY);
+        if(fd < 0) return;
+        fdatasync(fd);
+        close(fd);
+    }
+
+    const int SKIPROWS_JSON = 1;  // the JSON line, skipped as with `--skip 1` on the command line
+
+    string same_file(const BenchFile& f, const string&){ return f.filename;}
+
+    /**
+     * Default level of a codec
+     */
+    Compression compression_of(Codec codec){
+        Compression compression;
+        compression.codec = codec;
+        compression.level = codec == Codec::gzip ? 6 : 3;
+        return compression;
+    }
+
+    string compressed_copy(const BenchFile& f, const string& dir, Codec codec){
+        Compression compression = compression_of(codec);
+        string filename = dir + "/io_bench_input" + compressed_extension(compression);
+        auto in = open_source(f.filename);
+        auto out = open_sink(filename, compression);
+        vector<char> buffer(size_t(1) << 20);
+        size_t n;
+        while ((n = in->read(buffer.data(), buffer.size())) > 0) out->write(buffer.data(), n);
+        out->close();
+        return filename;
+    }
+
+    void read_stream(const BenchFile& f, const string& filename){
+        auto in = open_source(filename);
+        LineReader lines(*in);
+        TextLineParser parser(SKIPROWS_JSON, f.delimiter);
+        vector<double> a_row, b_row;
+        vector<int> a_cols{0};
+        vector<vector<double>> a_data(1), b_data(f.usecols.size());
+        const char *line, *eol;
+        while (lines.next(line, eol)){
+            if(!parser.parse(line, eol, {&a_cols, &f.usecols}, {&a_row, &b_row})) continue;
+            a_data[0].push_back(a_row[0]);
+            for(size_t c{}; c < b_row.size(); ++c) b_data[c].push_back(b_row[c]);
+        }
+    }
+
+    vector<Reader> readers(){
+        return {
+                {"loadtxt", true, false, false, same_file, [](const BenchFile& f, const string& filename, int){
+                    loadtxt(filename, 1, SKIPROWS_JSON, f.delimiter);
+                }},
+                {"loadtxt_multi", true, false, false, same_file, [](const BenchFile& f, const string& filename, int){
+                    loadtxt(filename, f.usecols, SKIPROWS_JSON, f.delimiter);
+                }},
+                {"loadtxt_v2", false, false, false, same_file, [](const BenchFile& f, const string& filename, int){
+                    loadtxt_v2(filename, f.usecols, SKIPROWS_JSON, f.delimiter);
+                }},
+                {"explode_to_float", false, false, false, same_file, [](const BenchFile& f, const string& filename, int){
+                    ifstream fin(filename);
+                    string line;
+                    size_t values{};
+                    while (getline(fin, line)){
+                        if(line.empty() || line[0] == '#' || line[0] == '{') continue;
+                        values += explode_to_float(line, f.delimiter).size();
+                    }
+                    if(values == 0) throw std::runtime_error("explode_to_float found no values");
+                }},
+                {"loadtxt_parallel", false, false, true, same_file, [](const BenchFile& f, const string& filename, int threads){
+                    loadtxt_parallel(filename, f.usecols, SKIPROWS_JSON, f.delimiter, '#', threads);
+                }},
+                {"ingest_text", false, false, true, same_file, [](const BenchFile& f, const string& filename, int threads){
+                    ingest_text(filename, {0}, f.usecols, SKIPROWS_JSON, f.delimiter, '#', threads);
+                }},
+                {"stream", false, false, false, same_file, [](const BenchFile& f, const string& filename, int){
+                    read_stream(f, filename);
+                }},
+                {"stream_gzip", false, false, false, [](const BenchFile& f, const string& dir){
+                    return compressed_copy(f, dir, Codec::gzip);
+                }, [](const BenchFile& f, const string& filename, int){
+                    read_stream(f, filename);
+                }},
+                {"stream_zstd", false, false, false, [](const BenchFile& f, const string& dir){
+                    return compressed_copy(f, dir, Codec::zstd);
+                }, [](const BenchFile& f, const string& filename, int){
+                    read_stream(f, filename);
+                }},
+                {"binary", false, false, false, [](const BenchFile& f, const string& dir){
+                    string filename = dir + "/io_bench_input.bin";
+                    savebin_multi({}, filename, f.a_names, f.b_names, false, f.a_data, f.b_data, f.b_data, false);
+                    return filename;
+                }, [](const BenchFile& f, const string& filename, int){
+                    BinaryReader(filename).load(f.usecols);
+                }},
+                {"npz", false, false, false, [](const BenchFile& f, const string& dir){
+                    string filename = dir + "/io_bench_input.npz";
+                    savenpy_multi(filename, f.a_names, f.b_names, false, f.a_data, f.b_data, f.b_data, true);
+                    return filename;
+                }, [](const BenchFile& f, const string& filename, int){
+                    NpyReader(filename).load(f.usecols);
+                }},
+                {"analyze_delimeter", false, true, false, same_file, [](const BenchFile& f, const string& filename, int){
+                    analyze_delimeter(filename, SKIPROWS_JSON, f.delimiter);
+                }},
+                {"count_columns", false, true, false, same_file, [](const BenchFile& f, const string& filename, int){
+                    count_columns(filename, SKIPROWS_JSON, f.delimiter);
+                }},
+        };
+    }
+
+    vector<Writer> writers(){
+        return {
+                {"savetxt_multi_legacy", false, ".txt", [](const BenchFile& f, const string& filename, int){
+                    savetxt_multi(f.filename, filename, "", true, f.delimiter, true,
+                                  f.a_data, f.b_data, f.b_data, 14);
+                }},
+                {"savetxt_multi", true, ".txt", [](const BenchFile& f, const string& filename, int threads){
+                    savetxt_multi(f.header, filename, "", f.delimiter, true,
+                                  f.a_data, f.b_data, f.b_data, 14, threads);
+                }},
+                {"savetxt_multi_gzip", true, ".txt.gz", [](const BenchFile& f, const string& filename, int threads){
+                    savetxt_multi(f.header, filename, "", f.delimiter, true,
+                                  f.a_data, f.b_data, f.b_data, 14, threads, compression_of(Codec::gzip));
+                }},
+                {"savetxt_multi_zstd", true, ".txt.zst", [](const BenchFile& f, const string& filename, int threads){
+                    savetxt_multi(f.header, filename, "", f.delimiter, true,
+                                  f.a_data, f.b_data, f.b_data, 14, threads, compression_of(Codec::zstd));
+                }},
+                {"savetxt", true, ".txt", [](const BenchFile& f, const string& filename, int threads){
+                    savetxt(filename, f.header, f.b_data, f.delimiter, 14, threads);
+                }},
+                {"savebin_multi", false, ".bin", [](const BenchFile& f, const string& filename, int){
+                    savebin_multi({}, filename, f.a_names, f.b_names, true, f.a_data, f.b_data, f.b_data, false);
+                }},
+                {"savebin_multi_float32", false, ".bin", [](const BenchFile& f, const string& filename, int){
+                    savebin_multi({}, filename, f.a_names, f.b_names, true, f.a_data, f.b_data, f.b_data, true);
+                }},
+                {"savenpy_multi", false, ".npy", [](const BenchFile& f, const string& filename, int){
+                    savenpy_multi(filename, f.a_names, f.b_names, true, f.a_data, f.b_data, f.b_data, false);
+                }},
+                {"savenpz_multi", false, ".npz", [](const BenchFile& f, const string& filename, int){
+                    savenpy_multi(filename, f.a_names, f.b_names, true, f.a_data, f.b_data, f.b_data, true);
+                }},
+        };
+    }
+
+    /**
+     * Discards what the readers and writers print to standard output while it exists
+     */
+    class QuietCout{
+        streambuf* _buffer;
+    public:
+        QuietCout() : _buffer{cout.rdbuf(nullptr)} {}
+        ~QuietCout() { cout.rdbuf(_buffer);}
+    };
+
+    template <typename T>
+    vector<T> select(vector<T> all, const vector<string>& names, const string& what){
+        if(names.size() == 1 && names[0] == "all") return all;
+        vector<T> selected;
+        for(auto& name : names){
+            if(name == "none") continue;
+            auto found = find_if(all.begin(), all.end(), [&](const T& x){ return x.name == name;});
+            if(found == all.end()) throw std::invalid_argument("unknown " + what + " " + name + ". see --list");
+            selected.push_back(*found);
+        }
+        return selected;
+    }
+
+    bool codec_needed_available(const string& name){
+        if(name.find("gzip") != string::npos) return codec_available(Codec::gzip);
+        if(name.find("zstd") != string::npos) return codec_available(Codec::zstd);
+        return true;
+    }
+
+    BenchResult make_result(const string& kind, const string& name, const BenchFile& f, const string& cache,
+                            int threads, const vector<double>& seconds, size_t bytes, bool probe){
+        BenchResult r;
+        r.name = name;
+        r.parameter("kind", kind);
+        r.parameter("rows", double(f.n_rows));
+        r.parameter("columns", double(f.n_columns));
+        r.parameter("delimiter", delimiter_name(f.delimiter));
+        r.parameter("cache", cache);
+        r.parameter("threads", double(threads));
+        r.timings(seconds);
+        double median = r.seconds.median > 0 ? r.seconds.median : 1e-300;
+        r.metric("bytes", double(bytes));
+        r.metric("mb_per_second", probe ? NAN : double(bytes) / median / 1e6);
+        r.metric("rows_per_second", probe ? NAN : double(f.n_rows) / median);
+        return r;
+    }
+}
+
+int main(int argc, char** argv){
+    try {
+        BenchArgs args(argc, argv);
+        if(args.has("list") || args.has("help")){
+            for(auto& r : readers()) cout << "reader " << r.name << (r.threaded ? " threaded" : "") << endl;
+            for(auto& w : writers()) cout << "writer " << w.name << (w.threaded ? " threaded" : "") << endl;
+            return 0;
+        }
+        auto selected_readers = select(readers(), args.get_strings("readers", "all"), "reader");
+        auto selected_writers = select(writers(), args.get_strings("writers", "all"), "writer");
+        auto rows_list = args.get_longs("rows", "10000,100000");
+        auto columns_list = args.get_longs("columns", "5");
+        auto delimiters = args.get_strings("delimiter", "tab,space,comma");
+        auto caches = args.get_strings("cache", "warm,cold");
+        auto threads_list = args.get_longs("threads", "1," + to_string(omp_get_max_threads()));
+        sort(threads_list.begin(), threads_list.end());
+        threads_list.erase(unique(threads_list.begin(), threads_list.end()), threads_list.end());
+        int warmup = args.get_int("warmup", 1);
+        int repeat = args.get_int("repeat", 3);
+        string dir = args.get("dir", "/tmp");
+        bool keep = args.has("keep");
+        for(auto& cache : caches){
+            if(cache != "warm" && cache != "cold") throw std::invalid_argument("cache must be warm or cold");
+        }
+
+        set_progress_reporting(false);
+        vector<BenchResult> results;
+        vector<string> created;
+        for(long n_rows : rows_list){
+            for(long n_columns : columns_list){
+                if(n_columns < 2) throw std::invalid_argument("at least 2 columns are needed");
+                for(auto& delimiter : delimiters){
+                    QuietCout quiet;
+                    BenchFile f;
+                    f.delimiter = delimiter_from_name(delimiter);
+                    f.n_rows = size_t(n_rows);
+                    f.n_columns = size_t(n_columns);
+                    f.filename = dir + "/io_bench_input.txt";
+                    SyntheticData spec;
+                    spec.rows = f.n_rows;
+                    spec.columns = f.n_columns;
+                    spec.delimiter = f.delimiter;
+                    write_synthetic_data(f.filename, spec);
+                    created.push_back(f.filename);
+                    for(long c{1}; c < n_columns; ++c) f.usecols.push_back(int(c));
+                    auto input = ingest_text(f.filename, {0}, f.usecols, SKIPROWS_JSON, f.delimiter);
+                    f.header = input.header;
+                    f.a_data = input.a_data;
+                    f.b_data = input.b_data;
+                    f.a_names = column_names(f.header, f.delimiter, {0});
+                    f.b_names = column_names(f.header, f.delimiter, f.usecols);
+
+                    for(auto& reader : selected_readers){
+                        if(reader.whitespace_only && f.delimiter != ' ' && f.delimiter != '\t') continue;
+                        if(!codec_needed_available(reader.name)) continue;
+                        string filename = reader.input(f, dir);
+                        if(filename != f.filename) created.push_back(filename);
+                        for(auto& cache : caches){
+                            for(long threads : threads_list){
+                                if(!reader.threaded && threads != threads_list.front()) continue;
+                                int used_threads = reader.threaded ? int(threads) : 1;
+                                cerr << reader.name << " rows=" << n_rows << " columns=" << n_columns
+                                     << " delimiter=" << delimiter << " cache=" << cache
+                                     << " threads=" << used_threads << endl;
+                                auto seconds = time_repeated(warmup, repeat, [&](){
+                                    reader.run(f, filename, used_threads);
+                                }, [&](){
+                                    if(cache == "cold") drop_file_cache(filename);
+                                });
+                                results.push_back(make_result("reader", reader.name, f, cache, used_threads,
+                                                              seconds, file_size(filename), reader.probe));
+                            }
+                        }
+                    }
+
+                    for(auto& writer : selected_writers){
+                        if(!codec_needed_available(writer.name)) continue;
+                        string filename = dir + "/io_bench_output" + writer.extension;
+                        created.push_back(filename);
+                        for(auto& cache : caches){
+                            for(long threads : threads_list){
+                                if(!writer.threaded && threads != threads_list.front()) continue;
+                                int used_threads = writer.threaded ? int(threads) : 1;
+                                cerr << writer.name << " rows=" << n_rows << " columns=" << n_columns
+                                     << " delimiter=" << delimiter << " cache=" << cache
+                                     << " threads=" << used_threads << endl;
+                                auto seconds = time_repeated(warmup, repeat, [&](){
+                                    writer.run(f, filename, used_threads);
+                                    if(cache == "cold") sync_file(filename);
+                                }, [&](){
+                                    remove(filename.c_str());
+                                });
+                                results.push_back(make_result("writer", writer.name, f, cache, used_threads,
+                                                              seconds, file_size(filename), false));
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        print_table(cout, results);
+        save_results(results, args.get("csv", ""), args.get("json", ""));
+        if(!keep){
+            sort(created.begin(), created.end());
+            created.erase(unique(created.begin(), created.end()), created.end());
+            for(auto& filename : created) remove(filename.c_str());
+        }
+        return check_baseline(args, results);
+    } catch (std::exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
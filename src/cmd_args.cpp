@@ -13,6 +13,20 @@
 #include "io/data_writer.h"
 #include "include/printer.h"
 #include "array/array.h"
+#include "io/binary_format.h"
+#include "io/npy_format.h"
+#include "pipeline/pipeline.h"
+#include "pipeline/stream.h"
+#include "io/stream_io.h"
+#include "io/compression.h"
+#include "parallel/parallel.h"
+#include "parallel/numa.h"
+#include "memory/huge_pages.h"
+#include "io/run_report.h"
+#include "io/trace.h"
+#include <numeric>
+#include <memory>
+#include <map>
 
 using namespace std;
 
@@ -539,14 +553,62 @@ Options                      Description
 
   -d, --delimiter            Delimiter to use. Default value is ' '.
 
+      --compress             Compress the text output. 'gzip' or 'zstd' with an optional level, e.g. 'zstd:3'.
+                             '.gz' or '.zst' is appended to the name of the output file.
+
+      --append               Append the convolved columns to the binary input file instead of writing
+                             a new file. Nothing already in the file is rewritten.
+
+      --float32              Store values in single precision when writing a binary file.
+
+      --format               Format of the output file. 'txt', 'bin', 'npy' or 'npz'.
+                             Default is the format of the input file.
+                             'npy' writes one array of shape (rows, columns), 'npz' one array per column.
+
       --in                   name of the input file that we want to convolute. No default value.
+                             Text, binary, .npy and uncompressed .npz files are detected automatically.
+                             '-' reads text from the standard input, see Streaming below.
+                             gzip and zstd compressed text is detected and decompressed on a separate thread
+                             while the blocks already decompressed are parsed.
+
+      --huge-pages           Pages of buffers of 2 MB and more, e.g. the weight tables.
+                             'thp' (default) asks for transparent huge pages, 'hugetlb' takes pages from
+                             the hugetlbfs pool and falls back to 'thp', 'off' uses normal pages.
+                             What was obtained is printed at the end.
 
   -i  --info                 Info to write as comment in the output file
 
       --out                  name of the output file. If not provided the string '_convoluted.txt' will be
                              appended to the input file.
+                             '-' writes text to the standard output. Messages go to the standard error then.
+
+      --perf                 Read hardware counters (cycles, instructions, cache misses, cpu time) in every
+                             phase of --report, with IPC and memory bandwidth derived from them.
+                             Counters the machine does not have are reported as null.
+
+      --pipeline             Read, convolve, format and write row blocks at the same time. Only for uncompressed
+                             text input and text output. 'auto' splits the threads of -t among the stages, otherwise
+                             threads of each stage as <parse>,<convolve>,<format>, e.g. '1,6,1'.
+                             Busy time and utilisation of every stage are printed at the end.
+
+      --numa                 Placement of the data on the NUMA nodes of a multi-socket machine.
+                             'off' (default) leaves the input where the reader put it.
+                             'first-touch' copies the input rows by the threads that convolve them.
+                             'replicate' keeps one copy of the input per node.
+
+      --parallel             How parallel loops of the convolution, the text parser and the writer run.
+                             'omp' (default) uses OpenMP, 'tasks' one work-stealing thread pool of -t threads
+                             shared by all of them.
+
+      --pin                  Pin threads to cpus. 'none' (default), 'compact' fills one node after
+                             another, 'spread' takes turns between the nodes.
 
   -p, --precision            Floating point precision when writing in the data file. Default value is 10
+                             Negative value writes the shortest text that reads back to the same value.
+
+      --report               Write the time, rows/s, bytes, weights evaluated, peak memory and threads
+                             of every phase of the run (parsing, weights, each round, writing)
+                             to this file as JSON.
 
   -s, --skip                 Number of rows to skip from the input file. Default value is 0.
 
@@ -560,12 +622,31 @@ Options                      Description
 
       --times                Number of times to perform convolution.
 
+      --trace                Record when every thread works on which rows, parse blocks and write blocks
+                             and write the timeline to this file in the Chrome trace event format.
+                             Open it in https://ui.perfetto.dev or chrome://tracing.
+
   -h, --help                 display this help and exit
 
   -v, --version              output version information and exit
 
   -w, --write                If provided input b data will be written to the output file.
 
+      --rows                 Number of data rows of a streamed input. Default is the "rows" key of the header
+                             line. If neither is given, the whole input is read before anything is written.
+                             If the input has a different number of rows, the program stops with an error and
+                             the rows already written are not valid, since the weights depend on the rows.
+
+Subcommands
+  convert                    Convert a text file to the binary format or a binary file to text.
+                             See 'convolution convert --help'.
+
+Streaming
+  With '--in -' or '--out -' text is read and written as a stream. Output rows are written as soon as the
+  input rows they depend on are read, so only about one kernel window of rows is in memory, e.g.
+      zcat data.txt.gz | convolution --in - --skip 1 -a 0 -b 1,2 --rows 10000 --out - > out.txt
+  Output to the standard output is the default for '--in -'.
+
 
 The INT argument is an integer.
 The STRING argument is a string of characters.
@@ -580,7 +661,76 @@ Exit status:
     cout << hlp << endl;
 }
 
+/**
+ * With `--out -`, or `--in -` without `--out`, the data goes to the standard output, so messages
+ * that are normally printed there go to the standard error instead. Must be called before anything is printed.
+ */
+void messages_to_stderr(int argc, char** argv){
+    string in_filename, out_filename;
+    for(int i{1}; i + 1 < argc; ++i){
+        string flag = argv[i];
+        if(flag == "--in") in_filename = argv[i+1];
+        if(flag == "--out" || flag == "-o") out_filename = argv[i+1];
+    }
+    if(out_filename == "-" || (in_filename == "-" && out_filename.empty())){
+        cout.rdbuf(cerr.rdbuf());
+    }
+}
+
+/**
+ * Text input and output as streams. See `run_stream`.
+ * Standard input or output is used for the name "-".
+ */
+static int cmd_stream(const string& in_filename, string out_filename,
+                      const vector<int>& a_usecols, const vector<int>& b_usecols,
+                      const string& info, bool write_header_and_comment, int skiprows, bool write_input_data,
+                      int f_precision, double threshold, int times, char delimiter, const RunOptions& options,
+                      const Compression& compression){
+    if(!options.format.empty() && options.format != "txt"){
+        cerr << "streams are written as text only" << endl;
+        return ERROR_IN_COMMAND_LINE;
+    }
+    if(options.append || !options.pipeline.empty()){
+        cerr << "--append and --pipeline cannot be used with streams" << endl;
+        return ERROR_IN_COMMAND_LINE;
+    }
+    if(out_filename != "-"){
+        out_filename += ".txt" + compressed_extension(compression);
+    }
+    PipelineOutput output;
+    output.info = info;
+    output.write_header_and_comment = write_header_and_comment;
+    output.write_input_data = write_input_data;
+    output.precision = f_precision;
+
+    PhaseTimer timer("stream", 1);
+    StreamStats stats;
+    try {
+        auto in = open_source(in_filename);
+        auto out = open_sink(out_filename, compression);
+        stats = run_stream(*in, *out, skiprows, delimiter, a_usecols, b_usecols, times, threshold,
+                           options.rows, output);
+    } catch (std::exception& e) {
+        // e.g. more rows than --rows
+        cerr << e.what() << endl;
+        return ERROR_IN_COMMAND_LINE;
+    }
+    timer.rows(stats.rows);
+    timer.bytes_in(file_size(in_filename));
+    timer.bytes_out(file_size(out_filename));
+    timer.stop();
+    cout << stats.rows << " rows written in " << stats.seconds << " sec. at most " << stats.max_window
+         << " rows were kept in memory" << endl;
+    if(stats.buffered){
+        cout << "number of rows was not known. use --rows to write rows while the input is read" << endl;
+    }
+    return 0;
+}
+
 int cmd_args_v3(int argc, char** argv){
+    if(argc > 1 && str2int(argv[1]) == str2int("convert")){
+        return cmd_convert(argc - 1, argv + 1);
+    }
     string in_filename;
     string out_filename;
     string out_file_flag = "_convoluted";
@@ -598,24 +748,132 @@ int cmd_args_v3(int argc, char** argv){
     int n_threads{1};
     double threshold{1e-15};
     int times{1};
+    RunOptions options;
 
 #ifdef USE_BOOST
     parse_cmd_arg_boost(argc, argv, in_filename, out_filename, a_usecols, b_usecols, info,
                         write_header_and_comment, skiprows, write_input_data, f_precision, n_threads,
-                        threshold, times, delimiter);
+                        threshold, times, delimiter, options);
 #else
     parse_cmd_arg(argc, argv, in_filename, out_filename, a_usecols, b_usecols, info,
                   write_header_and_comment, skiprows, write_input_data, f_precision, n_threads,
-                  threshold, times, delimiter);
+                  threshold, times, delimiter, options);
 #endif
+    Compression compression;
+    try {
+        compression = parse_compression(options.compress);
+    } catch (std::invalid_argument& e) {
+        cerr << e.what() << endl;
+        return ERROR_IN_COMMAND_LINE;
+    }
+    try {
+        set_numa_policy(parse_numa_policy(options.numa));
+        set_huge_page_mode(parse_huge_page_mode(options.huge_pages));
+        set_parallel_backend(parse_parallel_backend(options.parallel), n_threads,
+                             pin_order(parse_pin_mode(options.pin), size_t(max(1, n_threads))));
+    } catch (std::invalid_argument& e) {
+        cerr << e.what() << endl;
+        return ERROR_IN_COMMAND_LINE;
+    }
+    // saved however the run returns from here on
+    unique_ptr<ReportOnExit> report_on_exit;
+    if(!options.report.empty()){
+        string command;
+        for(int k{}; k < argc; ++k) command += (k == 0 ? "" : " ") + string(argv[k]);
+        run_report().set("command", command);
+        run_report().set("input", in_filename);
+        run_report().set("threads", n_threads);
+        run_report().set("threshold", threshold);
+        run_report().set("times", times);
+        run_report().set("parallel", options.parallel);
+        set_perf_counters(options.perf);
+        report_on_exit.reset(new ReportOnExit(options.report));
+    }
+    unique_ptr<TraceOnExit> trace_on_exit;
+    if(!options.trace.empty()){
+        trace_on_exit.reset(new TraceOnExit(options.trace));
+    }
+    string round_flag = "_" + to_string(times) + "times";
+    if(threshold >= 0){
+        round_flag += "_fast";
+    }
+    // standard input or output is read and written as a stream
+    if(in_filename == "-" || out_filename == "-"){
+        if(out_filename.empty()){
+            out_filename = in_filename == "-" ? "-" : in_filename + out_file_flag + round_flag;
+        }
+        return cmd_stream(in_filename, out_filename, a_usecols, b_usecols, info, write_header_and_comment,
+                          skiprows, write_input_data, f_precision, threshold, times, delimiter, options,
+                          compression);
+    }
+    // input format is detected from the first bytes of the file
+    string in_format = "txt";
+    if(is_binary_file(in_filename)) in_format = "bin";
+    else if(is_npy_file(in_filename)) in_format = "npy";
+    else if(is_npz_file(in_filename)) in_format = "npz";
+    if(options.format.empty()){
+        options.format = in_format;
+    }
+    map<string, string> extensions{{"txt", ".txt"}, {"bin", ".cbin"}, {"npy", ".npy"}, {"npz", ".npz"}};
+    if(extensions.count(options.format) == 0){
+        cerr << "unknown output format " << options.format << endl;
+        return ERROR_IN_COMMAND_LINE;
+    }
+    if(options.append && in_format != "bin"){
+        cerr << "--append requires a binary input file" << endl;
+        return ERROR_IN_COMMAND_LINE;
+    }
+    if(compression.codec != Codec::none && options.format != "txt"){
+        cerr << "--compress works with text output only" << endl;
+        return ERROR_IN_COMMAND_LINE;
+    }
     if(out_filename.empty()){
 //        out_filename = in_filename + out_file_flag;
-        out_filename = in_filename + out_file_flag + "_" + to_string(times) + "times";
-        if(threshold >= 0){
-            out_filename += "_fast";
+        out_filename = in_filename + out_file_flag + round_flag;
+    }
+    out_filename += extensions[options.format] + compressed_extension(compression);
+    if(!options.pipeline.empty()){
+        if(in_format != "txt" || options.format != "txt" || options.append){
+            cerr << "--pipeline works with text input and text output only" << endl;
+            return ERROR_IN_COMMAND_LINE;
+        }
+        if(file_codec(in_filename) != Codec::none){
+            cerr << "--pipeline needs an uncompressed input file" << endl;
+            return ERROR_IN_COMMAND_LINE;
         }
+        PipelineOutput output;
+        output.filename = out_filename;
+        output.info = info;
+        output.write_header_and_comment = write_header_and_comment;
+        output.write_input_data = write_input_data;
+        output.precision = f_precision;
+        output.compression = compression;
+        PipelineThreads stage_threads = pipeline_threads(options.pipeline, n_threads);
+        // stage threads and the writer get cpus of their own
+        stage_threads.cpus = pin_order(parse_pin_mode(options.pin),
+                                       size_t(stage_threads.parse + stage_threads.convolve + stage_threads.format + 1));
+        if(parallel_backend() == ParallelBackend::tasks){
+            // the stages run on the pool. the first cpu is left for the thread that waits for them
+            int pool_threads = pipeline_pool_threads(stage_threads);
+            set_parallel_backend(ParallelBackend::tasks, pool_threads,
+                                 pin_order(parse_pin_mode(options.pin), size_t(pool_threads)));
+        }
+        PhaseTimer timer("pipeline", n_threads);
+        PipelineStats stats;
+        try {
+            stats = run_pipeline(in_filename, skiprows, delimiter, a_usecols, b_usecols, times, threshold,
+                                 output, stage_threads);
+        } catch (std::exception& e) {
+            cerr << e.what() << endl;
+            return ERROR_UNHANDLED_EXCEPTION;
+        }
+        timer.bytes_in(file_size(in_filename));
+        timer.bytes_out(file_size(out_filename));
+        timer.stop();
+        stats.print(cout);
+        huge_page_stats().print(cout);
+        return 0;
     }
-    out_filename += ".txt";
     /*******
      * checking provided arguments
      * *****/
@@ -642,9 +900,46 @@ int cmd_args_v3(int argc, char** argv){
     cout << "times " << times << endl;
     cout << __LINE__ << endl;
 #endif
-    delimiter = analyze_delimeter(in_filename, skiprows, delimiter);
-    vector<vector<double>> b_data_in = loadtxt_v2(in_filename, b_usecols, skiprows, delimiter);
-    vector<vector<double>> a_data;
+    TextIngest input;
+    map<string, string> bin_header;
+    if(in_format == "bin"){
+        // memory mapped. nothing to parse
+        PhaseTimer timer("read", 1);
+        timer.bytes_in(file_size(in_filename));
+        BinaryReader reader(in_filename);
+        input.b_data = reader.load(b_usecols);
+        if(!a_usecols.empty()) {
+            input.a_data = reader.load(a_usecols);
+        }
+        bin_header = reader.header();
+        input.header = bin_header["text_header"];
+        auto names = reader.names();
+        for(auto c : a_usecols) if(size_t(c) < names.size()) a_names.push_back(names[c]);
+        for(auto c : b_usecols) if(size_t(c) < names.size()) b_names.push_back(names[c]);
+    }else if(in_format == "npy" || in_format == "npz"){
+        // memory mapped as well. columns of all arrays are numbered one after another
+        PhaseTimer timer("read", 1);
+        timer.bytes_in(file_size(in_filename));
+        NpyReader reader(in_filename);
+        input.b_data = reader.load(b_usecols);
+        if(!a_usecols.empty()) {
+            input.a_data = reader.load(a_usecols);
+        }
+        auto names = reader.names();
+        for(auto c : a_usecols) if(size_t(c) < names.size()) a_names.push_back(names[c]);
+        for(auto c : b_usecols) if(size_t(c) < names.size()) b_names.push_back(names[c]);
+    }else {
+        // delimiter, header and both sets of columns are read in one pass
+        input = ingest_text(in_filename, a_usecols, b_usecols, skiprows, delimiter, '#', n_threads);
+        delimiter = input.delimiter;
+        if(options.format != "txt"){
+            bin_header = header_from_text(input.header);
+            a_names = column_names(input.header, delimiter, a_usecols);
+            b_names = column_names(input.header, delimiter, b_usecols);
+        }
+    }
+    vector<vector<double>> b_data_in = std::move(input.b_data);
+    vector<vector<double>> a_data = std::move(input.a_data);
     if(a_usecols.empty()){
         unsigned long N = b_data_in.size();
         unsigned long m = b_data_in[0].size();
@@ -657,8 +952,7 @@ int cmd_args_v3(int argc, char** argv){
                 a_data[i][j] = double (i) / N;
             }
         }
-    }else {
-        a_data = loadtxt_v2(in_filename, a_usecols, skiprows, delimiter);
+        a_names.assign(m, "p");
     }
 //    view_matrix(b_data_in);
 
@@ -667,16 +961,18 @@ int cmd_args_v3(int argc, char** argv){
 //    vector<vector<double>> b_data_out = convolve_2d_fast(b_data_in, n_threads, threshold);
 
 
-    // for multiple convolution
+    // for multiple convolution. the threads are started once for all rounds
+    Convolution conv(n_threads);
     auto tmp = b_data_in;
     vector<vector<double>> b_data_out;
     for(int i{}; i < times; ++i){
         cout << "convolution round " << (i+1) << endl;
-        if(threshold < 0) {
-            b_data_out = convolve_2d(tmp, n_threads);
-        }else {
-            b_data_out = convolve_2d_fast(tmp, n_threads, threshold);
-        }
+        PhaseTimer timer("convolution round " + to_string(i+1), conv.threads());
+        b_data_out = conv.run_multi_fast(tmp, threshold);
+        timer.rows(b_data_out.size());
+        timer.weights(conv.weights_evaluated());
+        timer.flops(conv.flops());
+        timer.stop();
         tmp = b_data_out;
 
 #ifdef DEBUG_FLAG
@@ -690,25 +986,211 @@ int cmd_args_v3(int argc, char** argv){
 #endif
 
     }
+    huge_page_stats().print(cout);
 
     // writing output to file
-    savetxt_multi(in_filename,
+    PhaseTimer write_timer("write", n_threads);
+    write_timer.rows(b_data_out.size());
+    if(options.append){
+        size_t size_before = file_size(in_filename);
+        vector<BinaryColumnOut> columns;
+        for(size_t j{}; j < b_data_out[0].size(); ++j){
+            columns.push_back({b_names[j] + " convolved" + round_flag, &b_data_out, j});
+        }
+        appendbin(in_filename, columns, options.float32 ? ColumnType::float32 : ColumnType::float64);
+        write_timer.bytes_out(file_size(in_filename) - min(size_before, file_size(in_filename)));
+        cout << "convolved columns are appended to " << in_filename << endl;
+        return 0;
+    }
+    if(options.format == "bin"){
+        if(!info.empty()){
+            bin_header["info"] = info;
+        }
+        savebin_multi(bin_header,
+                      out_filename,
+                      a_names,
+                      b_names,
+                      write_input_data,
+                      a_data,
+                      b_data_in,
+                      b_data_out,
+                      options.float32);
+        write_timer.bytes_out(file_size(out_filename));
+        return 0;
+    }
+    if(options.format == "npy" || options.format == "npz"){
+        savenpy_multi(out_filename,
+                      a_names,
+                      b_names,
+                      write_input_data,
+                      a_data,
+                      b_data_in,
+                      b_data_out,
+                      options.format == "npz");
+        write_timer.bytes_out(file_size(out_filename));
+        return 0;
+    }
+    if(!write_header_and_comment){
+        input.header.clear();
+    }
+    savetxt_multi(input.header,
                   out_filename,
                   info,
-                  write_header_and_comment,
                   delimiter,
                   write_input_data,
                   a_data,
                   b_data_in,
                   b_data_out,
-                  f_precision);
+                  f_precision,
+                  n_threads,
+                  compression);
+    write_timer.bytes_out(file_size(out_filename));
+    return 0;
+}
+
+void help_convert(){
+    string hlp = R"***(Usage:
+convolution convert --in <STRING> [--out <STRING>] [-d <CHAR>] [--skip <INT>] [-p <INT>] [--float32]
+
+convert a text data file to the binary format or a binary file back to text.
+direction is decided from the input file.
+
+Options                      Description
+  -d, --delimiter            Delimiter of the text file. Default value is ' '.
+
+      --float32              Store values in single precision in the binary file.
+
+      --in                   name of the input file. No default value.
+
+      --out                  name of the output file. If not provided '.cbin' or '.txt' will be
+                             appended to the input file.
+
+  -p, --precision            Floating point precision when writing a text file. Default value is 10
+                             Negative value writes the shortest text that reads back to the same value.
+
+  -s, --skip                 Number of rows to skip from the text file. Default value is 0.
+
+  -t, --threads              Number of threads to use for parsing.
+
+  -h, --help                 display this help and exit
+)***";
+    cout << hlp << endl;
+}
+
+/**
+ * Converts between text and the native binary format.
+ * All columns of the input file are converted.
+ * Header and comment of the text file are stored in the binary file and written back on conversion to text.
+ */
+int cmd_convert(int argc, char** argv){
+    string in_filename;
+    string out_filename;
+    int skiprows{0};
+    char delimiter=' ';
+    int f_precision{10};
+    int n_threads{1};
+    bool float32{false};
+    for(int i{1}; i < argc;){
+        switch (str2int(argv[i])){
+            case str2int("-d"):
+            case str2int("--delimiter"):
+                ++i;
+                if(i < argc) delimiter = argv[i][0];
+                ++i;
+                break;
+            case str2int("--float32"):
+                float32 = true;
+                ++i;
+                break;
+            case str2int("--in"):
+                ++i;
+                if(i < argc) in_filename = argv[i];
+                ++i;
+                break;
+            case str2int("-o"):
+            case str2int("--out"):
+                ++i;
+                if(i < argc) out_filename = argv[i];
+                ++i;
+                break;
+            case str2int("-p"):
+            case str2int("--precision"):
+                ++i;
+                if(i < argc) f_precision = stoi(argv[i]);
+                ++i;
+                break;
+            case str2int("-s"):
+            case str2int("--skip"):
+                ++i;
+                if(i < argc) skiprows = stoi(argv[i]);
+                ++i;
+                break;
+            case str2int("-t"):
+            case str2int("--threads"):
+                ++i;
+                if(i < argc) n_threads = stoi(argv[i]);
+                ++i;
+                break;
+            case str2int("-h"):
+            case str2int("--help"):
+                help_convert();
+                exit(0);
+            default:
+                help_convert();
+                return ERROR_IN_COMMAND_LINE;
+        }
+    }
+    if(in_filename.empty()){
+        help_convert();
+        return ERROR_IN_COMMAND_LINE;
+    }
+
+    if(is_binary_file(in_filename)){
+        if(out_filename.empty()) out_filename = in_filename + ".txt";
+        BinaryReader reader(in_filename);
+        vector<int> usecols(reader.columns());
+        iota(usecols.begin(), usecols.end(), 0);
+        string header;
+        auto found = reader.header().find("text_header");
+        if(found != reader.header().end()){
+            header = found->second;
+        }else{
+            header = "#";
+            for(auto& name : reader.names()) header += name + delimiter;
+            header += '\n';
+        }
+        savetxt(out_filename, header, reader.load(usecols), delimiter, f_precision, n_threads);
+        cout << "written " << reader.rows() << " rows and " << reader.columns() << " columns to " << out_filename << endl;
+        return 0;
+    }
+
+    if(out_filename.empty()) out_filename = in_filename + ".cbin";
+    delimiter = analyze_delimeter(in_filename, skiprows, delimiter);
+    vector<int> usecols(count_columns(in_filename, skiprows, delimiter));
+    iota(usecols.begin(), usecols.end(), 0);
+    TextIngest input = ingest_text(in_filename, {}, usecols, skiprows, delimiter, '#', n_threads);
+    for(size_t r{}; r < input.b_data.size(); ++r){
+        if(input.b_data[r].size() != usecols.size()){
+            cerr << "row " << r << " has " << input.b_data[r].size() << " columns instead of " << usecols.size() << endl;
+            return ERROR_IN_COMMAND_LINE;
+        }
+    }
+    auto names = column_names(input.header, input.delimiter, usecols);
+    vector<BinaryColumnOut> columns;
+    for(size_t j{}; j < usecols.size(); ++j){
+        columns.push_back({names[j], &input.b_data, j});
+    }
+    savebin(out_filename, header_from_text(input.header), columns,
+            float32 ? ColumnType::float32 : ColumnType::float64);
+    cout << "written " << input.b_data.size() << " rows and " << columns.size() << " columns to " << out_filename << endl;
     return 0;
 }
 
 #ifdef USE_BOOST
 int parse_cmd_arg_boost(int argc, char *const *argv, string &in_filename, string &out_filename, vector<int> &a_usecols,
                          vector<int> &b_usecols, string &info, bool &write_header_and_comment, int &skiprows,
-                         bool &write_input_data, int &f_precision, int &n_threads, double &threshold, int &times, char& delimiter) {
+                         bool &write_input_data, int &f_precision, int &n_threads, double &threshold, int &times, char& delimiter,
+                         RunOptions &options) {
 
     write_input_data=false;
 //    write_header_and_comment = true;
@@ -739,7 +1221,20 @@ int parse_cmd_arg_boost(int argc, char *const *argv, string &in_filename, string
                 ("threshold", boost::program_options::value<double>(&threshold)->default_value(1e-15), "If weight factor that multiplies input data at each iteration is less than\n"
                         " `threshold` then break that loop. Program performs way faster in this way. Negative value of the threshold will perform full convolution without skipping"
                              "any step which increases time required to do this exponentially.")
-                ("times", boost::program_options::value<int>(&times)->default_value(1), "Number of times to perform convolution.");
+                ("times", boost::program_options::value<int>(&times)->default_value(1), "Number of times to perform convolution.")
+                ("format", boost::program_options::value<string>(&options.format), "Format of the output file. 'txt', 'bin', 'npy' or 'npz'. Default is the format of the input file.")
+                ("float32", "Store values in single precision when writing a binary file.")
+                ("append", "Append the convolved columns to the binary input file instead of writing a new file.")
+                ("pipeline", boost::program_options::value<string>(&options.pipeline), "Overlap reading, convolution, formatting and writing. 'auto' or threads of each stage as <parse>,<convolve>,<format>.")
+                ("rows", boost::program_options::value<size_t>(&options.rows), "Number of data rows of a streamed input. Lets output rows be written before the input ends. Rows written before an error about the number of rows are not valid.")
+                ("compress", boost::program_options::value<string>(&options.compress), "Compress the text output. 'gzip' or 'zstd' with an optional level, e.g. 'zstd:3'.")
+                ("parallel", boost::program_options::value<string>(&options.parallel), "Run parallel loops with 'omp' (default) or as 'tasks' on one work-stealing thread pool.")
+                ("numa", boost::program_options::value<string>(&options.numa), "Placement of the input on NUMA nodes. 'off' (default), 'first-touch' or 'replicate'.")
+                ("pin", boost::program_options::value<string>(&options.pin), "Pin threads to cpus. 'none' (default), 'compact' or 'spread'.")
+                ("huge-pages", boost::program_options::value<string>(&options.huge_pages), "Pages of large buffers. 'thp' (default), 'hugetlb' or 'off'.")
+                ("report", boost::program_options::value<string>(&options.report), "Write time and throughput of every phase of the run to this file as JSON.")
+                ("perf", "Add hardware counters to every phase of --report.")
+                ("trace", boost::program_options::value<string>(&options.trace), "Write a timeline of the work of every thread to this file in the Chrome trace event format.");
 
 //        cout << __LINE__ << endl;
         boost::program_options::variables_map vm;
@@ -759,6 +1254,15 @@ int parse_cmd_arg_boost(int argc, char *const *argv, string &in_filename, string
                 write_input_data = true;
                 cout << "input data will be written" << endl;
             }
+            if (vm.count("float32")) {
+                options.float32 = true;
+            }
+            if (vm.count("perf")) {
+                options.perf = true;
+            }
+            if (vm.count("append")) {
+                options.append = true;
+            }
 //            if (vm.count("copy")|| vm.count("c")) {
 //                write_header_and_comment = false;
 //                cout << "header information will not be written" << endl;
@@ -794,7 +1298,8 @@ int parse_cmd_arg_boost(int argc, char *const *argv, string &in_filename, string
 
 void parse_cmd_arg(int argc, char *const *argv, string &in_filename, string &out_filename, vector<int> &a_usecols,
                          vector<int> &b_usecols, string &info, bool &write_header_and_comment, int &skiprows,
-                         bool &write_input_data, int &f_precision, int &n_threads, double &threshold, int &times, char& delimiter) {
+                         bool &write_input_data, int &f_precision, int &n_threads, double &threshold, int &times, char& delimiter,
+                         RunOptions &options) {
     if(argc == 1){
         help_v3();
         exit(0);
@@ -942,6 +1447,88 @@ void parse_cmd_arg(int argc, char *const *argv, string &in_filename, string &out
                 threshold = stod(argv[i]);
                 ++i;
                 break;
+            case str2int("--format"):
+                ++i;
+                if(i < argc) {
+                    options.format = argv[i];
+                }
+                ++i;
+                break;
+            case str2int("--float32"):
+                options.float32 = true;
+                ++i;
+                break;
+            case str2int("--append"):
+                options.append = true;
+                ++i;
+                break;
+            case str2int("--pipeline"):
+                ++i;
+                if(i < argc) {
+                    options.pipeline = argv[i];
+                }
+                ++i;
+                break;
+            case str2int("--compress"):
+                ++i;
+                if(i < argc) {
+                    options.compress = argv[i];
+                }
+                ++i;
+                break;
+            case str2int("--parallel"):
+                ++i;
+                if(i < argc) {
+                    options.parallel = argv[i];
+                }
+                ++i;
+                break;
+            case str2int("--numa"):
+                ++i;
+                if(i < argc) {
+                    options.numa = argv[i];
+                }
+                ++i;
+                break;
+            case str2int("--pin"):
+                ++i;
+                if(i < argc) {
+                    options.pin = argv[i];
+                }
+                ++i;
+                break;
+            case str2int("--huge-pages"):
+                ++i;
+                if(i < argc) {
+                    options.huge_pages = argv[i];
+                }
+                ++i;
+                break;
+            case str2int("--perf"):
+                options.perf = true;
+                ++i;
+                break;
+            case str2int("--trace"):
+                ++i;
+                if(i < argc) {
+                    options.trace = argv[i];
+                }
+                ++i;
+                break;
+            case str2int("--report"):
+                ++i;
+                if(i < argc) {
+                    options.report = argv[i];
+                }
+                ++i;
+                break;
+            case str2int("--rows"):
+                ++i;
+                if(i < argc) {
+                    options.rows = stoull(argv[i]);
+                }
+                ++i;
+                break;
             default:
                 help_v3();
                 exit(0);
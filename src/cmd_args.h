@@ -17,6 +17,26 @@ namespace
 
 } // namespace
 
+/**
+ * Options of the input and output files and of the execution.
+ * Kept together so that adding one does not change the signature of the parsers.
+ */
+struct RunOptions{
+    std::string format;   // format of the output file. "txt", "bin", "npy" or "npz". same as the input file if empty
+    bool float32{false};  // store binary output in single precision
+    bool append{false};   // append convolved columns to the binary input file instead of writing a new file
+    std::string pipeline; // threads of the pipeline stages, "auto" or "<parse>,<convolve>,<format>". off if empty
+    size_t rows{0};       // number of data rows of a streamed input. 0 if not known
+    std::string compress; // codec and level of the text output, e.g. "zstd:3". not compressed if empty
+    std::string parallel{"omp"}; // backend of the parallel loops, "omp" or "tasks"
+    std::string numa;     // NUMA placement of the input, "off", "first-touch" or "replicate". off if empty
+    std::string pin;      // pinning of threads to cpus, "none", "compact" or "spread". none if empty
+    std::string huge_pages; // pages of large buffers, "off", "thp" or "hugetlb". thp if empty
+    std::string report;   // JSON file with time and throughput of every phase. none if empty
+    bool perf{false};     // hardware counters in the phases of the report
+    std::string trace;    // Chrome trace of the work of every thread. none if empty
+};
+
 
 void get_option_a(int argc, char *const *argv, std::vector<int> &a_usecols, std::vector<std::string> &a_names, int i);
 
@@ -24,11 +44,13 @@ void get_option_b(int argc, char *const *argv, std::vector<int> &b_usecols, std:
 
 int parse_cmd_arg_boost(int argc, char *const *argv, std::string &in_filename, std::string &out_filename, std::vector<int> &a_usecols,
                          std::vector<int> &b_usecols, std::string &info, bool &write_header_and_comment, int &skiprows,
-                         bool &write_input_data, int &f_precision, int &n_threads, double &threshold, int &times, char& delimiter);
+                         bool &write_input_data, int &f_precision, int &n_threads, double &threshold, int &times, char& delimiter,
+                         RunOptions &options);
 
 void parse_cmd_arg(int argc, char *const *argv, std::string &in_filename, std::string &out_filename, std::vector<int> &a_usecols,
                    std::vector<int> &b_usecols, std::string &info, bool &write_header_and_comment, int &skiprows,
-                   bool &write_input_data, int &f_precision, int &n_threads, double &threshold, int &times, char& delimiter);
+                   bool &write_input_data, int &f_precision, int &n_threads, double &threshold, int &times, char& delimiter,
+                   RunOptions &options);
 
 
 
@@ -39,6 +61,8 @@ void help();
 void cmd_args(int argc, char* argv[]);
 int cmd_args_v2(int argc, char** argv);
 int cmd_args_v3(int argc, char** argv);
+int cmd_convert(int argc, char** argv);
+void messages_to_stderr(int argc, char** argv);
 
 void version();
 
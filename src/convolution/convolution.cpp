@@ -6,14 +6,41 @@
 #include <iostream>
 #include <thread>
 #include <mutex>
+#include <atomic>
 #include <omp.h>
 #include <sstream>
 #include "convolution.h"
 #include "binomial.h"
 #include "../io/logger.h"
+#include "../io/progress.h"
+#include "../io/run_report.h"
+#include "../io/trace.h"
+#include "../parallel/partition.h"
+#include "../parallel/parallel.h"
+#include "../parallel/numa.h"
+#include "../memory/scratch_arena.h"
 
 using namespace std;
 
+/**
+ * Number of ranges of equal cost per thread. Coarse enough that scheduling costs nothing,
+ * fine enough that threads that finish early can take over the end of the others' work.
+ */
+const size_t RANGES_PER_THREAD = 8;
+
+/**
+ * Output rows allocated ahead of the convolution, so that the loops over rows never allocate.
+ * Allocated in parallel, so that rows tend to be placed on the NUMA node of the threads that write them
+ */
+static vector<vector<double>> allocate_rows(size_t n_rows, size_t n_columns, int thread_count){
+    vector<vector<double>> rows(n_rows);
+#pragma omp parallel for schedule(static) num_threads(max(1, thread_count))
+    for (long row=0; row < long(n_rows); ++row){
+        rows[row].resize(n_columns);
+    }
+    return rows;
+}
+
 
 /*****************************************************
  * Methods of the Convolution class
@@ -30,8 +57,10 @@ Convolution::Convolution(int threads) {
  * Initializes the binomial expansion
  */
 void Convolution::initialize(size_t n)  {
+    PhaseTimer timer("weights");
     auto t0 = chrono::system_clock::now();
     N = n;
+    _weights_evaluated = N > 0 ? N * (N - 1) : 0; // every row of the full convolution weights all others
     _forward_factor.resize(N);
     _backward_factor.resize(N);
 
@@ -56,8 +85,9 @@ vector<double> Convolution::run(vector<double>& data_in) {
     initialize(N);
 
     vector<double> data_out(N);
+    _progress.reset(N);
+    ProgressReporter reporter(_progress);
     auto t0 = chrono::system_clock::now();
-    long step = N / 1000;
     for (long j=0; j <N; ++j) // start from j=1
     {
         double prob     = (double) j / N;
@@ -94,6 +124,7 @@ vector<double> Convolution::run(vector<double>& data_in) {
 
         // normalizing data
         data_out[j] = sum / bn_tot;
+        _progress.add();
 //        cout << bn_tot << endl;
 //        if(j % step == 0) {
 //            cout << "\33[2K"; // erase the current line
@@ -121,11 +152,15 @@ vector<double> Convolution::run_omp(vector<double>& data_in) {
     initialize(N);
 
     vector<double> data_out(N);
+    _progress.reset(N);
+    ProgressReporter reporter(_progress);
     auto t0 = chrono::system_clock::now();
-    long step = N / 1000;
-    // entering parallel region
-#pragma omp parallel for schedule(dynamic)
-    for (long j=0; j <N; ++j)
+    // entering parallel region. one range of rows per thread, as schedule(static) splits them
+    auto bounds = cost_partition(N, -1, size_t(omp_get_max_threads()));
+#pragma omp parallel for schedule(static)
+    for (long range=0; range < long(bounds.size()) - 1; ++range){
+    TraceScope trace("rows", bounds[range], bounds[range+1]);
+    for (long j=bounds[range]; j < bounds[range+1]; ++j)
     {
         double prob     = (double) j / N;
         double factor   = 0;
@@ -133,7 +168,7 @@ vector<double> Convolution::run_omp(vector<double>& data_in) {
         double prev     = 0;
         double binomNormalization_const = 1;
         double sum      = data_in[j];
-        ++_count;
+        _progress.add();
 
         // forward iteraion part
         factor = prob / (1-prob);
@@ -161,14 +196,8 @@ vector<double> Convolution::run_omp(vector<double>& data_in) {
 
         // normalizing data
         data_out[j] = sum / binomNormalization_const;
-        if(j % step == 0) {
-            cout << "\33[2K"; // erase the current line
-            cout << '\r'; // return the cursor to the start of the line
-//            cout << "row " << j << " ";
-            cout << "progress " << j * 100 / double(N) << " %";
-            std::fflush(stdout);
-        }
 
+    }
     }
     auto t1 = chrono::system_clock::now();
     _time_elapsed_convolution = chrono::duration<double>(t1 - t0).count();
@@ -187,8 +216,9 @@ vector<double> Convolution::run_acc(vector<double>& data_in) {
     initialize(N);
 
     vector<double> data_out(N);
+    _progress.reset(N);
+    ProgressReporter reporter(_progress);
     auto t0 = chrono::system_clock::now();
-    long step = N / 1000;
     // entering parallel region
     // take copy of arrays to each loop
 #pragma acc data copy(data_out[0:_number_of_data]) copyin(_forward_factor[0:_number_of_data],_backward_factor[0:_number_of_data],d[0:_number_of_data])
@@ -201,7 +231,7 @@ vector<double> Convolution::run_acc(vector<double>& data_in) {
         double prev     = 0;
         double binomNormalization_const = 1;
         double sum      = data_in[j];
-        ++_count;
+        _progress.add();
 
         // forward iteraion part
         factor = prob / (1-prob);
@@ -229,13 +259,6 @@ vector<double> Convolution::run_acc(vector<double>& data_in) {
 
         // normalizing data
         data_out[j] = sum / binomNormalization_const;
-        if(j % step == 0) {
-            cout << "\33[2K"; // erase the current line
-            cout << '\r'; // return the cursor to the start of the line
-//            cout << "row " << j << " ";
-            cout << "progress " << j * 100 / double(N) << " %";
-            std::fflush(stdout);
-        }
 
     }
     auto t1 = chrono::system_clock::now();
@@ -255,46 +278,15 @@ vector<double> Convolution::run_pthread(vector<double> &data_in) {
     initialize(N);
     vector<double> data_out(N);
 
-    size_t number_of_threads = std::thread::hardware_concurrency(); // number of threads
-    size_t loop_per_thread = N / number_of_threads;
-    vector<thread> threads(number_of_threads); // holds the threads
-    size_t start, stop;
+    // every row costs the same in the full convolution. a few ranges per thread to balance the end
+    auto bounds = cost_partition(N, -1, size_t(_number_of_threads) * RANGES_PER_THREAD);
 
+    _progress.reset(N);
+    ProgressReporter reporter(_progress);
     auto t0 = chrono::system_clock::now();
-    for(size_t i{}; i != number_of_threads; ++i){
-        start = i*loop_per_thread;
-        stop = (i+1) * loop_per_thread;
-         ////each thread finishes independently
-        threads[i] = std::thread(
-                &Convolution::convolution_single_range,
-                this,
-                start,
-                stop,
-                std::ref(data_in),
-                std::ref(data_out)
-        );
-        cout << "thread " << i << " : id " << threads[i].get_id() << " range " << start << " to " << stop << endl;
-
-    }
-    // join the threads
-//    double prgrss{};
-//    while (true){
-//
-//        prgrss = progress();
-//        cout << "progress " << prgrss << endl;
-//        if (prgrss > 0.99){
-//            break;
-//        }
-//        std::this_thread::sleep_for(std::chrono::duration<double>(5));
-//    }
-
-    for(size_t i{}; i != number_of_threads; ++i){
-        if(threads[i].joinable())
-        {
-            cout << "joining thread " << i << " : id " << threads[i].get_id() << endl;
-            threads[i].join();
-        }
-    }
+    task_pool().parallel_ranges(bounds, [&](long start, long stop){
+        convolution_single_range(start, stop, data_in, data_out);
+    }, _number_of_threads);
 
     auto t1 = chrono::system_clock::now();
     _time_elapsed_convolution = chrono::duration<double>(t1 - t0).count();
@@ -314,6 +306,7 @@ void Convolution::convolution_single_range(
         const vector<double> &data_in,
         vector<double> &data_out
 ) {
+    TraceScope trace("rows", row_start, row_stop);
     for (long j=row_start; j < row_stop; ++j)
     {
         double prob     = (double) j / N;
@@ -322,7 +315,6 @@ void Convolution::convolution_single_range(
         double prev     = 0;
         double binomNormalization_const = 1;
         double sum      = data_in[j];
-        ++_count; // only to keep track of % progress
 
         // forward iteraion part
         factor = prob / (1-prob);
@@ -352,6 +344,7 @@ void Convolution::convolution_single_range(
         data_out[j] = sum / binomNormalization_const;
 
     }
+    _progress.add(row_stop - row_start);
 
 }
 
@@ -379,20 +372,20 @@ std::vector<std::vector<double>> Convolution::run_multi(vector<vector<double>> &
 //    cout << "cols " << n_columns << endl;
 
     initialize(n_rows);
-    vector<vector<double>> data_out(n_rows);
+    vector<vector<double>> data_out = allocate_rows(n_rows, n_columns, 1);
+    vector<double> sum(n_columns);
 
-    size_t step = n_rows / 1000;
+    _progress.reset(N);
+    ProgressReporter reporter(_progress);
     auto t0 = chrono::system_clock::now();
     for (long row=0; row < n_rows; ++row){
-        data_out[row].resize(n_columns); // space for columns
         double prob     = (double) row / n_rows;
         double factor   = 0;
         double binom    = 0;
         double prev     = 0;
         double binomNormalization_const = 1;
-        ++_count;
+        _progress.add();
 
-        vector<double> sum(n_columns);
         for(size_t k{}; k < n_columns; ++k){
             sum[k] = data_in[row][k];
         }
@@ -432,13 +425,6 @@ std::vector<std::vector<double>> Convolution::run_multi(vector<vector<double>> &
             data_out[row][j] = sum[j] / binomNormalization_const;
 //            cout << "j " << j << endl;
         }
-        if(row % step == 0) {
-            cout << "\33[2K"; // erase the current line
-            cout << '\r'; // return the cursor to the start of the line
-//            cout << "row " << row << " ";
-            cout << "progress " << row * 100 / double(n_rows) << " %";
-            std::fflush(stdout);
-        }
     }
     auto t1 = chrono::system_clock::now();
     _time_elapsed_convolution = chrono::duration<double>(t1 - t0).count();
@@ -448,7 +434,7 @@ std::vector<std::vector<double>> Convolution::run_multi(vector<vector<double>> &
 
 /**
  * Run convolution on array of multiple columns of data
- * OpenMP version
+ * OpenMP version (or tasks, see `set_parallel_backend`). Short and wide tables are split by columns too
  * @param data_in : n-dimensional array of double valued data
  *      for example: following data has 3 columns and N rows
  *              0.25    0.454   0.548
@@ -464,79 +450,8 @@ std::vector<std::vector<double>> Convolution::run_multi(vector<vector<double>> &
  * @return     : n-dimensional array of double valued convolved data
  */
 std::vector<std::vector<double>> Convolution::run_multi_omp(vector<vector<double>> &data_in) {
-    size_t n_columns = data_in[0].size(); // number of columns
-    size_t n_rows = data_in.size(); // number of rows
-
-//    cout << "rows " << n_rows << endl;
-//    cout << "cols " << n_columns << endl;
-
-    initialize(n_rows);
-    vector<vector<double>> data_out(n_rows);
-
-
-    auto t0 = chrono::system_clock::now();
-
-    // entering parallel region
-    cout << endl;
-    long step = n_rows / 1000 + 1;
-#pragma omp parallel for schedule(dynamic) num_threads(_number_of_threads)
-    for (long row=0; row < n_rows; ++row){
-//        cout << "Threads " << omp_get_num_threads() << endl;
-        data_out[row].resize(n_columns); // space for columns
-        double prob     = (double) row / n_rows;
-        double factor   = 0;
-        double binom    = 0;
-        double prev     = 0;
-        double binomNormalization_const = 1;
-
-        vector<double> sum(n_columns);
-        for(size_t k{}; k < n_columns; ++k){
-            sum[k] = data_in[row][k];
-        }
-
-
-        // forward iteration part
-        factor = prob / (1-prob);
-        prev   = 1;
-
-        for (long i=row+1; i < n_rows; ++i)
-        {
-            binom     = prev * _forward_factor[i] * factor;
-            binomNormalization_const += binom;
-            for(size_t j{}; j < n_columns; ++j){
-                sum[j] += data_in[i][j] * binom;
-            }
-            prev      = binom;
-        }
-        // backward iteration part
-        factor = (1-prob)/prob;
-        prev   = 1;
-
-        for (long i=row-1; i>=0; --i)
-        {
-            binom     = prev * _backward_factor[i] * factor;
-            binomNormalization_const += binom;
-            for(size_t j{}; j < n_columns; ++j){
-                sum[j] += data_in[i][j] * binom;
-            }
-            prev      = binom;
-        }
-        // normalizing data
-        for(size_t j{}; j < n_columns; ++j){
-            data_out[row][j] = sum[j] / binomNormalization_const;
-        }
-        if(row % step == 0) {
-            cout << "\33[2K"; // erase the current line
-            cout << '\r'; // return the cursor to the start of the line
-            cout << "progress " << row * 100 / double(n_rows) << " %";
-            std::fflush(stdout);
-        }
-
-    }
-    auto t1 = chrono::system_clock::now();
-    _time_elapsed_convolution = chrono::duration<double>(t1 - t0).count();
-    cout << endl;
-    return data_out;
+    // full convolution on tiles of rows and columns. see `run_multi_fast`, which builds the weights
+    return run_multi_fast(data_in, -1);
 }
 
 std::vector<std::vector<double>> Convolution::run_multi_omp_v2(vector<vector<double>> &data_in) {
@@ -547,44 +462,41 @@ std::vector<std::vector<double>> Convolution::run_multi_omp_v2(vector<vector<dou
 //    cout << "cols " << n_columns << endl;
 
     initialize(n_rows);
-    vector<vector<double>> data_out(n_rows);
+    vector<vector<double>> data_out = allocate_rows(n_rows, n_columns, _number_of_threads);
+    ScratchArena scratch(n_columns);
 
 
+    _progress.reset(n_rows);
+    ProgressReporter reporter(_progress);
     auto t0 = chrono::system_clock::now();
 
-    // entering parallel region
-    cout << endl;
-    long step = n_rows / 1000 + 1;
-#pragma omp parallel for schedule(dynamic) num_threads(_number_of_threads)
-    for (long row=0; row < n_rows; ++row){
+    // entering parallel region. one range of rows per thread, as schedule(static) splits them
+    auto bounds = cost_partition(n_rows, -1, size_t(_number_of_threads));
+#pragma omp parallel for schedule(static) num_threads(_number_of_threads)
+    for (long range=0; range < long(bounds.size()) - 1; ++range){
+    TraceScope trace("rows", bounds[range], bounds[range+1]);
+    for (long row=bounds[range]; row < bounds[range+1]; ++row){
 //        cout << "Threads " << omp_get_num_threads() << endl;
-        data_out[row].resize(n_columns); // space for columns
-
-        vector<double> sum;
+        double* sum = scratch.local();
         double binomNormalization_const = compute_for_row(data_in, n_columns, n_rows, row, sum);
 
         // normalizing data
         for(size_t j{}; j < n_columns; ++j){
             data_out[row][j] = sum[j] / binomNormalization_const;
         }
-        if(row % step == 0) {
-            cout << "\33[2K"; // erase the current line
-            cout << '\r'; // return the cursor to the start of the line
-            cout << "progress " << row * 100 / double(n_rows) << " %";
-            std::fflush(stdout);
-        }
+        _progress.add();
 
+    }
     }
     auto t1 = chrono::system_clock::now();
     _time_elapsed_convolution = chrono::duration<double>(t1 - t0).count();
-    cout << endl;
     return data_out;
 }
 
 double Convolution::compute_for_row(
         const vector<vector<double>> &data_in,
         size_t n_columns, size_t n_rows,
-        long row, vector<double> &sum) const {
+        long row, double* sum) const {
     double binomNormalization_const = 1;
     double prob     = (double) row / n_rows;
     double factor   = 0;
@@ -643,61 +555,122 @@ double Convolution::compute_for_row(
  * @return     : n-dimensional array of double valued convolved data
  */
 std::vector<std::vector<double>> Convolution::run_multi_pthread(vector<vector<double>> &data_in) {
-    size_t n_columns = data_in[0].size(); // number of columns
     size_t n_rows = data_in.size(); // number of rows
 
-//    cout << "rows " << n_rows << endl;
-//    cout << "cols " << n_columns << endl;
     initialize(n_rows);
 
-    vector<vector<double>> data_out(n_rows);
-
-    size_t step = n_rows / 1000;
+    vector<vector<double>> data_out = allocate_rows(n_rows, data_in[0].size(), _number_of_threads);
+    ScratchArena scratch(data_in[0].size());
 
-    size_t number_of_threads = std::thread::hardware_concurrency(); // number of threads
-    size_t loop_per_thread = N / number_of_threads;
-    vector<thread> threads(number_of_threads); // holds the threads
-    size_t start, stop;
+    // every row costs the same in the full convolution. a few ranges per thread to balance the end
+    auto bounds = cost_partition(N, -1, size_t(_number_of_threads) * RANGES_PER_THREAD);
 
+    _progress.reset(N);
+    ProgressReporter reporter(_progress);
     auto t0 = chrono::system_clock::now();
-    for(size_t i{}; i != number_of_threads; ++i){
-        start = loop_per_thread * i;
-        stop  = loop_per_thread * (i+1);
-        ////each thread finishes independently
-        threads[i] = std::thread(
-                &Convolution::convolution_multi_range,
-                this,
-                start,
-                stop,
-                std::ref(data_in),
-                std::ref(data_out)
-        );
-        cout << "thread " << i << " : id " << threads[i].get_id() << " range " << start << " to " << stop << endl;
+    task_pool().parallel_ranges(bounds, [&](long start, long stop){
+        convolution_multi_range(start, stop, data_in, data_out, scratch.local());
+    }, _number_of_threads);
 
-    }
+    auto t1 = chrono::system_clock::now();
+    _time_elapsed_convolution = chrono::duration<double>(t1 - t0).count();
+    return data_out;
+}
 
-    // join the threads
-//    double prgrss{};
-//    while (true){
-//
-//        prgrss = progress();
-//        cout << "progress " << prgrss << endl;
-//        if (prgrss > 0.99){
-//            break;
-//        }
-//        std::this_thread::sleep_for(std::chrono::duration<double>(5));
-//    }
+/**
+ * Run convolution on array of multiple columns of data with the selected parallel backend,
+ * OpenMP or the process-wide task pool (see `set_parallel_backend`).
+ * Same values as `convolve_2d_fast` (`convolve_2d` for a negative threshold) with the same arguments.
+ * @param data_in   : n-dimensional array of double valued data. see `run_multi`
+ * @param threshold : loops over rows stop once the weight drops below `threshold`.
+ *                    negative value performs the full convolution
+ * @return     : n-dimensional array of double valued convolved data
+ */
+std::vector<std::vector<double>> Convolution::run_multi_fast(vector<vector<double>> &data_in, double threshold) {
+    size_t n_rows = data_in.size(); // number of rows
+    PhaseTimer weights_timer("weights");
+    auto t_init = chrono::system_clock::now();
+    BinomialKernel kernel(n_rows, threshold);
+    _time_elapsed_initialization = chrono::duration<double>(chrono::system_clock::now() - t_init).count();
+    weights_timer.stop();
+    vector<vector<double>> data_out(n_rows);
 
-    for(size_t i{}; i != number_of_threads; ++i){
-        if(threads[i].joinable())
-        {
-            cout << "joining thread " << i << " : id " << threads[i].get_id() << endl;
-            threads[i].join();
-        }
+    size_t n_columns = n_rows > 0 ? data_in[0].size() : 0;
+
+    // tiles of a range of rows by a panel of columns. row ranges have equal cost, since rows in the middle
+    // have much wider kernels than rows at the ends. panels only when there are too few rows for the threads
+    Tiles tiles = choose_tiles(n_rows, n_columns, threshold, size_t(_number_of_threads) * RANGES_PER_THREAD);
+    auto row_bounds = cost_partition(n_rows, threshold, tiles.row_ranges);
+    long n_tiles = long(tiles.row_ranges * tiles.column_panels);
+    vector<long> tile_bounds(n_tiles + 1);
+    for(long t{}; t <= n_tiles; ++t) tile_bounds[t] = t;
+
+    // with a NUMA policy every tile runs on the same thread in all the passes below, so that the rows
+    // are placed on the NUMA node of the thread that convolves them. otherwise on any thread that is free
+    bool placed = numa_policy() != NumaPolicy::off;
+    auto for_tiles = [&](const std::function<void(long, long)>& body){
+        if(placed) parallel_ranges_static(tile_bounds, _number_of_threads, body);
+        else parallel_ranges(tile_bounds, _number_of_threads, body);
+    };
+    // rows of a range are touched first by the thread of its first panel.
+    // all columns at once, since panels of a row are written by different threads
+    auto for_rows = [&](const std::function<void(long)>& body){
+        for_tiles([&](long first, long last){
+            for(long t{first}; t < last; ++t){
+                if(size_t(t) % tiles.column_panels != 0) continue;
+                size_t range = size_t(t) / tiles.column_panels;
+                for(long row{row_bounds[range]}; row < row_bounds[range+1]; ++row) body(row);
+            }
+        });
+    };
+    // rows are allocated by the threads that convolve them
+    for_rows([&](long row){ data_out[row].resize(n_columns);});
+    // input next to the threads that read it. see `set_numa_policy`
+    const vector<vector<double>>* input = &data_in;
+    vector<vector<double>> local_input;
+    vector<vector<vector<double>>> replicas;
+    if(numa_policy() == NumaPolicy::first_touch){
+        local_input.resize(n_rows);
+        for_rows([&](long row){ local_input[row] = data_in[row];});
+        input = &local_input;
+    }else if(numa_policy() == NumaPolicy::replicate && NumaTopology::system().nodes() > 1){
+        replicas = replicate_per_node(data_in);
     }
+    // a row of a tile is a part of the row when it is split in panels
+    _progress.reset(n_rows, tiles.column_panels);
+    ProgressReporter reporter(_progress);
+
+    auto t0 = chrono::system_clock::now();
+    ScratchArena scratch(n_columns);
+    std::atomic<size_t> weights{};
+    std::atomic<size_t> flops{};
+    for_tiles([&](long first, long last){
+        double* sum = scratch.local();
+        size_t range_weights{};
+        size_t range_flops{};
+        const auto& rows = replicas.empty() ? *input : replicas[current_numa_node()];
+        for(long t{first}; t < last; ++t){
+            size_t range = size_t(t) / tiles.column_panels;
+            size_t panel = size_t(t) % tiles.column_panels;
+            size_t first_column = panel_begin(n_columns, tiles.column_panels, panel);
+            size_t last_column = panel_begin(n_columns, tiles.column_panels, panel + 1);
+            TraceScope trace("rows", row_bounds[range], row_bounds[range+1]);
+            for(long row{row_bounds[range]}; row < row_bounds[range+1]; ++row){
+                size_t w = kernel.convolve_row(rows, row, first_column, last_column, sum, data_out[row]);
+                range_weights += w;
+                range_flops += w * (3 + 2 * (last_column - first_column)) + (last_column - first_column);
+                _progress.add();
+            }
+        }
+        weights += range_weights;
+        flops += range_flops;
+    });
+    _weights_evaluated = weights;
+    _flops = flops;
 
     auto t1 = chrono::system_clock::now();
     _time_elapsed_convolution = chrono::duration<double>(t1 - t0).count();
+    sample_huge_pages(); // the kernel is still allocated
     return data_out;
 }
 
@@ -705,20 +678,18 @@ void Convolution::convolution_multi_range(
         long row_start,
         long row_stop,
         const std::vector<std::vector<double>>  &data_in,
-        std::vector<std::vector<double>> &data_out
+        std::vector<std::vector<double>> &data_out,
+        double* sum
 ) {
+    TraceScope trace("rows", row_start, row_stop);
     size_t n_columns = data_in[0].size(); // number of columns
     size_t n_rows = data_in.size(); // number of rows
     for (long row=row_start; row < row_stop; ++row){
-        data_out[row].resize(n_columns); // space for columns
         double prob     = (double) row / n_rows;
         double factor   = 0;
         double binom    = 0;
         double prev     = 0;
         double binomNormalization_const = 1;
-        ++_count;
-
-        vector<double> sum(n_columns);
 
         for(size_t k{}; k < n_columns; ++k){
             sum[k] = data_in[row][k];
@@ -761,6 +732,7 @@ void Convolution::convolution_multi_range(
         }
 
     }
+    _progress.add(row_stop - row_start);
 
 }
 
@@ -769,9 +741,13 @@ void Convolution::convolution_multi_range(
  **************************************/
 std::vector<double> convolve_1d(std::vector<double> &data_in, int thread_count) {
     size_t N = data_in.size();
+    PhaseTimer timer("convolve_1d", thread_count);
+    timer.rows(N);
+    timer.weights(N > 0 ? N * (N - 1) : 0);
+    timer.flops(N > 0 ? N * (N - 1) * 5 + N : 0);
 
-    std::vector<double> _forward_factor(N);
-    std::vector<double> _backward_factor(N);
+    HugeVector<double> _forward_factor(N);
+    HugeVector<double> _backward_factor(N);
 
     for (size_t i=0; i < N; ++i)
     {
@@ -780,16 +756,21 @@ std::vector<double> convolve_1d(std::vector<double> &data_in, int thread_count)
     }
 
     vector<double> data_out(N);
-    auto t0 = chrono::system_clock::now();
-    long step = N / 1000;
+    ProgressCounter progress(N);
+    ProgressReporter reporter(progress);
     // entering parallel region
 #ifdef _OPENACC
 #pragma acc data copy(data_out[0:_number_of_data]) copyin(_forward_factor[0:_number_of_data],_backward_factor[0:_number_of_data],d[0:_number_of_data])
 #pragma acc parallel loop independent
+    for (long j=0; j <N; ++j)
 #else
-#pragma omp parallel for schedule(dynamic) num_threads(thread_count)
+    // one range of rows per thread, as schedule(static) splits them
+    auto bounds = cost_partition(N, -1, size_t(max(1, thread_count)));
+#pragma omp parallel for schedule(static) num_threads(thread_count)
+    for (long range=0; range < long(bounds.size()) - 1; ++range){
+    TraceScope trace("rows", bounds[range], bounds[range+1]);
+    for (long j=bounds[range]; j < bounds[range+1]; ++j)
 #endif
-    for (long j=0; j <N; ++j)
     {
         double prob     = (double) j / N;
         double factor   = 0;
@@ -835,15 +816,12 @@ std::vector<double> convolve_1d(std::vector<double> &data_in, int thread_count)
         log->addText(v);
 #endif
         data_out[j] = sum / binomNormalization_const;
-        if(j % step == 0) {
-            cout << "\33[2K"; // erase the current line
-            cout << '\r'; // return the cursor to the start of the line
-//            cout << "row " << j << " ";
-            cout << "progress " << j * 100 / double(N) << " %";
-            std::fflush(stdout);
-        }
+        progress.add();
 
     }
+#ifndef _OPENACC
+    }
+#endif
 
     return data_out;
 }
@@ -851,12 +829,16 @@ std::vector<double> convolve_1d(std::vector<double> &data_in, int thread_count)
 std::vector<std::vector<double>> convolve_2d(std::vector<std::vector<double>> &data_in, int thread_count) {
     size_t n_columns = data_in[0].size(); // number of columns
     size_t n_rows = data_in.size(); // number of rows
+    PhaseTimer timer("convolve_2d", thread_count);
+    timer.rows(n_rows);
+    timer.weights(n_rows > 0 ? n_rows * (n_rows - 1) : 0);
+    timer.flops(n_rows > 0 ? n_rows * (n_rows - 1) * (3 + 2 * n_columns) + n_rows * n_columns : 0);
 
 //    cout << "rows " << n_rows << endl;
 //    cout << "cols " << n_columns << endl;
 
-    std::vector<double> _forward_factor(n_rows);
-    std::vector<double> _backward_factor(n_rows);
+    HugeVector<double> _forward_factor(n_rows);
+    HugeVector<double> _backward_factor(n_rows);
 
     for (size_t i=0; i < n_rows; ++i)
     {
@@ -864,29 +846,34 @@ std::vector<std::vector<double>> convolve_2d(std::vector<std::vector<double>> &d
         _backward_factor[i] = (double) (i + 1) / (n_rows - i);
     }
 
-    vector<vector<double>> data_out(n_rows);
+    vector<vector<double>> data_out = allocate_rows(n_rows, n_columns, thread_count);
+    ScratchArena scratch(n_columns);
 
 
+    ProgressCounter progress(n_rows);
+    ProgressReporter reporter(progress);
     // entering parallel region
-    cout << endl;
-    long step = n_rows / 1000 + 1;
 
 #ifdef _OPENACC
     #pragma acc data copy(data_out[0:_number_of_data]) copyin(_forward_factor[0:_number_of_data],_backward_factor[0:_number_of_data],d[0:_number_of_data])
 #pragma acc parallel loop independent
+    for (long row=0; row < n_rows; ++row){
 #else
-#pragma omp parallel for schedule(dynamic) num_threads(thread_count)
+    // one range of rows per thread, as schedule(static) splits them
+    auto bounds = cost_partition(n_rows, -1, size_t(max(1, thread_count)));
+#pragma omp parallel for schedule(static) num_threads(thread_count)
+    for (long range=0; range < long(bounds.size()) - 1; ++range){
+    TraceScope trace("rows", bounds[range], bounds[range+1]);
+    for (long row=bounds[range]; row < bounds[range+1]; ++row){
 #endif
-    for (long row=0; row < n_rows; ++row){
 //        cout << "Threads " << omp_get_num_threads() << endl;
-        data_out[row].resize(n_columns); // space for columns
         double prob     = (double) row / n_rows;
         double factor   = 0;
         double binom    = 0;
         double prev     = 0;
         double binomNormalization_const = 1;
 
-        vector<double> sum(n_columns);
+        double* sum = scratch.local();
         for(size_t k{}; k < n_columns; ++k){
             sum[k] = data_in[row][k];
         }
@@ -922,16 +909,13 @@ std::vector<std::vector<double>> convolve_2d(std::vector<std::vector<double>> &d
         for(size_t j{}; j < n_columns; ++j){
             data_out[row][j] = sum[j] / binomNormalization_const;
         }
-        if(row % step == 0) {
-            cout << "\33[2K"; // erase the current line
-            cout << '\r'; // return the cursor to the start of the line
-            cout << "progress " << row * 100 / double(n_rows) << " %";
-            std::fflush(stdout);
-        }
+        progress.add();
 
     }
+#ifndef _OPENACC
+    }
+#endif
 
-    cout << endl;
     return data_out;
 
 }
@@ -950,9 +934,11 @@ std::vector<double> convolve_1d_fast(
         std::vector<double> &data_in, int thread_count, double threshold
 ) {
     size_t N = data_in.size();
+    PhaseTimer timer("convolve_1d_fast", thread_count);
+    timer.rows(N);
 
-    std::vector<double> _forward_factor(N);
-    std::vector<double> _backward_factor(N);
+    HugeVector<double> _forward_factor(N);
+    HugeVector<double> _backward_factor(N);
 
     for (size_t i=0; i < N; ++i)
     {
@@ -961,16 +947,21 @@ std::vector<double> convolve_1d_fast(
     }
 
     vector<double> data_out(N);
-    auto t0 = chrono::system_clock::now();
-    long step = N / 1000;
+    ProgressCounter progress(N);
+    ProgressReporter reporter(progress);
     // entering parallel region
 #ifdef _OPENACC
     #pragma acc data copy(data_out[0:_number_of_data]) copyin(_forward_factor[0:_number_of_data],_backward_factor[0:_number_of_data],d[0:_number_of_data])
 #pragma acc parallel loop independent
+    for (long j=0; j <N; ++j)
 #else
+    // ranges of equal cost. see `cost_partition`
+    auto bounds = cost_partition(N, threshold, size_t(max(1, thread_count)) * RANGES_PER_THREAD);
 #pragma omp parallel for schedule(dynamic) num_threads(thread_count)
+    for (long range=0; range < long(bounds.size()) - 1; ++range){
+    TraceScope trace("rows", bounds[range], bounds[range+1]);
+    for (long j=bounds[range]; j < bounds[range+1]; ++j)
 #endif
-    for (long j=0; j <N; ++j)
     {
         double prob     = (double) j / N;
         double factor   = 0;
@@ -1034,15 +1025,12 @@ std::vector<double> convolve_1d_fast(
         log->addText(v);
 #endif
         data_out[j] = sum / binomNormalization_const;
-        if(j % step == 0) {
-            cout << "\33[2K"; // erase the current line
-            cout << '\r'; // return the cursor to the start of the line
-//            cout << "row " << j << " ";
-            cout << "progress " << j * 100 / double(N) << " %";
-            std::fflush(stdout);
-        }
+        progress.add();
 
     }
+#ifndef _OPENACC
+    }
+#endif
 
     return data_out;
 }
@@ -1052,12 +1040,14 @@ std::vector<std::vector<double>> convolve_2d_fast(
 ) {
     size_t n_columns = data_in[0].size(); // number of columns
     size_t n_rows = data_in.size(); // number of rows
+    PhaseTimer timer("convolve_2d_fast", thread_count);
+    timer.rows(n_rows);
 
 //    cout << "rows " << n_rows << endl;
 //    cout << "cols " << n_columns << endl;
 
-    std::vector<double> _forward_factor(n_rows);
-    std::vector<double> _backward_factor(n_rows);
+    HugeVector<double> _forward_factor(n_rows);
+    HugeVector<double> _backward_factor(n_rows);
 
     for (size_t i=0; i < n_rows; ++i)
     {
@@ -1065,29 +1055,34 @@ std::vector<std::vector<double>> convolve_2d_fast(
         _backward_factor[i] = (double) (i + 1) / (n_rows - i);
     }
 
-    vector<vector<double>> data_out(n_rows);
+    vector<vector<double>> data_out = allocate_rows(n_rows, n_columns, thread_count);
+    ScratchArena scratch(n_columns);
 
 
+    ProgressCounter progress(n_rows);
+    ProgressReporter reporter(progress);
     // entering parallel region
-    cout << endl;
-    long step = n_rows / 1000 + 1;
 
 #ifdef _OPENACC
     #pragma acc data copy(data_out[0:_number_of_data]) copyin(_forward_factor[0:_number_of_data],_backward_factor[0:_number_of_data],d[0:_number_of_data])
 #pragma acc parallel loop independent
+    for (long row=0; row < n_rows; ++row){
 #else
+    // ranges of equal cost. see `cost_partition`
+    auto bounds = cost_partition(n_rows, threshold, size_t(max(1, thread_count)) * RANGES_PER_THREAD);
 #pragma omp parallel for schedule(dynamic) num_threads(thread_count)
+    for (long range=0; range < long(bounds.size()) - 1; ++range){
+    TraceScope trace("rows", bounds[range], bounds[range+1]);
+    for (long row=bounds[range]; row < bounds[range+1]; ++row){
 #endif
-    for (long row=0; row < n_rows; ++row){
 //        cout << "Threads " << omp_get_num_threads() << endl;
-        data_out[row].resize(n_columns); // space for columns
         double prob     = (double) row / n_rows;
         double factor   = 0;
         double binom    = 0;
         double prev     = 0;
         double binomNormalization_const = 1;
 
-        vector<double> sum(n_columns);
+        double* sum = scratch.local();
         for(size_t k{}; k < n_columns; ++k){
             sum[k] = data_in[row][k];
         }
@@ -1139,16 +1134,13 @@ std::vector<std::vector<double>> convolve_2d_fast(
         for(size_t j{}; j < n_columns; ++j){
             data_out[row][j] = sum[j] / binomNormalization_const;
         }
-        if(row % step == 0) {
-            cout << "\33[2K"; // erase the current line
-            cout << '\r'; // return the cursor to the start of the line
-            cout << "progress " << row * 100 / double(n_rows) << " %";
-            std::fflush(stdout);
-        }
+        progress.add();
 
     }
+#ifndef _OPENACC
+    }
+#endif
 
-    cout << endl;
     return data_out;
 
 }
@@ -1173,9 +1165,11 @@ double D_2i(long i, size_t N, double p){
  */
 std::vector<double> convolve_1d_fast_diff(std::vector<double> &data_in, int thread_count, int diff, double threshold) {
     size_t N = data_in.size();
+    PhaseTimer timer("convolve_1d_fast_diff", thread_count);
+    timer.rows(N);
 
-    std::vector<double> _forward_factor(N);
-    std::vector<double> _backward_factor(N);
+    HugeVector<double> _forward_factor(N);
+    HugeVector<double> _backward_factor(N);
 
     for (size_t i=0; i < N; ++i)
     {
@@ -1184,16 +1178,21 @@ std::vector<double> convolve_1d_fast_diff(std::vector<double> &data_in, int thre
     }
 
     vector<double> data_out(N);
-    auto t0 = chrono::system_clock::now();
-    long step = N / 1000;
+    ProgressCounter progress(N);
+    ProgressReporter reporter(progress);
     // entering parallel region
 #ifdef _OPENACC
     #pragma acc data copy(data_out[0:_number_of_data]) copyin(_forward_factor[0:_number_of_data],_backward_factor[0:_number_of_data],d[0:_number_of_data])
 #pragma acc parallel loop independent
+    for (long j=0; j <N; ++j)
 #else
+    // ranges of equal cost. see `cost_partition`
+    auto bounds = cost_partition(N, threshold, size_t(max(1, thread_count)) * RANGES_PER_THREAD);
 #pragma omp parallel for schedule(dynamic) num_threads(thread_count)
+    for (long range=0; range < long(bounds.size()) - 1; ++range){
+    TraceScope trace("rows", bounds[range], bounds[range+1]);
+    for (long j=bounds[range]; j < bounds[range+1]; ++j)
 #endif
-    for (long j=0; j <N; ++j)
     {
         double prob     = (double) j / N;
         double factor   = 0;
@@ -1269,15 +1268,12 @@ std::vector<double> convolve_1d_fast_diff(std::vector<double> &data_in, int thre
 
         // normalizing data
         data_out[j] = sum / binomNormalization_const;
-        if(j % step == 0) {
-            cout << "\33[2K"; // erase the current line
-            cout << '\r'; // return the cursor to the start of the line
-//            cout << "row " << j << " ";
-            cout << "progress " << j * 100 / double(N) << " %";
-            std::fflush(stdout);
-        }
+        progress.add();
 
     }
+#ifndef _OPENACC
+    }
+#endif
 
     return data_out;
 }
@@ -1286,12 +1282,14 @@ std::vector<std::vector<double>>
 convolve_2d_fast_diff(std::vector<std::vector<double>> &data_in, int thread_count, int diff, double threshold) {
     size_t n_columns = data_in[0].size(); // number of columns
     size_t n_rows = data_in.size(); // number of rows
+    PhaseTimer timer("convolve_2d_fast_diff", thread_count);
+    timer.rows(n_rows);
 
 //    cout << "rows " << n_rows << endl;
 //    cout << "cols " << n_columns << endl;
 
-    std::vector<double> _forward_factor(n_rows);
-    std::vector<double> _backward_factor(n_rows);
+    HugeVector<double> _forward_factor(n_rows);
+    HugeVector<double> _backward_factor(n_rows);
 
     for (size_t i=0; i < n_rows; ++i)
     {
@@ -1299,22 +1297,27 @@ convolve_2d_fast_diff(std::vector<std::vector<double>> &data_in, int thread_coun
         _backward_factor[i] = (double) (i + 1) / (n_rows - i);
     }
 
-    vector<vector<double>> data_out(n_rows);
+    vector<vector<double>> data_out = allocate_rows(n_rows, n_columns, thread_count);
+    ScratchArena scratch(n_columns);
 
 
+    ProgressCounter progress(n_rows);
+    ProgressReporter reporter(progress);
     // entering parallel region
-    cout << endl;
-    long step = n_rows / 1000 + 1;
 
 #ifdef _OPENACC
     #pragma acc data copy(data_out[0:_number_of_data]) copyin(_forward_factor[0:_number_of_data],_backward_factor[0:_number_of_data],d[0:_number_of_data])
 #pragma acc parallel loop independent
+    for (long row=0; row < n_rows; ++row){
 #else
+    // ranges of equal cost. see `cost_partition`
+    auto bounds = cost_partition(n_rows, threshold, size_t(max(1, thread_count)) * RANGES_PER_THREAD);
 #pragma omp parallel for schedule(dynamic) num_threads(thread_count)
+    for (long range=0; range < long(bounds.size()) - 1; ++range){
+    TraceScope trace("rows", bounds[range], bounds[range+1]);
+    for (long row=bounds[range]; row < bounds[range+1]; ++row){
 #endif
-    for (long row=0; row < n_rows; ++row){
 //        cout << "Threads " << omp_get_num_threads() << endl;
-        data_out[row].resize(n_columns); // space for columns
         double prob     = (double) row / n_rows;
         double factor   = 0;
         double binom    = 0;
@@ -1323,7 +1326,7 @@ convolve_2d_fast_diff(std::vector<std::vector<double>> &data_in, int thread_coun
         double multiplier = 0;
         double binomNormalization_const = 1;
 
-        vector<double> sum(n_columns);
+        double* sum = scratch.local();
         for(size_t k{}; k < n_columns; ++k){
             sum[k] = data_in[row][k];
         }
@@ -1398,15 +1401,67 @@ convolve_2d_fast_diff(std::vector<std::vector<double>> &data_in, int thread_coun
         for(size_t j{}; j < n_columns; ++j){
             data_out[row][j] = sum[j] / binomNormalization_const;
         }
-        if(row % step == 0) {
-            cout << "\33[2K"; // erase the current line
-            cout << '\r'; // return the cursor to the start of the line
-            cout << "progress " << row * 100 / double(n_rows) << " %";
-            std::fflush(stdout);
-        }
+        progress.add();
 
     }
+#ifndef _OPENACC
+    }
+#endif
 
-    cout << endl;
     return data_out;
 }
+
+
+/**
+ * @param n_rows    : number of rows of the data to convolve
+ * @param threshold : loops over rows stop once the weight drops below `threshold`.
+ *                    negative value performs the full convolution
+ */
+BinomialKernel::BinomialKernel(size_t n_rows, double threshold)
+        : _n_rows{n_rows}, _threshold{threshold}, _forward_factor(n_rows), _backward_factor(n_rows) {
+    for (size_t i=0; i < n_rows; ++i)
+    {
+        _forward_factor[i]  = (double) (n_rows - i + 1) / i;
+        _backward_factor[i] = (double) (i + 1) / (n_rows - i);
+    }
+}
+
+/**
+ * First input row that contributes to output row `row`, i.e. where the backward loop of
+ * `convolve_row` stops. Only the weights are computed, so it costs a fraction of a row.
+ * @param row : output row
+ * @return : first input row needed
+ */
+long BinomialKernel::first_row(long row) const {
+    double prob   = (double) row / _n_rows;
+    double factor = (1-prob)/prob;
+    double prev   = 1;
+    for (long i=row-1; i >= 0; --i)
+    {
+        prev = prev * _backward_factor[i] * factor; // same order of operations as `convolve_row`
+        if(prev < _threshold){
+            return i;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Last input row that contributes to output row `row`, i.e. where the forward loop of
+ * `convolve_row` stops. Only the weights are computed, so it costs a fraction of a row.
+ * @param row : output row
+ * @return : last input row needed
+ */
+long BinomialKernel::last_row(long row) const {
+    double prob   = (double) row / _n_rows;
+    double factor = prob / (1-prob);
+    double prev   = 1;
+    for (long i=row+1; i < long(_n_rows); ++i)
+    {
+        prev = prev * _forward_factor[i] * factor; // same order of operations as `convolve_row`
+        if(prev <= _threshold){
+            return i;
+        }
+    }
+    return long(_n_rows) - 1;
+}
@@ -7,8 +7,11 @@
 
 #include <vector>
 #include <cstddef>
+#include <algorithm>
 #include <iostream>
 
+#include "../memory/huge_pages.h"
+#include "../io/progress.h"
 
 /**
  * Combitable with OpenMP and OpenACC. Flags must be provided during compiletime
@@ -45,21 +48,23 @@ std::vector<std::vector<double>> convolve_2d_fast_diff(
  * A Class to make using convolution user friendly
  */
 class Convolution{
-    std::vector<double> _forward_factor;
-    std::vector<double> _backward_factor;
+    HugeVector<double> _forward_factor;
+    HugeVector<double> _backward_factor;
     size_t N{};
 
-    double _count{}; // keep record of progress percentage. very useful for multithreaded environment ???
+    ProgressCounter _progress; // rows done by all threads of the current run
     double _time_elapsed_initialization{};
     double _time_elapsed_convolution{};
+    size_t _weights_evaluated{};
+    size_t _flops{};
     int _number_of_threads{1};
 public:
     ~Convolution() = default;
 
     explicit Convolution(int threads=-1);
 
-    std::vector<double> factor_forward() const { return _forward_factor;}
-    std::vector<double> factor_backward() const { return _backward_factor;}
+    std::vector<double> factor_forward() const { return {_forward_factor.begin(), _forward_factor.end()};}
+    std::vector<double> factor_backward() const { return {_backward_factor.begin(), _backward_factor.end()};}
 
     // array of values
     // single column version
@@ -74,13 +79,28 @@ public:
     std::vector<std::vector<double>> run_multi_omp(std::vector<std::vector<double>>& data_in);
     std::vector<std::vector<double>> run_multi_omp_v2(std::vector<std::vector<double>>& data_in);
     std::vector<std::vector<double>> run_multi_pthread(std::vector<std::vector<double>>& data_in);
+    std::vector<std::vector<double>> run_multi_fast(std::vector<std::vector<double>>& data_in, double threshold=1e-15);
+
+    int threads() const { return _number_of_threads;}
+    /**
+     * Binomial weights evaluated by the last run, summed over all rows (and column panels)
+     */
+    size_t weights_evaluated() const { return _weights_evaluated;}
+    /**
+     * Floating point operations of the last `run_multi_fast`: 3 per weight, 2 per weight and column
+     * and a division per value
+     */
+    size_t flops() const { return _flops;}
 
     void timeElapsed() const {
         std::cout << "Initialization time " << _time_elapsed_initialization << " sec" << std::endl;
         std::cout << "Convolution time " << _time_elapsed_convolution << " sec" << std::endl;
     }
 
-    double progress() {return _count/N;}
+    /**
+     * Fraction of the rows of the current (or last) run done. Can be called from any thread during a run
+     */
+    double progress() const {return _progress.fraction();}
 private:
     void initialize(size_t n) ;
 
@@ -88,11 +108,124 @@ private:
                                   std::vector<double> &data_out);
 
     void convolution_multi_range(long row_start, long row_stop, const std::vector<std::vector<double>>  &data_in,
-                                 std::vector<std::vector<double>> &data_out);
+                                 std::vector<std::vector<double>> &data_out, double* sum);
 
     double compute_for_row(const std::vector<std::vector<double>> &data_in, size_t n_columns, size_t n_rows, long row,
-                           std::vector<double> &sum) const;
+                           double* sum) const;
 };
 
 
+/**
+ * Binomial weights of the convolution of a fixed number of rows, computed row by row.
+ * Gives the same values as `convolve_2d_fast` (and `convolve_2d` for a negative threshold),
+ * but a single row can be computed at a time, as soon as the input rows it depends on are known.
+ */
+class BinomialKernel{
+    size_t _n_rows{};
+    double _threshold{};
+    HugeVector<double> _forward_factor;
+    HugeVector<double> _backward_factor;
+public:
+    ~BinomialKernel() = default;
+    BinomialKernel(size_t n_rows, double threshold);
+
+    size_t rows() const { return _n_rows;}
+    double threshold() const { return _threshold;}
+
+    long first_row(long row) const;
+    long last_row(long row) const;
+
+    template <typename Rows>
+    size_t convolve_row(const Rows &data_in, long row, std::vector<double> &sum, std::vector<double> &row_out) const;
+    template <typename Rows>
+    size_t convolve_row(const Rows &data_in, long row, size_t first_column, size_t last_column,
+                        double* sum, std::vector<double> &row_out) const;
+};
+
+/**
+ * Convolve a single row. Same arithmetic as `convolve_2d_fast`, so results are identical.
+ * @param data_in : input rows. `data_in[i]` is row `i`. rows from `first_row(row)` to `last_row(row)` must be filled
+ * @param row     : row to compute
+ * @param sum     : work space. reused between calls to avoid allocation
+ * @param row_out : convolved values of the row
+ * @return : number of weights evaluated
+ */
+template <typename Rows>
+size_t BinomialKernel::convolve_row(const Rows &data_in, long row,
+                                    std::vector<double> &sum, std::vector<double> &row_out) const {
+    size_t n_columns = data_in[row].size();
+    row_out.resize(n_columns);
+    sum.resize(n_columns);
+    return convolve_row(data_in, row, 0, n_columns, sum.data(), row_out);
+}
+
+/**
+ * Convolve the columns [first_column, last_column) of a single row. Columns do not depend on each other,
+ * so a row can be computed in panels of columns by different threads with the same results.
+ * @param data_in      : input rows. see above
+ * @param row          : row to compute
+ * @param first_column : first column to compute
+ * @param last_column  : one past the last column to compute
+ * @param sum          : work space of at least `last_column - first_column` values, e.g. from a `ScratchArena`
+ * @param row_out      : convolved values of the row. must already have all columns
+ * @return : number of weights evaluated
+ */
+template <typename Rows>
+size_t BinomialKernel::convolve_row(const Rows &data_in, long row, size_t first_column, size_t last_column,
+                                    double* sum, std::vector<double> &row_out) const {
+    if(first_column >= last_column) return 0;
+    size_t weights{};
+    size_t width = last_column - first_column;
+    long n_rows = long(_n_rows);
+    double prob     = (double) row / n_rows;
+    double factor   = 0;
+    double binom    = 0;
+    double prev     = 0;
+    double binomNormalization_const = 1;
+
+    const double* center = &data_in[row][first_column];
+    std::copy(center, center + width, sum);
+
+    // forward iteration part
+    factor = prob / (1-prob);
+    prev   = 1;
+    for (long i=row+1; i < n_rows; ++i)
+    {
+        binom     = prev * _forward_factor[i] * factor;
+        binomNormalization_const += binom;
+        ++weights;
+        const double* in = &data_in[i][first_column];
+        for(size_t j{}; j < width; ++j){
+            sum[j] += in[j] * binom;
+        }
+        prev      = binom;
+        if(binom <= _threshold){
+            break;
+        }
+    }
+    // backward iteration part
+    factor = (1-prob)/prob;
+    prev   = 1;
+    for (long i=row-1; i>=0; --i)
+    {
+        binom     = prev * _backward_factor[i] * factor;
+        binomNormalization_const += binom;
+        ++weights;
+        const double* in = &data_in[i][first_column];
+        for(size_t j{}; j < width; ++j){
+            sum[j] += in[j] * binom;
+        }
+        prev      = binom;
+        if(binom < _threshold){
+            break;
+        }
+    }
+    // normalizing data
+    double* out = &row_out[first_column];
+    for(size_t j{}; j < width; ++j){
+        out[j] = sum[j] / binomNormalization_const;
+    }
+    return weights;
+}
+
 #endif //CONVOLUTION_CONVOLUTION_H
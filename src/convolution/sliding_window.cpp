@@ -0,0 +1,65 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#include "sliding_window.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * Forget every row before `row`
+ */
+void RowWindow::drop_before(long row) {
+    while (_first < row && !_rows.empty()){
+        _rows.pop_front();
+        ++_first;
+    }
+}
+
+/**
+ * @param n_rows    : number of rows of the whole stream. weights depend on it
+ * @param threshold : see `convolve_2d_fast`. negative value performs the full convolution,
+ *                    which keeps every row in memory
+ */
+SlidingWindowConvolution::SlidingWindowConvolution(size_t n_rows, double threshold) : _kernel(n_rows, threshold) {}
+
+/**
+ * Next input row of the stream
+ */
+void SlidingWindowConvolution::push(std::vector<double> row) {
+    if(pushed() >= rows()){
+        throw std::runtime_error("more than " + to_string(rows()) + " rows in the input");
+    }
+    _window.push(std::move(row));
+    _max_window = max(_max_window, _window.size());
+}
+
+/**
+ * @return : true if the next output row can be computed
+ */
+bool SlidingWindowConvolution::ready() {
+    if(_next >= long(rows())) return false;
+    if(_next_last < 0) _next_last = _kernel.last_row(_next);
+    return _window.end() > _next_last;
+}
+
+/**
+ * Compute the next output row. Must be `ready()`
+ * @return : convolved values of the row
+ */
+std::vector<double> SlidingWindowConvolution::pop() {
+    vector<double> out;
+    _kernel.convolve_row(_window, _next, _sum, out);
+    ++_next;
+    _next_last = -1;
+    if(_next < long(rows()) && _next - _window.first() >= _check_distance){
+        // `first_row` is where `convolve_row` stops, and it does not decrease with the row
+        _window.drop_before(_kernel.first_row(_next));
+        // window is wider than expected. look again after it has grown as much
+        _check_distance = max(_check_distance, 2 * (_next - _window.first()));
+    }
+    return out;
+}
@@ -0,0 +1,59 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#ifndef CONVOLUTION_SLIDING_WINDOW_H
+#define CONVOLUTION_SLIDING_WINDOW_H
+
+#include <vector>
+#include <deque>
+#include <cstddef>
+
+#include "convolution.h"
+
+/**
+ * Consecutive rows of a stream of rows. Rows are addressed by their index in the stream.
+ */
+class RowWindow{
+    std::deque<std::vector<double>> _rows;
+    long _first{};
+public:
+    const std::vector<double>& operator[](long row) const { return _rows[row - _first];}
+
+    long first() const { return _first;}
+    long end() const { return _first + long(_rows.size());}
+    size_t size() const { return _rows.size();}
+
+    void push(std::vector<double> row) { _rows.push_back(std::move(row));}
+    void drop_before(long row);
+};
+
+/**
+ * Convolution of a stream of rows with a kernel window that slides along the stream.
+ * Rows are pushed one by one and every output row can be taken as soon as the last input row
+ * of its kernel window is pushed. Input rows that no output row needs any more are dropped,
+ * so only about one kernel window of rows is kept in memory.
+ * Values are the same as the ones of `convolve_2d_fast` on the whole data.
+ */
+class SlidingWindowConvolution{
+    BinomialKernel _kernel;
+    RowWindow _window;
+    long _next{};              // next output row
+    long _next_last{-1};       // last input row that `_next` needs. -1 if not known yet
+    long _check_distance{1024};// rows kept behind `_next` before looking for rows to drop
+    std::vector<double> _sum;
+    size_t _max_window{};
+public:
+    ~SlidingWindowConvolution() = default;
+    SlidingWindowConvolution(size_t n_rows, double threshold);
+
+    size_t rows() const { return _kernel.rows();}
+    size_t pushed() const { return size_t(_window.end());}
+    size_t max_window() const { return _max_window;}
+
+    void push(std::vector<double> row);
+    bool ready();
+    std::vector<double> pop();
+};
+
+#endif //CONVOLUTION_SLIDING_WINDOW_H
@@ -0,0 +1,439 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#include "binary_format.h"
+
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace {
+    const char FILE_MAGIC[8] = {'C', 'O', 'N', 'V', 'C', 'O', 'L', 'S'};
+    const char BLOCK_MAGIC[4] = {'C', 'O', 'L', 'B'};
+    const uint32_t FORMAT_VERSION = 1;
+    const size_t FILE_HEADER_SIZE = 32;
+    const size_t BLOCK_HEADER_SIZE = 32;
+    const size_t ALIGNMENT = 64; // every block and every payload starts at a multiple of this
+
+    size_t align_up(size_t n){
+        return (n + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+
+    size_t element_size(ColumnType type){
+        return type == ColumnType::float32 ? sizeof(float) : sizeof(double);
+    }
+
+    bool is_little_endian(){
+        uint16_t x = 1;
+        char c;
+        memcpy(&c, &x, 1);
+        return c == 1;
+    }
+
+    template <typename T>
+    T read_at(const char* p){
+        T x;
+        memcpy(&x, p, sizeof(T));
+        return x;
+    }
+
+    template <typename T>
+    void write_at(char* p, T x){
+        memcpy(p, &x, sizeof(T));
+    }
+
+    size_t block_size(const BinaryColumnOut& column, size_t n_rows, ColumnType type){
+        return align_up(BLOCK_HEADER_SIZE + column.name.size()) + align_up(n_rows * element_size(type));
+    }
+
+    /**
+     * Grows a file to `new_size` and maps [offset, new_size) for writing.
+     * Mapping starts at the page that contains `offset`.
+     */
+    class WritableRegion{
+        char* _base{nullptr};
+        size_t _length{};
+        char* _data{nullptr};
+    public:
+        WritableRegion(int fd, size_t offset, size_t new_size){
+            if(ftruncate(fd, off_t(new_size)) != 0){
+                throw std::runtime_error("Could not resize output file");
+            }
+            size_t page = size_t(sysconf(_SC_PAGESIZE));
+            size_t start = offset / page * page;
+            _length = new_size - start;
+            void* ptr = mmap(nullptr, _length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, off_t(start));
+            if(ptr == MAP_FAILED){
+                throw std::runtime_error("Could not map output file");
+            }
+            _base = static_cast<char*>(ptr);
+            _data = _base + (offset - start);
+        }
+        ~WritableRegion(){
+            munmap(_base, _length);
+        }
+        WritableRegion(const WritableRegion&) = delete;
+        WritableRegion& operator=(const WritableRegion&) = delete;
+
+        char* data() { return _data;}
+        void sync() { msync(_base, _length, MS_SYNC);}
+    };
+
+    /**
+     * Writes one column block at `p` and returns the size of the block
+     */
+    size_t write_block(char* p, const BinaryColumnOut& column, size_t n_rows, ColumnType type){
+        size_t payload_offset = align_up(BLOCK_HEADER_SIZE + column.name.size());
+        memcpy(p, BLOCK_MAGIC, sizeof(BLOCK_MAGIC));
+        write_at<uint32_t>(p + 4, uint32_t(type));
+        write_at<uint64_t>(p + 8, n_rows);
+        write_at<uint32_t>(p + 24, uint32_t(column.name.size()));
+        write_at<uint32_t>(p + 28, uint32_t(payload_offset));
+        memcpy(p + BLOCK_HEADER_SIZE, column.name.data(), column.name.size());
+
+        char* payload = p + payload_offset;
+        const vector<vector<double>>& rows = *column.rows;
+        if(type == ColumnType::float32){
+            auto out = reinterpret_cast<float*>(payload);
+            for(size_t r{}; r < n_rows; ++r) out[r] = float(rows[r][column.index]);
+        }else{
+            auto out = reinterpret_cast<double*>(payload);
+            for(size_t r{}; r < n_rows; ++r) out[r] = rows[r][column.index];
+        }
+        size_t n_bytes = n_rows * element_size(type);
+        write_at<uint64_t>(p + 16, binary_checksum(payload, n_bytes));
+        return payload_offset + align_up(n_bytes);
+    }
+
+    size_t rows_of(const vector<BinaryColumnOut>& columns){
+        if(columns.empty()) return 0;
+        size_t n_rows = columns[0].rows->size();
+        for(auto& c : columns){
+            if(c.rows->size() != n_rows){
+                throw std::invalid_argument("All columns of a binary file must have the same number of rows");
+            }
+        }
+        return n_rows;
+    }
+}
+
+/**
+ * FNV-1a hash over 64 bit little endian words. Remaining bytes are hashed one by one.
+ * Processes 8 bytes per multiplication so it runs at close to memory bandwidth.
+ * @param data     : start of the payload
+ * @param n_bytes  : size of the payload
+ * @return : checksum
+ */
+uint64_t binary_checksum(const char* data, size_t n_bytes){
+    const uint64_t prime = 1099511628211ULL;
+    uint64_t hash = 14695981039346656037ULL;
+    size_t n_words = n_bytes / 8;
+    for(size_t i{}; i < n_words; ++i){
+        hash ^= read_at<uint64_t>(data + 8*i);
+        hash *= prime;
+    }
+    for(size_t i{8*n_words}; i < n_bytes; ++i){
+        hash ^= (unsigned char)data[i];
+        hash *= prime;
+    }
+    return hash;
+}
+
+/**
+ * Check the magic bytes of a file
+ * @param filename : name of the file
+ * @return : true if the file is in the native binary format
+ */
+bool is_binary_file(const std::string& filename){
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0) return false;
+    char magic[sizeof(FILE_MAGIC)];
+    ssize_t n = pread(fd, magic, sizeof(magic), 0);
+    close(fd);
+    return n == ssize_t(sizeof(magic)) && memcmp(magic, FILE_MAGIC, sizeof(magic)) == 0;
+}
+
+/**
+ * Maps the file and locates every column block.
+ * @param filename : name of the file
+ * @param verify   : if true checksum of every column is verified
+ */
+BinaryReader::BinaryReader(const std::string& filename, bool verify) : _file(filename) {
+    if(!is_little_endian()) throw std::runtime_error("binary format is only supported on little endian machines");
+    const char* p = _file.data();
+    size_t size = _file.size();
+    if(size < FILE_HEADER_SIZE || memcmp(p, FILE_MAGIC, sizeof(FILE_MAGIC)) != 0){
+        throw std::runtime_error("Not a binary convolution file " + filename);
+    }
+    uint32_t version = read_at<uint32_t>(p + 8);
+    if(version != FORMAT_VERSION){
+        throw std::runtime_error("Unsupported binary file version " + to_string(version));
+    }
+    uint32_t n_columns = read_at<uint32_t>(p + 12);
+    _n_rows = read_at<uint64_t>(p + 16);
+    uint32_t header_bytes = read_at<uint32_t>(p + 24);
+
+    // key and value pairs
+    if(header_bytes > size - FILE_HEADER_SIZE) throw std::runtime_error("Corrupted binary file header");
+    const char* kv = p + FILE_HEADER_SIZE;
+    const char* kv_end = kv + header_bytes;
+    auto next_string = [&](const char*& q) {
+        if(q + 4 > kv_end) throw std::runtime_error("Corrupted binary file header");
+        uint32_t n = read_at<uint32_t>(q);
+        q += 4;
+        if(q + n > kv_end) throw std::runtime_error("Corrupted binary file header");
+        string s(q, n);
+        q += n;
+        return s;
+    };
+    const char* q = kv;
+    if(header_bytes >= 4) {
+        uint32_t n_pairs = read_at<uint32_t>(q);
+        q += 4;
+        for (uint32_t i{}; i < n_pairs; ++i) {
+            string key = next_string(q);
+            _header[key] = next_string(q);
+        }
+    }
+
+    // column blocks
+    size_t offset = align_up(FILE_HEADER_SIZE + header_bytes);
+    for(uint32_t c{}; c < n_columns; ++c){
+        if(offset > size || BLOCK_HEADER_SIZE > size - offset || memcmp(p + offset, BLOCK_MAGIC, sizeof(BLOCK_MAGIC)) != 0){
+            throw std::runtime_error("Corrupted binary file. column " + to_string(c) + " not found");
+        }
+        const char* b = p + offset;
+        BinaryColumn column;
+        column.type = ColumnType(read_at<uint32_t>(b + 4));
+        if(column.type != ColumnType::float64 && column.type != ColumnType::float32){
+            throw std::runtime_error("Unknown column type in binary file");
+        }
+        uint64_t rows = read_at<uint64_t>(b + 8);
+        column.checksum = read_at<uint64_t>(b + 16);
+        uint32_t name_size = read_at<uint32_t>(b + 24);
+        uint32_t payload_offset = read_at<uint32_t>(b + 28);
+        // sizes are compared against the space left so that a corrupted row count can not overflow
+        size_t left = size - offset;
+        if(rows != _n_rows || payload_offset > left
+           || rows > (left - payload_offset) / element_size(column.type)
+           || BLOCK_HEADER_SIZE + name_size > payload_offset){
+            throw std::runtime_error("Corrupted binary file. column " + to_string(c) + " is truncated");
+        }
+        size_t n_bytes = rows * element_size(column.type);
+        column.name.assign(b + BLOCK_HEADER_SIZE, name_size);
+        column.data = b + payload_offset;
+        if(verify && binary_checksum(column.data, n_bytes) != column.checksum){
+            throw std::runtime_error("Checksum mismatch in column '" + column.name + "'");
+        }
+        _columns.push_back(column);
+        offset += payload_offset + align_up(n_bytes);
+    }
+    _data_end = offset;
+}
+
+double BinaryReader::value(size_t row, size_t col) const {
+    const BinaryColumn& c = _columns[col];
+    if(c.type == ColumnType::float32){
+        return read_at<float>(c.data + row * sizeof(float));
+    }
+    return read_at<double>(c.data + row * sizeof(double));
+}
+
+/**
+ * Values of a single column
+ */
+std::vector<double> BinaryReader::load_column(size_t col) const {
+    vector<double> data(_n_rows);
+    for(size_t r{}; r < _n_rows; ++r){
+        data[r] = value(r, col);
+    }
+    return data;
+}
+
+/**
+ * Reads columns in the row major layout that is returned by `loadtxt`.
+ * The kernels take rows of `vector<double>`, so the mapped columns are copied once
+ * into that layout. Nothing is parsed and only the requested columns are touched,
+ * but the data is held twice while the copy is made.
+ * Columns that do not exist are ignored.
+ * @param usecols : columns to read
+ * @return : data of the columns
+ */
+std::vector<std::vector<double>> BinaryReader::load(const std::vector<int>& usecols) const {
+    vector<int> cols;
+    for(auto c : usecols){
+        if(size_t(c) < _columns.size()) cols.push_back(c);
+    }
+    vector<vector<double>> data(_n_rows);
+#pragma omp parallel for schedule(static)
+    for(long r=0; r < long(_n_rows); ++r){
+        data[r].resize(cols.size());
+        for(size_t k{}; k < cols.size(); ++k){
+            data[r][k] = value(size_t(r), size_t(cols[k]));
+        }
+    }
+    return data;
+}
+
+std::vector<std::string> BinaryReader::names() const {
+    vector<string> n;
+    for(auto& c : _columns) n.push_back(c.name);
+    return n;
+}
+
+/**
+ * Write columns to a new binary file through a memory map.
+ * @param filename : name of the output file
+ * @param header   : key and value pairs, e.g. "length" and "ensemble_size"
+ * @param columns  : columns to write. all must have the same number of rows
+ * @param type     : storage type of the values
+ */
+void savebin(const std::string& filename,
+             const std::map<std::string, std::string>& header,
+             const std::vector<BinaryColumnOut>& columns,
+             ColumnType type){
+    if(!is_little_endian()) throw std::runtime_error("binary format is only supported on little endian machines");
+    size_t n_rows = rows_of(columns);
+
+    size_t header_bytes = 4;
+    for(auto& kv : header){
+        header_bytes += 8 + kv.first.size() + kv.second.size();
+    }
+    size_t total = align_up(FILE_HEADER_SIZE + header_bytes);
+    for(auto& c : columns){
+        total += block_size(c, n_rows, type);
+    }
+
+    int fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) throw std::runtime_error("Could not create file " + filename);
+    try {
+        WritableRegion region(fd, 0, total);
+        char *p = region.data();
+        memcpy(p, FILE_MAGIC, sizeof(FILE_MAGIC));
+        write_at<uint32_t>(p + 8, FORMAT_VERSION);
+        write_at<uint32_t>(p + 12, uint32_t(columns.size()));
+        write_at<uint64_t>(p + 16, n_rows);
+        write_at<uint32_t>(p + 24, uint32_t(header_bytes));
+
+        char *q = p + FILE_HEADER_SIZE;
+        write_at<uint32_t>(q, uint32_t(header.size()));
+        q += 4;
+        for (auto &kv : header) {
+            for (const string *s : {&kv.first, &kv.second}) {
+                write_at<uint32_t>(q, uint32_t(s->size()));
+                memcpy(q + 4, s->data(), s->size());
+                q += 4 + s->size();
+            }
+        }
+
+        size_t offset = align_up(FILE_HEADER_SIZE + header_bytes);
+        for (auto &c : columns) {
+            offset += write_block(p + offset, c, n_rows, type);
+        }
+    }catch (...){
+        close(fd);
+        throw;
+    }
+    close(fd);
+}
+
+/**
+ * Append columns to an existing binary file. Existing data is not touched,
+ * new blocks are written after the last one and the column count is updated afterwards,
+ * so an interrupted append leaves a valid file.
+ * @param filename : name of an existing binary file
+ * @param columns  : columns to append. must have the same number of rows as the file
+ * @param type     : storage type of the values
+ */
+void appendbin(const std::string& filename,
+               const std::vector<BinaryColumnOut>& columns,
+               ColumnType type){
+    size_t n_rows = rows_of(columns);
+    size_t old_size, n_columns;
+    {
+        BinaryReader reader(filename, false);
+        if(!columns.empty() && reader.rows() != n_rows){
+            throw std::invalid_argument("number of rows does not match with " + filename);
+        }
+        n_columns = reader.columns();
+        // anything after the last counted block is left over from an interrupted append
+        old_size = reader.data_end();
+    }
+
+    size_t total = old_size;
+    for(auto& c : columns){
+        total += block_size(c, n_rows, type);
+    }
+    int fd = open(filename.c_str(), O_RDWR);
+    if(fd < 0) throw std::runtime_error("Could not open file " + filename);
+    try {
+        {
+            WritableRegion region(fd, old_size, total);
+            size_t offset{};
+            for (auto &c : columns) {
+                offset += write_block(region.data() + offset, c, n_rows, type);
+            }
+            region.sync();
+        }
+        uint32_t count = uint32_t(n_columns + columns.size());
+        if (pwrite(fd, &count, sizeof(count), 12) != ssize_t(sizeof(count))) {
+            throw std::runtime_error("Could not update column count of " + filename);
+        }
+    }catch (...){
+        close(fd);
+        throw;
+    }
+    close(fd);
+}
+
+/**
+ * Key and value pairs from the header of a text file.
+ * Both the JSON header line and the BEGIN_HEADER ... END_HEADER block are understood.
+ * Whole header text is kept under the key "text_header" so that it can be written back.
+ * @param text_header : lines before the data in a text file
+ * @return : key and value pairs
+ */
+std::map<std::string, std::string> header_from_text(const std::string& text_header){
+    map<string, string> header;
+    istringstream iss(text_header);
+    string line;
+    bool raw_block{false};
+    while (getline(iss, line)){
+        if(!line.empty() && line.back() == '\r') line.pop_back();
+        if(line == "BEGIN_HEADER"){ raw_block = true; continue;}
+        if(line == "END_HEADER"){ raw_block = false; continue;}
+        if(raw_block){
+            istringstream kv(line);
+            string key, value;
+            if(kv >> key >> value) header[key] = value;
+            continue;
+        }
+        size_t a = line.find('{');
+        size_t b = line.rfind('}');
+        if(line.empty() || line[0] == '#' || a == string::npos || b == string::npos || b < a) continue;
+        // {"key":value,...}
+        istringstream pairs(line.substr(a + 1, b - a - 1));
+        string pair;
+        while (getline(pairs, pair, ',')){
+            size_t sep = pair.find(':');
+            if(sep == string::npos) continue;
+            string key = pair.substr(0, sep);
+            string value = pair.substr(sep + 1);
+            key.erase(std::remove(key.begin(), key.end(), '\"'), key.end());
+            key.erase(std::remove(key.begin(), key.end(), ' '), key.end());
+            value.erase(std::remove(value.begin(), value.end(), '\"'), value.end());
+            value.erase(std::remove(value.begin(), value.end(), ' '), value.end());
+            if(!key.empty()) header[key] = value;
+        }
+    }
+    if(!text_header.empty()) header["text_header"] = text_header;
+    return header;
+}
@@ -0,0 +1,86 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#ifndef CONVOLUTION_BINARY_FORMAT_H
+#define CONVOLUTION_BINARY_FORMAT_H
+
+/**
+ * Native binary columnar file format.
+ * Layout is described in Docs/binary-file-format.txt
+ */
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <cstddef>
+
+#include "mapped_file.h"
+
+enum class ColumnType : uint32_t {
+    float64 = 1,
+    float32 = 2
+};
+
+/**
+ * A column of a binary file. `data` points into the memory map of the file
+ */
+struct BinaryColumn{
+    std::string name;
+    ColumnType type{ColumnType::float64};
+    uint64_t checksum{};
+    const char* data{nullptr};
+};
+
+/**
+ * Column to be written. Values are taken from column `index` of the row major `rows`,
+ * which is the layout used by the convolution functions.
+ */
+struct BinaryColumnOut{
+    std::string name;
+    const std::vector<std::vector<double>>* rows;
+    size_t index;
+};
+
+/**
+ * Reads a binary file through a memory map. Nothing is parsed or copied
+ * until the values of a column are requested.
+ */
+class BinaryReader{
+    MappedFile _file;
+    size_t _n_rows{};
+    size_t _data_end{}; // end of the last column block
+    std::map<std::string, std::string> _header;
+    std::vector<BinaryColumn> _columns;
+public:
+    ~BinaryReader() = default;
+    explicit BinaryReader(const std::string& filename, bool verify=true);
+
+    size_t rows() const { return _n_rows;}
+    size_t columns() const { return _columns.size();}
+    size_t data_end() const { return _data_end;}
+    const std::map<std::string, std::string>& header() const { return _header;}
+    const BinaryColumn& column(size_t index) const { return _columns.at(index);}
+
+    double value(size_t row, size_t col) const;
+    std::vector<double> load_column(size_t col) const;
+    std::vector<std::vector<double>> load(const std::vector<int>& usecols) const;
+    std::vector<std::string> names() const;
+};
+
+bool is_binary_file(const std::string& filename);
+
+uint64_t binary_checksum(const char* data, size_t n_bytes);
+
+void savebin(const std::string& filename,
+             const std::map<std::string, std::string>& header,
+             const std::vector<BinaryColumnOut>& columns,
+             ColumnType type=ColumnType::float64);
+
+void appendbin(const std::string& filename,
+               const std::vector<BinaryColumnOut>& columns,
+               ColumnType type=ColumnType::float64);
+
+std::map<std::string, std::string> header_from_text(const std::string& text_header);
+
+#endif //CONVOLUTION_BINARY_FORMAT_H
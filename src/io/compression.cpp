@@ -0,0 +1,362 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#include "compression.h"
+
+#include <vector>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+using namespace std;
+
+namespace {
+    const size_t BUFFER_SIZE = size_t(1) << 18;
+
+#ifdef HAVE_ZLIB
+    /**
+     * gzip (or zlib) stream. Members of a concatenated gzip file are read one after another
+     */
+    class GzipSource : public ByteSource{
+        unique_ptr<ByteSource> _source;
+        z_stream _stream{};
+        vector<char> _input;
+        bool _source_done{false};
+        bool _done{false};
+    public:
+        ~GzipSource() override { inflateEnd(&_stream);}
+        explicit GzipSource(unique_ptr<ByteSource> source) : _source(std::move(source)), _input(BUFFER_SIZE) {
+            if(inflateInit2(&_stream, 15 + 32) != Z_OK) throw std::runtime_error("could not start gzip decoder");
+        }
+
+        size_t read(char* buffer, size_t size) override {
+            _stream.next_out = reinterpret_cast<Bytef*>(buffer);
+            _stream.avail_out = uInt(size);
+            while (!_done && _stream.avail_out == size){
+                if(_stream.avail_in == 0 && !_source_done){
+                    size_t n = _source->read(_input.data(), _input.size());
+                    if(n == 0) _source_done = true;
+                    _stream.next_in = reinterpret_cast<Bytef*>(_input.data());
+                    _stream.avail_in = uInt(n);
+                }
+                int status = inflate(&_stream, Z_NO_FLUSH);
+                if(status == Z_STREAM_END){
+                    if(_stream.avail_in == 0 && !_source_done){
+                        size_t n = _source->read(_input.data(), _input.size());
+                        if(n == 0) _source_done = true;
+                        _stream.next_in = reinterpret_cast<Bytef*>(_input.data());
+                        _stream.avail_in = uInt(n);
+                    }
+                    if(_stream.avail_in == 0) _done = true;
+                    else inflateReset(&_stream); // next member
+                }else if(status == Z_BUF_ERROR && _source_done && _stream.avail_in == 0){
+                    throw std::runtime_error("gzip input is truncated");
+                }else if(status != Z_OK && status != Z_BUF_ERROR){
+                    throw std::runtime_error(string("gzip input is corrupted: ") + (_stream.msg ? _stream.msg : ""));
+                }
+            }
+            return size - _stream.avail_out;
+        }
+    };
+
+    class GzipSink : public ByteSink{
+        unique_ptr<ByteSink> _sink;
+        z_stream _stream{};
+        vector<char> _output;
+        bool _closed{false};
+
+        void deflate_all(int flush){
+            int status;
+            do{
+                _stream.next_out = reinterpret_cast<Bytef*>(_output.data());
+                _stream.avail_out = uInt(_output.size());
+                status = deflate(&_stream, flush);
+                if(status == Z_STREAM_ERROR) throw std::runtime_error("gzip encoder failed");
+                _sink->write(_output.data(), _output.size() - _stream.avail_out);
+            }while (_stream.avail_out == 0 || (flush == Z_FINISH && status != Z_STREAM_END));
+        }
+    public:
+        ~GzipSink() override { deflateEnd(&_stream);}
+        GzipSink(unique_ptr<ByteSink> sink, int level) : _sink(std::move(sink)), _output(BUFFER_SIZE) {
+            if(deflateInit2(&_stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK){
+                throw std::runtime_error("could not start gzip encoder");
+            }
+        }
+
+        void write(const char* data, size_t size) override {
+            while (size > 0){
+                // avail_in is 32 bit
+                uInt n = uInt(min<size_t>(size, size_t(1) << 30));
+                _stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+                _stream.avail_in = n;
+                deflate_all(Z_NO_FLUSH);
+                data += n;
+                size -= n;
+            }
+        }
+
+        void close() override {
+            if(_closed) return;
+            _closed = true;
+            _stream.avail_in = 0;
+            deflate_all(Z_FINISH);
+            _sink->close();
+        }
+    };
+#endif
+
+#ifdef HAVE_ZSTD
+    class ZstdSource : public ByteSource{
+        unique_ptr<ByteSource> _source;
+        ZSTD_DCtx* _context;
+        vector<char> _input;
+        ZSTD_inBuffer _in{nullptr, 0, 0};
+        bool _source_done{false};
+        size_t _last_status{0}; // 0 once a frame is complete
+    public:
+        ~ZstdSource() override { ZSTD_freeDCtx(_context);}
+        explicit ZstdSource(unique_ptr<ByteSource> source)
+                : _source(std::move(source)), _context(ZSTD_createDCtx()), _input(ZSTD_DStreamInSize()) {
+            if(_context == nullptr) throw std::runtime_error("could not start zstd decoder");
+        }
+
+        size_t read(char* buffer, size_t size) override {
+            ZSTD_outBuffer out{buffer, size, 0};
+            while (out.pos == 0){
+                if(_in.pos == _in.size){
+                    if(_source_done) break;
+                    size_t n = _source->read(_input.data(), _input.size());
+                    if(n == 0){
+                        _source_done = true;
+                        if(_last_status != 0) throw std::runtime_error("zstd input is truncated");
+                        break;
+                    }
+                    _in = {_input.data(), n, 0};
+                }
+                _last_status = ZSTD_decompressStream(_context, &out, &_in);
+                if(ZSTD_isError(_last_status)){
+                    throw std::runtime_error(string("zstd input is corrupted: ") + ZSTD_getErrorName(_last_status));
+                }
+            }
+            return out.pos;
+        }
+    };
+
+    class ZstdSink : public ByteSink{
+        unique_ptr<ByteSink> _sink;
+        ZSTD_CCtx* _context;
+        vector<char> _output;
+        bool _closed{false};
+
+        void compress(ZSTD_inBuffer& in, ZSTD_EndDirective mode){
+            size_t remaining;
+            do{
+                ZSTD_outBuffer out{_output.data(), _output.size(), 0};
+                remaining = ZSTD_compressStream2(_context, &out, &in, mode);
+                if(ZSTD_isError(remaining)){
+                    throw std::runtime_error(string("zstd encoder failed: ") + ZSTD_getErrorName(remaining));
+                }
+                _sink->write(_output.data(), out.pos);
+            }while (mode == ZSTD_e_end ? remaining != 0 : in.pos < in.size);
+        }
+    public:
+        ~ZstdSink() override { ZSTD_freeCCtx(_context);}
+        ZstdSink(unique_ptr<ByteSink> sink, int level)
+                : _sink(std::move(sink)), _context(ZSTD_createCCtx()), _output(ZSTD_CStreamOutSize()) {
+            if(_context == nullptr) throw std::runtime_error("could not start zstd encoder");
+            ZSTD_CCtx_setParameter(_context, ZSTD_c_compressionLevel, level);
+        }
+
+        void write(const char* data, size_t size) override {
+            ZSTD_inBuffer in{data, size, 0};
+            compress(in, ZSTD_e_continue);
+        }
+
+        void close() override {
+            if(_closed) return;
+            _closed = true;
+            ZSTD_inBuffer in{nullptr, 0, 0};
+            compress(in, ZSTD_e_end);
+            _sink->close();
+        }
+    };
+#endif
+}
+
+/**
+ * @param spec : "gzip", "zstd", optionally with a level, e.g. "zstd:3" or "gzip:9". empty for no compression
+ * @return : codec and level. default levels are 6 for gzip and 3 for zstd
+ */
+Compression parse_compression(const std::string& spec){
+    Compression compression;
+    if(spec.empty()) return compression;
+    size_t colon = spec.find(':');
+    string name = spec.substr(0, colon);
+    if(name == "gzip" || name == "gz"){
+        compression = {Codec::gzip, 6};
+    }else if(name == "zstd" || name == "zst"){
+        compression = {Codec::zstd, 3};
+    }else{
+        throw std::invalid_argument("unknown compression " + name + ". use gzip or zstd");
+    }
+    if(colon != string::npos){
+        compression.level = stoi(spec.substr(colon + 1));
+    }
+    if(!codec_available(compression.codec)){
+        throw std::invalid_argument("compiled without support for " + name);
+    }
+    return compression;
+}
+
+/**
+ * Extension that is appended to the name of a compressed file
+ */
+std::string compressed_extension(const Compression& compression){
+    switch (compression.codec){
+        case Codec::gzip: return ".gz";
+        case Codec::zstd: return ".zst";
+        default: return "";
+    }
+}
+
+/**
+ * Codec of a stream from its first bytes
+ * @param magic : first bytes of the stream
+ * @param size  : number of bytes in `magic`
+ */
+Codec detect_codec(const char* magic, size_t size){
+    auto m = reinterpret_cast<const unsigned char*>(magic);
+    if(size >= 2 && m[0] == 0x1f && m[1] == 0x8b) return Codec::gzip;
+    if(size >= 4 && m[0] == 0x28 && m[1] == 0xb5 && m[2] == 0x2f && m[3] == 0xfd) return Codec::zstd;
+    return Codec::none;
+}
+
+bool codec_available(Codec codec){
+    switch (codec){
+#ifdef HAVE_ZLIB
+        case Codec::gzip: return true;
+#endif
+#ifdef HAVE_ZSTD
+        case Codec::zstd: return true;
+#endif
+        case Codec::none: return true;
+        default: return false;
+    }
+}
+
+/**
+ * Decompress `source`. The decoder runs on its own thread
+ */
+std::unique_ptr<ByteSource> decompressing_source(std::unique_ptr<ByteSource> source, Codec codec){
+    unique_ptr<ByteSource> decoder;
+    switch (codec){
+        case Codec::none:
+            return source;
+#ifdef HAVE_ZLIB
+        case Codec::gzip:
+            decoder.reset(new GzipSource(std::move(source)));
+            break;
+#endif
+#ifdef HAVE_ZSTD
+        case Codec::zstd:
+            decoder.reset(new ZstdSource(std::move(source)));
+            break;
+#endif
+        default:
+            throw std::runtime_error("input is compressed but support for it is not compiled in");
+    }
+    return unique_ptr<ByteSource>(new ThreadedSource(std::move(decoder)));
+}
+
+/**
+ * Compress everything that is written to the returned sink into `sink`
+ */
+std::unique_ptr<ByteSink> compressing_sink(std::unique_ptr<ByteSink> sink, const Compression& compression){
+    switch (compression.codec){
+        case Codec::none:
+            return sink;
+#ifdef HAVE_ZLIB
+        case Codec::gzip:
+            return unique_ptr<ByteSink>(new GzipSink(std::move(sink), compression.level));
+#endif
+#ifdef HAVE_ZSTD
+        case Codec::zstd:
+            return unique_ptr<ByteSink>(new ZstdSink(std::move(sink), compression.level));
+#endif
+        default:
+            throw std::runtime_error("support for the compression is not compiled in");
+    }
+}
+
+/**
+ * @param source     : source to read on a separate thread
+ * @param chunk_size : bytes read at a time
+ * @param capacity   : number of chunks that can be read ahead
+ */
+ThreadedSource::ThreadedSource(std::unique_ptr<ByteSource> source, size_t chunk_size, size_t capacity)
+        : _source(std::move(source)), _chunk_size{chunk_size}, _capacity{capacity} {
+    _thread = std::thread(&ThreadedSource::produce, this);
+}
+
+ThreadedSource::~ThreadedSource() {
+    {
+        lock_guard<mutex> lock(_mutex);
+        _stop = true;
+    }
+    _changed.notify_all();
+    _thread.join();
+}
+
+void ThreadedSource::produce() {
+    try {
+        while (true){
+            string chunk(_chunk_size, '\0');
+            size_t n{};
+            while (n < chunk.size()){
+                size_t r = _source->read(&chunk[n], chunk.size() - n);
+                if(r == 0) break;
+                n += r;
+            }
+            chunk.resize(n);
+            unique_lock<mutex> lock(_mutex);
+            _changed.wait(lock, [&](){ return _stop || _chunks.size() < _capacity;});
+            if(_stop) return;
+            bool end = chunk.empty();
+            _chunks.push_back(std::move(chunk));
+            _changed.notify_all();
+            if(end) return;
+        }
+    } catch (...) {
+        lock_guard<mutex> lock(_mutex);
+        _error = std::current_exception();
+        _chunks.emplace_back();
+        _changed.notify_all();
+    }
+}
+
+size_t ThreadedSource::read(char *buffer, size_t size) {
+    if(_position == _current.size()){
+        unique_lock<mutex> lock(_mutex);
+        _changed.wait(lock, [&](){ return !_chunks.empty();});
+        if(_chunks.front().empty()){
+            // end of the stream stays in the queue
+            if(_error) std::rethrow_exception(_error);
+            return 0;
+        }
+        _current = std::move(_chunks.front());
+        _chunks.pop_front();
+        _position = 0;
+        _changed.notify_all();
+    }
+    size_t n = min(size, _current.size() - _position);
+    memcpy(buffer, _current.data() + _position, n);
+    _position += n;
+    return n;
+}
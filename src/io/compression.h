@@ -0,0 +1,69 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#ifndef CONVOLUTION_COMPRESSION_H
+#define CONVOLUTION_COMPRESSION_H
+
+/**
+ * gzip and zstd streams on top of `ByteSource` and `ByteSink`.
+ * Support for each is compiled in if the library is found (HAVE_ZLIB, HAVE_ZSTD).
+ */
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+
+#include "stream_io.h"
+
+enum class Codec{
+    none,
+    gzip,
+    zstd
+};
+
+/**
+ * Codec and level, e.g. from "zstd:3"
+ */
+struct Compression{
+    Codec codec{Codec::none};
+    int level{};
+};
+
+Compression parse_compression(const std::string& spec);
+std::string compressed_extension(const Compression& compression);
+Codec detect_codec(const char* magic, size_t size);
+bool codec_available(Codec codec);
+
+std::unique_ptr<ByteSource> decompressing_source(std::unique_ptr<ByteSource> source, Codec codec);
+std::unique_ptr<ByteSink> compressing_sink(std::unique_ptr<ByteSink> sink, const Compression& compression);
+
+/**
+ * Reads another source on its own thread, a few chunks ahead of the reader.
+ * Used to decompress on one thread while another thread parses.
+ */
+class ThreadedSource : public ByteSource{
+    std::unique_ptr<ByteSource> _source;
+    size_t _chunk_size;
+    size_t _capacity;
+    std::deque<std::string> _chunks;   // an empty chunk marks the end of the stream
+    std::string _current;
+    size_t _position{};
+    bool _stop{false};
+    std::exception_ptr _error;
+    std::mutex _mutex;
+    std::condition_variable _changed;
+    std::thread _thread;
+
+    void produce();
+public:
+    ~ThreadedSource() override;
+    explicit ThreadedSource(std::unique_ptr<ByteSource> source, size_t chunk_size=size_t(1) << 20, size_t capacity=4);
+
+    size_t read(char* buffer, size_t size) override;
+};
+
+#endif //CONVOLUTION_COMPRESSION_H
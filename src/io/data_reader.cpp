@@ -3,6 +3,12 @@
 //
 
 #include "data_reader.h"
+#include "mapped_file.h"
+#include "run_report.h"
+#include "trace.h"
+#include "stream_io.h"
+#include "compression.h"
+#include "../parallel/parallel.h"
 #include "../tests/test2.h"
 
 #include <iostream>
@@ -10,6 +16,8 @@
 #include <sstream>
 #include <algorithm>
 #include <iomanip>
+#include <cstring>
+#include <omp.h>
 
 
 using namespace std;
@@ -278,6 +286,505 @@ vector<vector<double>> loadtxt_v2(string filename, const vector<int>& usecols,
 }
 
 
+/**
+ * Position of the end of the line that starts at `line`.
+ * @param line : start of the line
+ * @param last : end of the range to scan
+ * @return : position of the '\n' character or `last` if there is none
+ */
+static const char* find_eol(const char* line, const char* last){
+    auto eol = (const char*)memchr(line, '\n', last - line);
+    return eol == nullptr ? last : eol;
+}
+
+/**
+ * Skip `n` lines (commented or uncommented) from the start of the range
+ * @return : start of the first line that is not skipped
+ */
+static const char* skip_lines(const char* first, const char* last, int n){
+    for(int r{}; r < n && first < last; ++r){
+        first = find_eol(first, last) + 1;
+    }
+    return first < last ? first : last;
+}
+
+/**
+ * Empty lines and lines that start with `comment` do not contain data
+ */
+static bool is_data_line(const char* line, const char* eol, char comment){
+    return line < eol && line[0] != comment;
+}
+
+/**
+ * Split a range into `n` byte ranges of roughly equal size.
+ * Every range, except the first one, starts right after a new line character.
+ * @return : n+1 boundaries. ranges that would be empty are dropped
+ */
+static vector<const char*> split_at_newlines(const char* first, const char* last, size_t n){
+    vector<const char*> bounds{first};
+    size_t length = last - first;
+    for(size_t k{1}; k < n; ++k){
+        const char* b = first + length * k / n;
+        if(b <= bounds.back()) continue; // previous line is longer than the chunk
+        b = find_eol(b - 1, last); // line may start exactly at `b`
+        if(b < last) ++b;
+        if(b > bounds.back() && b < last) {
+            bounds.push_back(b);
+        }
+    }
+    bounds.push_back(last);
+    return bounds;
+}
+
+/**
+ * Number of lines containing data in a range
+ */
+static size_t count_data_lines(const char* first, const char* last, char comment){
+    size_t count{};
+    while (first < last){
+        const char* eol = find_eol(first, last);
+        if(is_data_line(first, eol, comment)) ++count;
+        first = eol + 1;
+    }
+    return count;
+}
+
+/**
+ * Check if `delimiter` is used in a line of data.
+ * If it is not, the last of the known delimiters that appears in the line is used.
+ * @param line      : first row of data
+ * @param delimiter : expected delimiter
+ * @return : delimiter that is used
+ */
+static char match_delimiter(const string& line, char delimiter){
+    std::size_t found = line.find(delimiter);
+    if (found!=std::string::npos) {
+        std::cout << "delimiter matched" << found << '\n';
+    }else{
+        std::cout << "delimiter mismatched. finding used delimiter" << '\n';
+        string delimiter_list = " ,\t\v"; // list of delimiters
+        for(auto n:line)
+        {
+            for(auto c: delimiter_list){
+                if(n == c){
+                    cout << "found delimiter is " << int(n) << endl;
+                    delimiter = c;
+                }
+            }
+        }
+    }
+    return delimiter;
+}
+
+/**
+ * Same as atof but on a character range that is not null terminated
+ */
+static double field_to_double(const char* first, const char* last){
+    char buff[64];
+    size_t n = last - first;
+    if(n < sizeof(buff)){
+        memcpy(buff, first, n);
+        buff[n] = '\0';
+        return atof(buff);
+    }
+    return atof(string(first, last).c_str());
+}
+
+/**
+ * Locate the fields of a single line. Follows the same rule as `explode_to_float`,
+ * i.e. consecutive delimiters are treated as one. Nothing is converted here.
+ * @param line      : start of the line
+ * @param eol       : end of the line
+ * @param delimiter : character used as delemeter in the file
+ * @param n_max     : fields after the first `n_max` are not located
+ * @param fields    : begin and end of each field. reused for every line
+ */
+static void split_fields(const char* line, const char* eol, char delimiter,
+                         size_t n_max, vector<const char*>& fields){
+    fields.clear();
+    const char* p = line;
+    while (p < eol && fields.size() < 2*n_max){
+        while (p < eol && *p == delimiter) ++p;
+        if(p == eol) break;
+        auto q = (const char*)memchr(p, delimiter, eol - p);
+        if(q == nullptr) q = eol;
+        fields.push_back(p);
+        fields.push_back(q);
+        p = q;
+    }
+}
+
+/**
+ * Convert only the fields in `usecols` to double. Unused fields are never converted.
+ * @param fields  : located by `split_fields`
+ * @param usecols : columns to read
+ * @param row     : parsed values of the columns
+ */
+static void project_fields(const vector<const char*>& fields, const vector<int>& usecols, vector<double>& row){
+    size_t n_fields = fields.size() / 2;
+    row.clear();
+    row.reserve(usecols.size());
+    for(auto c : usecols){
+        if(size_t(c) < n_fields){
+            row.push_back(field_to_double(fields[2*c], fields[2*c+1]));
+        }
+    }
+}
+
+/**
+ * Number of fields that must be located in a line to read every set of columns
+ */
+static size_t fields_needed(const vector<const vector<int>*>& usecols){
+    size_t n_fields{};
+    for(auto cols : usecols){
+        for(auto c : *cols){
+            if(c >= 0 && size_t(c) + 1 > n_fields) n_fields = size_t(c) + 1;
+        }
+    }
+    return n_fields;
+}
+
+/**
+ * Parse the data lines of a range into consecutive rows of the outputs, starting at `row`.
+ * Each line is split only once for all the sets of columns.
+ * Outputs must already have enough rows.
+ */
+static void parse_range(const char* first, const char* last, char delimiter, char comment, size_t n_fields,
+                        const vector<const vector<int>*>& usecols,
+                        const vector<vector<vector<double>>*>& data,
+                        size_t row){
+    vector<const char*> fields;
+    const char* line = first;
+    while (line < last){
+        const char* eol = find_eol(line, last);
+        if(is_data_line(line, eol, comment)){
+            split_fields(line, eol, delimiter, n_fields, fields);
+            for(size_t s{}; s < usecols.size(); ++s) {
+                project_fields(fields, *usecols[s], (*data[s])[row]);
+            }
+            ++row;
+        }
+        line = eol + 1;
+    }
+}
+
+/**
+ * Parse several sets of columns from a range of text with multiple threads.
+ * The range is split into byte ranges aligned to new lines.
+ * Data rows of each range are counted in parallel first so that the outputs are allocated once,
+ * then every thread parses its own range straight into its block of rows of the outputs.
+ * Each line is split only once for all the sets of columns.
+ * @param first        : start of the first line
+ * @param last         : end of the text
+ * @param delimiter    : character used as delemeter in the text
+ * @param comment      : character used as comment in the text
+ * @param thread_count : number of threads to use
+ * @param usecols      : sets of columns to read
+ * @param data         : one output per set of columns
+ */
+static void parse_columns_parallel(const char* first, const char* last, char delimiter, char comment,
+                                   int thread_count,
+                                   const vector<const vector<int>*>& usecols,
+                                   const vector<vector<vector<double>>*>& data){
+    vector<const char*> bounds = split_at_newlines(first, last, size_t(thread_count));
+    long n_chunks = long(bounds.size()) - 1;
+    size_t n_fields = fields_needed(usecols);
+
+    // counting rows of each chunk so that the output can be allocated at once
+    vector<size_t> offset(n_chunks + 1, 0);
+    parallel_for_each(n_chunks, thread_count, [&](long k){
+        offset[k+1] = count_data_lines(bounds[k], bounds[k+1], comment);
+    });
+    for(long k{}; k < n_chunks; ++k){
+        offset[k+1] += offset[k];
+    }
+
+    for(auto d : data){
+        d->clear();
+        d->resize(offset[n_chunks]);
+    }
+    parallel_for_each(n_chunks, thread_count, [&](long k){
+        parse_range(bounds[k], bounds[k+1], delimiter, comment, n_fields, usecols, data, offset[k]);
+    });
+}
+
+/**
+ * Reads columns of data from files using multiple threads.
+ * The file is memory mapped and split into byte ranges aligned to new lines.
+ * Data rows of each range are counted in parallel first so that the output is allocated once,
+ * then every thread parses its own range straight into its block of rows of the output.
+ * Empty lines are ignored.
+ * @param filename     : name of the file
+ * @param usecols      : columns to read
+ * @param skiprows     : number of rows to be skipped (commented or uncommented)
+ * @param delimiter    : character used as delemeter in the file
+ * @param comment      : character used as comment in the file
+ * @param thread_count : number of threads to use. all available threads if not positive
+ * @return : data of the columns
+ */
+vector<vector<double>> loadtxt_parallel(string filename, const vector<int>& usecols,
+                                        int skiprows, char delimiter, char comment, int thread_count){
+    if(thread_count <= 0) thread_count = omp_get_max_threads();
+    MappedFile file(filename);
+
+    const char* first = skip_lines(file.begin(), file.end(), skiprows);
+    vector<vector<double>> data;
+    parse_columns_parallel(first, file.end(), delimiter, comment, thread_count, {&usecols}, {&data});
+    return data;
+}
+
+/**
+ * Lines at the start of the text that are copied to the output file.
+ * Same rule as `savetxt_multi` : everything before the first line that starts with a digit
+ * (ignoring leading spaces).
+ */
+static string header_block(const char* first, const char* last){
+    const char* line = first;
+    while (line < last){
+        const char* eol = find_eol(line, last);
+        const char* p = line;
+        while (p < eol && *p == ' ') ++p;
+        if(p < eol && isdigit((unsigned char)*p)) break;
+        line = eol + 1;
+    }
+    if(line > last) line = last;
+    string header(first, line);
+    if(!header.empty() && header.back() != '\n') header += '\n';
+    return header;
+}
+
+/**
+ * Maps a text file and splits its data into blocks of whole lines.
+ * Header and comment block and the delimiter are taken from the first lines and
+ * the data rows of every block are counted with multiple threads, so that the first row of
+ * every block is known before anything is parsed.
+ * @param filename     : name of the file
+ * @param skiprows     : number of rows to be skipped (commented or uncommented)
+ * @param delimiter    : expected delimiter. if it is not found in the first data line it is detected
+ * @param comment      : character used as comment in the file
+ * @param n_blocks     : number of blocks of roughly equal size in bytes
+ * @param thread_count : number of threads to count the rows with
+ */
+TextBlockReader::TextBlockReader(const std::string& filename, int skiprows, char delimiter, char comment,
+                                 size_t n_blocks, int thread_count)
+        : _file(filename), _delimiter{delimiter}, _comment{comment} {
+    if(thread_count <= 0) thread_count = omp_get_max_threads();
+    PhaseTimer delimiter_timer("delimiter");
+    _header = header_block(_file.begin(), _file.end());
+
+    const char* first = skip_lines(_file.begin(), _file.end(), skiprows);
+    // delimiter is decided from the first line that is not a comment
+    const char* line = first;
+    while (line < _file.end()){
+        const char* eol = find_eol(line, _file.end());
+        if(line == eol || line[0] != comment){
+            _delimiter = match_delimiter(string(line, eol), delimiter);
+            break;
+        }
+        line = eol + 1;
+    }
+    delimiter_timer.stop();
+
+    _bounds = split_at_newlines(first, _file.end(), max<size_t>(1, n_blocks));
+    long n = long(_bounds.size()) - 1;
+    _first_row.assign(n + 1, 0);
+    parallel_for_each(n, thread_count, [&](long k){
+        TraceScope trace("count block", k, k+1);
+        _first_row[k+1] = count_data_lines(_bounds[k], _bounds[k+1], _comment);
+    });
+    for(long k{}; k < n; ++k){
+        _first_row[k+1] += _first_row[k];
+    }
+}
+
+/**
+ * Parse the rows of a block into the outputs. Different blocks can be parsed by different threads
+ * at the same time, since every block writes its own rows only.
+ * @param block   : index of the block
+ * @param usecols : sets of columns to read
+ * @param data    : one output per set of columns. must already have `rows()` rows
+ */
+void TextBlockReader::parse(size_t block,
+                            const std::vector<const std::vector<int>*>& usecols,
+                            const std::vector<std::vector<std::vector<double>>*>& data) const {
+    parse_range(_bounds[block], _bounds[block+1], _delimiter, _comment, fields_needed(usecols),
+                usecols, data, _first_row[block]);
+}
+
+/**
+ * @param skiprows  : number of rows to be skipped (commented or uncommented)
+ * @param delimiter : expected delimiter. if it is not found in the first data line it is detected
+ * @param comment   : character used as comment in the file
+ */
+TextLineParser::TextLineParser(int skiprows, char delimiter, char comment)
+        : _skiprows{skiprows}, _delimiter{delimiter}, _comment{comment} {}
+
+/**
+ * Take the next line of the file.
+ * @param line    : start of the line
+ * @param eol     : end of the line, without the new line character
+ * @param usecols : sets of columns to read
+ * @param rows    : one row per set of columns. filled only if the line holds data
+ * @return : true if the line holds data
+ */
+bool TextLineParser::parse(const char* line, const char* eol,
+                           const std::vector<const std::vector<int>*>& usecols,
+                           const std::vector<std::vector<double>*>& rows){
+    size_t index = _line++;
+    if(_in_header){
+        // same rule as `header_block`
+        const char* p = line;
+        while (p < eol && *p == ' ') ++p;
+        if(p < eol && isdigit((unsigned char)*p)){
+            _in_header = false;
+        }else{
+            _header.append(line, eol);
+            _header += '\n';
+        }
+    }
+    if(index < size_t(_skiprows)) return false;
+    if(!_delimiter_known && (line == eol || line[0] != _comment)){
+        _delimiter = match_delimiter(string(line, eol), _delimiter);
+        _delimiter_known = true;
+    }
+    if(!is_data_line(line, eol, _comment)) return false;
+
+    split_fields(line, eol, _delimiter, fields_needed(usecols), _fields);
+    for(size_t s{}; s < usecols.size(); ++s) {
+        project_fields(_fields, *usecols[s], *rows[s]);
+    }
+    return true;
+}
+
+/**
+ * Same as `ingest_text` on text that is read from start to end, e.g. while it is decompressed on
+ * another thread. Text is taken in blocks of whole lines, and each block is parsed with multiple threads
+ * while the next one is being decompressed. Only one block of text is kept in memory.
+ */
+static TextIngest ingest_text_stream(ByteSource& source,
+                                     const std::vector<int>& a_usecols,
+                                     const std::vector<int>& b_usecols,
+                                     int skiprows, char delimiter, char comment, int thread_count,
+                                     PhaseTimer& timer){
+    // about as much as `ThreadedSource` decompresses ahead, so that it keeps working while a block is parsed
+    const size_t BLOCK_BYTES = size_t(4) << 20;
+    TextIngest ingest;
+    ingest.delimiter = delimiter;
+    vector<const vector<int>*> usecols{&b_usecols};
+    vector<vector<vector<double>>*> data{&ingest.b_data};
+    if(!a_usecols.empty()){
+        usecols.push_back(&a_usecols);
+        data.push_back(&ingest.a_data);
+    }
+    vector<vector<vector<double>>> parsed(data.size());
+    vector<vector<vector<double>>*> block_data;
+    for(auto& p : parsed) block_data.push_back(&p);
+
+    string text;
+    size_t bytes{};
+    bool started{false}; // header, skipped rows and the delimiter are known
+    bool eof{false};
+    while (!eof){
+        size_t old_size = text.size();
+        text.resize(old_size + BLOCK_BYTES);
+        size_t filled{};
+        while (filled < BLOCK_BYTES){
+            size_t n = source.read(&text[old_size + filled], BLOCK_BYTES - filled);
+            if(n == 0){
+                eof = true;
+                break;
+            }
+            filled += n;
+        }
+        text.resize(old_size + filled);
+        bytes += filled;
+
+        const char* begin = text.data();
+        const char* last = begin + text.size();
+        if(!eof){
+            // the last line may not be complete yet
+            while (last > begin && last[-1] != '\n') --last;
+            if(last == begin) continue;
+        }
+        const char* first = begin;
+        if(!started){
+            string header = header_block(begin, last);
+            first = skip_lines(begin, last, skiprows);
+            // the header and the first line after the skipped rows must be complete
+            if(!eof && (begin + header.size() >= last || first == last)) continue;
+            ingest.header = header;
+            const char* line = first;
+            while (line < last){
+                const char* eol = find_eol(line, last);
+                if(line == eol || line[0] != comment){
+                    ingest.delimiter = match_delimiter(string(line, eol), delimiter);
+                    break;
+                }
+                line = eol + 1;
+            }
+            started = true;
+        }
+        parse_columns_parallel(first, last, ingest.delimiter, comment, thread_count, usecols, block_data);
+        for(size_t s{}; s < data.size(); ++s){
+            data[s]->insert(data[s]->end(), make_move_iterator(parsed[s].begin()), make_move_iterator(parsed[s].end()));
+        }
+        text.erase(0, size_t(last - begin));
+    }
+    timer.bytes_in(bytes);
+    timer.rows(ingest.b_data.size());
+    return ingest;
+}
+
+/**
+ * Reads everything `cmd_args_v3` needs from the input file in a single pass over a memory map.
+ * Header and comment block and the delimiter are taken from the first lines,
+ * then the data lines are split once and only the `a` and `b` columns are converted.
+ * A gzip or zstd compressed file is decompressed on a separate thread and parsed block by block
+ * as it is decompressed instead, see `ingest_text_stream`.
+ * @param filename     : name of the file
+ * @param a_usecols    : columns that are not convolved. may be empty
+ * @param b_usecols    : columns that are convolved
+ * @param skiprows     : number of rows to be skipped (commented or uncommented)
+ * @param delimiter    : expected delimiter. if it is not found in the first data line it is detected
+ * @param comment      : character used as comment in the file
+ * @param thread_count : number of threads to use. all available threads if not positive
+ * @return : delimiter, header and the data of both sets of columns
+ */
+TextIngest ingest_text(const std::string& filename,
+                       const std::vector<int>& a_usecols,
+                       const std::vector<int>& b_usecols,
+                       int skiprows, char delimiter, char comment, int thread_count){
+    if(thread_count <= 0) thread_count = omp_get_max_threads();
+    PhaseTimer timer("parse", thread_count);
+    if(file_codec(filename) != Codec::none){
+        auto source = open_source(filename);
+        return ingest_text_stream(*source, a_usecols, b_usecols, skiprows, delimiter, comment, thread_count, timer);
+    }
+    TextBlockReader reader(filename, skiprows, delimiter, comment, size_t(thread_count), thread_count);
+    timer.bytes_in(reader.bytes());
+    timer.rows(reader.rows());
+
+    TextIngest ingest;
+    ingest.header = reader.header();
+    ingest.delimiter = reader.delimiter();
+
+    vector<const vector<int>*> usecols{&b_usecols};
+    vector<vector<vector<double>>*> data{&ingest.b_data};
+    if(!a_usecols.empty()){
+        usecols.push_back(&a_usecols);
+        data.push_back(&ingest.a_data);
+    }
+    for(auto d : data){
+        d->resize(reader.rows());
+    }
+    parallel_for_each(long(reader.blocks()), thread_count, [&](long k){
+        TraceScope trace("parse block", long(reader.first_row(size_t(k))), long(reader.first_row(size_t(k) + 1)));
+        reader.parse(size_t(k), usecols, data);
+    });
+    return ingest;
+}
+
+
 /**
  * Get a header for output file in raw format
  * @param icolumn_name
@@ -374,25 +881,7 @@ char analyze_delimeter(std::string in_filename, int skiprows, char delimiter, ch
     }
 
 
-    std::size_t found = line.find(delimiter);
-    if (found!=std::string::npos) {
-        std::cout << "delimiter matched" << found << '\n';
-    }else{
-        std::cout << "delimiter mismatched. finding used delimiter" << '\n';
-        string delimiter_list = " ,\t\v"; // list of delimiters
-        for(auto n:line)
-        {
-            for(auto c: delimiter_list){
-                if(n == c){
-                    cout << "found delimiter is " << int(n) << endl;
-                    delimiter = c;
-                }
-            }
-        }
-    }
-
-
-    return delimiter;
+    return match_delimiter(line, delimiter);
 }
 
 
@@ -444,4 +933,65 @@ char analyze_delimeter_non_numeric(std::string in_filename, int skiprows, char d
     return delimiter;
 }
 
+/**
+ * Number of columns in the first row of data
+ * @param in_filename : name of the file
+ * @param skiprows    : number of lines to skip
+ * @param delimiter   : delimiter character
+ * @param comment     : character used as comment in the file
+ * @return number of columns
+ */
+size_t count_columns(std::string in_filename, int skiprows, char delimiter, char comment){
+    ifstream fin(in_filename);
+    if(!fin) throw std::runtime_error("Could not find/open file");
+    string line;
+    unsigned r{};
+    while (getline(fin, line)) {
+        if (r < skiprows) {
+            ++r;
+            continue;
+        }
+        if (line[0] == comment) {
+            continue;
+        }
+        return explode_to_float(line, delimiter).size();
+    }
+    return 0;
+}
+
+/**
+ * Names of the columns taken from the header and comment lines.
+ * The commented line with the most fields is used, the last one if several have as many, e.g.
+ *      #<p>	<H(p,L)>	<P(p,L)>
+ * If there is no such line the names are "col<index>".
+ * @param header    : header and comment lines of a file
+ * @param delimiter : character used as delemeter in the file
+ * @param usecols   : columns to get the name of
+ * @param comment   : character used as comment in the file
+ * @return : one name for each column in usecols
+ */
+std::vector<std::string> column_names(const std::string& header, char delimiter,
+                                      const std::vector<int>& usecols, char comment){
+    int max_col{-1};
+    for(auto c : usecols) max_col = std::max(max_col, c);
 
+    vector<string> fields;
+    istringstream iss(header);
+    string line;
+    while (getline(iss, line)){
+        if(!line.empty() && line.back() == '\r') line.pop_back();
+        if(line.empty() || line[0] != comment) continue;
+        auto tmp = explode_to_string(line.substr(1), delimiter);
+        if(tmp.size() >= fields.size()) fields = tmp;
+    }
+    if(int(fields.size()) <= max_col) fields.clear();
+    vector<string> names;
+    for(auto c : usecols){
+        if(!fields.empty() && c >= 0){
+            names.push_back(fields[c]);
+        }else{
+            names.push_back("col" + to_string(c));
+        }
+    }
+    return names;
+}
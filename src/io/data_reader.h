@@ -10,6 +10,8 @@
 #include <vector>
 #include <map>
 
+#include "mapped_file.h"
+
 std::map<std::string, unsigned> read_header(std::string filename, char delemiter=' ', char comment='#');
 std::map<std::string, unsigned> read_header_json(std::string filename, char comment='#');
 
@@ -22,6 +24,79 @@ std::vector<std::vector<double>> loadtxt(std::string filename, const std::vector
 std::vector<std::vector<double>> loadtxt_v2(std::string filename, const std::vector<int>& usecols,
                                          int skiprows, char delimiter=' ', char comment='#');
 
+/**
+ * Contents of an input file that are used by the command line program
+ */
+struct TextIngest{
+    char delimiter{' '};
+    std::string header; // header and comment lines that are copied to the output file
+    std::vector<std::vector<double>> a_data; // columns that are not convolved
+    std::vector<std::vector<double>> b_data; // columns that are convolved
+};
+
+/**
+ * Data lines of a text file split into blocks that can be parsed independently and in any order.
+ * Used to parse a file block by block while the parsed rows are already being processed.
+ */
+class TextBlockReader{
+    MappedFile _file;
+    char _delimiter{' '};
+    char _comment{'#'};
+    std::string _header;
+    std::vector<const char*> _bounds;  // blocks()+1 boundaries of the blocks
+    std::vector<size_t> _first_row;    // blocks()+1 first row of each block
+public:
+    ~TextBlockReader() = default;
+    TextBlockReader(const std::string& filename, int skiprows, char delimiter, char comment,
+                    size_t n_blocks, int thread_count=1);
+
+    char delimiter() const { return _delimiter;}
+    const std::string& header() const { return _header;}
+    size_t rows() const { return _first_row.back();}
+    size_t blocks() const { return _first_row.size() - 1;}
+    size_t bytes() const { return _file.size();}
+    size_t first_row(size_t block) const { return _first_row[block];}
+
+    void parse(size_t block,
+               const std::vector<const std::vector<int>*>& usecols,
+               const std::vector<std::vector<std::vector<double>>*>& data) const;
+};
+
+/**
+ * Parses a text file line by line as the lines arrive, e.g. from a pipe.
+ * Header, delimiter and data lines follow the same rules as `ingest_text`.
+ */
+class TextLineParser{
+    int _skiprows{};
+    char _delimiter{' '};
+    char _comment{'#'};
+    size_t _line{};                  // index of the next line
+    bool _in_header{true};
+    bool _delimiter_known{false};
+    std::string _header;
+    std::vector<const char*> _fields;
+public:
+    ~TextLineParser() = default;
+    TextLineParser(int skiprows, char delimiter, char comment='#');
+
+    char delimiter() const { return _delimiter;}
+    const std::string& header() const { return _header;}
+    bool in_header() const { return _in_header;}
+
+    bool parse(const char* line, const char* eol,
+               const std::vector<const std::vector<int>*>& usecols,
+               const std::vector<std::vector<double>*>& rows);
+};
+
+TextIngest ingest_text(const std::string& filename,
+                       const std::vector<int>& a_usecols,
+                       const std::vector<int>& b_usecols,
+                       int skiprows, char delimiter=' ', char comment='#', int thread_count=1);
+
+std::vector<std::vector<double>> loadtxt_parallel(std::string filename, const std::vector<int>& usecols,
+                                                  int skiprows, char delimiter=' ', char comment='#',
+                                                  int thread_count=1);
+
 
 std::vector<std::string> explode_to_string(const std::string &str, const char &ch);
 std::vector<int>         explode_to_int(const std::string &str, const char &ch);
@@ -41,5 +116,9 @@ std::string output_header_raw(
 
 char analyze_delimeter(std::string in_filename, int skiprows, char delimiter, char comment='#');
 char analyze_delimeter_non_numeric(std::string in_filename, int skiprows, char delimiter, char comment='#');
+size_t count_columns(std::string in_filename, int skiprows, char delimiter, char comment='#');
+
+std::vector<std::string> column_names(const std::string& header, char delimiter,
+                                      const std::vector<int>& usecols, char comment='#');
 
 #endif //CONVOLUTION_DATA_READER_H
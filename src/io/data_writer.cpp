@@ -3,6 +3,10 @@
 //
 
 #include "data_writer.h"
+#include "binary_format.h"
+#include "npy_format.h"
+#include "text_formatter.h"
+#include "stream_io.h"
 #include "../include/string_methods.h"
 #include <iomanip>
 #include <fstream>
@@ -23,7 +27,7 @@ savetxt_multi(
         const vector<vector<double>> &b_data_out,
         int precision
 ) {
-    ofstream fout(out_filename);
+    string header;
     if(write_header_and_comment) {
         ifstream fin(in_filename);
         string str;
@@ -35,26 +39,197 @@ savetxt_multi(
 #ifdef DEBUG_FLAG
             cout << str << endl;
 #endif
-            fout << str << endl;
+            header += str + '\n';
         }
         fin.close();
     }
-    fout << '#' << info << endl; // info cannot contain a new line character
-    fout << "#convolved data" << endl;
+    savetxt_multi(header, out_filename, info, delimeter, write_input_data,
+                  a_data, b_data_in, b_data_out, precision);
+}
+
+/**
+ * Lines written before the convolved data: header and comment lines of the input file,
+ * `info` as a comment and a comment that marks the start of the data.
+ * @param header : header and comment lines of the input file
+ * @param info   : cannot contain a new line character
+ */
+std::string text_output_header(const std::string &header, const std::string &info){
+    return header + '#' + info + '\n' + "#convolved data" + '\n';
+}
+
+/**
+ * Write the convolved data to a file
+ * @param header           : header and comment lines of the input file. written as they are
+ * @param out_filename     : name of the output file
+ * @param info             : written as a comment. cannot contain a new line character
+ * @param delimeter        : delimiter between the columns
+ * @param write_input_data : if true `b_data_in` is written before each convolved column
+ * @param a_data           : columns that are not convolved
+ * @param b_data_in        : columns before convolution
+ * @param b_data_out       : columns after convolution
+ * @param precision        : floating point precision. negative value writes the shortest text
+ *                           that reads back to the same value
+ * @param thread_count     : number of threads to format the rows with. output does not depend on it
+ * @param compression      : codec to compress the file with
+ */
+void
+savetxt_multi(
+        const string &header,
+        const string &out_filename,
+        const string &info,
+        char delimeter,
+        bool write_input_data,
+        const vector<vector<double>> &a_data,
+        const vector<vector<double>> &b_data_in,
+        const vector<vector<double>> &b_data_out,
+        int precision,
+        int thread_count,
+        const Compression& compression
+) {
+    auto fout = open_sink(out_filename, compression);
+    fout->write(text_output_header(header, info));
     cout << b_data_out.size() << ", " << b_data_out[0].size() << endl;
 
-    for(size_t i{}; i < b_data_in.size(); ++i){
-        for(size_t j{}; j < a_data[0].size(); ++j){
-            fout << setprecision(precision) << a_data[i][j] << delimeter;
+    // column order of the output file
+    vector<pair<const vector<vector<double>>*, size_t>> columns;
+    for(size_t j{}; j < a_data[0].size(); ++j){
+        columns.emplace_back(&a_data, j);
+    }
+    for(size_t j{}; j < b_data_in[0].size(); ++j){
+        if(write_input_data){
+            columns.emplace_back(&b_data_in, j);
         }
-        for(size_t j{}; j < b_data_in[0].size(); ++j){
-            if(write_input_data){
-                fout << setprecision(precision) << b_data_in[i][j] << delimeter;
-            }
-            fout << setprecision(precision) << b_data_out[i][j] << delimeter;
-//            cout << setprecision(precision) << b_data_out[i][j] << delimeter;
+        columns.emplace_back(&b_data_out, j);
+    }
+
+    TextFormatter formatter(precision);
+    size_t max_row_chars = columns.size() * (formatter.max_chars() + 1) + 1;
+    write_row_blocks(*fout, b_data_in.size(), max_row_chars, thread_count, [&](size_t i, char* p){
+        for(auto& c : columns){
+            p = formatter.write(p, (*c.first)[i][c.second]);
+            *p++ = delimeter;
         }
-        fout << endl;
+        *p++ = '\n';
+        return p;
+    });
+    fout->close();
+}
+
+/**
+ * Columns of the output file in the order of `savetxt_multi`: columns of `a_data`, then for each
+ * convolved column the input column (if `write_input_data`) and the convolved column.
+ */
+static vector<BinaryColumnOut>
+output_columns(
+        const std::vector<std::string> &a_names,
+        const std::vector<std::string> &b_names,
+        bool write_input_data,
+        const std::vector<std::vector<double>> &a_data,
+        const std::vector<std::vector<double>> &b_data_in,
+        const std::vector<std::vector<double>> &b_data_out
+) {
+    vector<BinaryColumnOut> columns;
+    for(size_t j{}; j < a_data[0].size(); ++j){
+        columns.push_back({a_names[j], &a_data, j});
+    }
+    for(size_t j{}; j < b_data_in[0].size(); ++j){
+        if(write_input_data){
+            columns.push_back({b_names[j], &b_data_in, j});
+        }
+        columns.push_back({b_names[j] + " convolved", &b_data_out, j});
+    }
+    return columns;
+}
+
+/**
+ * Write the convolved data to a binary file. Columns are in the same order as in `savetxt_multi`.
+ * @param header           : key and value pairs of the file header
+ * @param out_filename     : name of the output file
+ * @param a_names          : names of the columns that are not convolved
+ * @param b_names          : names of the columns that are convolved
+ * @param write_input_data : if true `b_data_in` is written before each convolved column
+ * @param a_data           : columns that are not convolved
+ * @param b_data_in        : columns before convolution
+ * @param b_data_out       : columns after convolution
+ * @param float32          : if true values are stored in single precision
+ */
+void
+savebin_multi(
+        const std::map<std::string, std::string> &header,
+        const std::string &out_filename,
+        const std::vector<std::string> &a_names,
+        const std::vector<std::string> &b_names,
+        bool write_input_data,
+        const std::vector<std::vector<double>> &a_data,
+        const std::vector<std::vector<double>> &b_data_in,
+        const std::vector<std::vector<double>> &b_data_out,
+        bool float32
+) {
+    auto columns = output_columns(a_names, b_names, write_input_data, a_data, b_data_in, b_data_out);
+    savebin(out_filename, header, columns, float32 ? ColumnType::float32 : ColumnType::float64);
+}
+
+/**
+ * Write the convolved data to a NumPy file. Columns are in the same order as in `savetxt_multi`.
+ * A .npy file holds one array of shape (rows, columns) and a .npz file holds one array per column
+ * named after the column.
+ * @param out_filename     : name of the output file
+ * @param a_names          : names of the columns that are not convolved
+ * @param b_names          : names of the columns that are convolved
+ * @param write_input_data : if true `b_data_in` is written before each convolved column
+ * @param a_data           : columns that are not convolved
+ * @param b_data_in        : columns before convolution
+ * @param b_data_out       : columns after convolution
+ * @param npz              : if true a .npz file is written, otherwise a .npy file
+ */
+void
+savenpy_multi(
+        const std::string &out_filename,
+        const std::vector<std::string> &a_names,
+        const std::vector<std::string> &b_names,
+        bool write_input_data,
+        const std::vector<std::vector<double>> &a_data,
+        const std::vector<std::vector<double>> &b_data_in,
+        const std::vector<std::vector<double>> &b_data_out,
+        bool npz
+) {
+    auto columns = output_columns(a_names, b_names, write_input_data, a_data, b_data_in, b_data_out);
+    if(npz){
+        savenpz(out_filename, columns);
+    }else{
+        savenpy(out_filename, columns);
     }
-    fout.close();
-}
\ No newline at end of file
+}
+
+/**
+ * Write rows of data to a text file
+ * @param out_filename : name of the output file
+ * @param header       : written as it is before the data
+ * @param data         : rows of data
+ * @param delimeter    : delimiter between the columns
+ * @param precision    : floating point precision. negative value writes the shortest text
+ *                       that reads back to the same value
+ * @param thread_count : number of threads to format the rows with
+ */
+void savetxt(const std::string &out_filename,
+             const std::string &header,
+             const std::vector<std::vector<double>> &data,
+             char delimeter,
+             int precision,
+             int thread_count){
+    auto fout = open_sink(out_filename, Compression());
+    fout->write(header);
+    TextFormatter formatter(precision);
+    size_t max_columns{};
+    for(auto& row : data) max_columns = max(max_columns, row.size());
+    size_t max_row_chars = max_columns * (formatter.max_chars() + 1) + 1;
+    write_row_blocks(*fout, data.size(), max_row_chars, thread_count, [&](size_t i, char* p){
+        for(double v : data[i]){
+            p = formatter.write(p, v);
+            *p++ = delimeter;
+        }
+        *p++ = '\n';
+        return p;
+    });
+    fout->close();
+}
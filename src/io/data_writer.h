@@ -8,6 +8,9 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <map>
+
+#include "compression.h"
 
 void
 savetxt_multi(
@@ -23,6 +26,53 @@ savetxt_multi(
         int precision
 );
 
+std::string text_output_header(const std::string &header, const std::string &info);
+
+void
+savetxt_multi(
+        const std::string &header,
+        const std::string &out_filename,
+        const std::string &info,
+        char delimeter,
+        bool write_input_data,
+        const std::vector<std::vector<double>> &a_data,
+        const std::vector<std::vector<double>> &b_data_in,
+        const std::vector<std::vector<double>> &b_data_out,
+        int precision,
+        int thread_count=1,
+        const Compression& compression=Compression()
+);
+
+void
+savebin_multi(
+        const std::map<std::string, std::string> &header,
+        const std::string &out_filename,
+        const std::vector<std::string> &a_names,
+        const std::vector<std::string> &b_names,
+        bool write_input_data,
+        const std::vector<std::vector<double>> &a_data,
+        const std::vector<std::vector<double>> &b_data_in,
+        const std::vector<std::vector<double>> &b_data_out,
+        bool float32
+);
+
+void
+savenpy_multi(
+        const std::string &out_filename,
+        const std::vector<std::string> &a_names,
+        const std::vector<std::string> &b_names,
+        bool write_input_data,
+        const std::vector<std::vector<double>> &a_data,
+        const std::vector<std::vector<double>> &b_data_in,
+        const std::vector<std::vector<double>> &b_data_out,
+        bool npz
+);
 
+void savetxt(const std::string &out_filename,
+             const std::string &header,
+             const std::vector<std::vector<double>> &data,
+             char delimeter,
+             int precision,
+             int thread_count=1);
 
 #endif //CONVOLUTION_DATA_WRITER_H
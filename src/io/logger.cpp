@@ -3,3 +3,5 @@
 //
 
 #include "logger.h"
+
+Logging* Logging::_instance=nullptr;
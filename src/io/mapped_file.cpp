@@ -0,0 +1,46 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#include "mapped_file.h"
+
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+MappedFile::MappedFile(const string &filename) : _filename(filename) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0) throw std::runtime_error("Could not find/open file " + filename);
+
+    struct stat st{};
+    if(fstat(fd, &st) != 0){
+        close(fd);
+        throw std::runtime_error("Could not stat file " + filename);
+    }
+    _size = (size_t)st.st_size;
+    if(_size == 0){
+        // nothing to map. an empty file is a valid file
+        close(fd);
+        return;
+    }
+
+    void* ptr = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // mapping stays valid after closing the descriptor
+    if(ptr == MAP_FAILED){
+        _size = 0;
+        throw std::runtime_error("Could not map file " + filename);
+    }
+    // file is scanned from start to end
+    madvise(ptr, _size, MADV_SEQUENTIAL);
+    _data = static_cast<const char*>(ptr);
+}
+
+MappedFile::~MappedFile() {
+    if(_data != nullptr){
+        munmap((void*)_data, _size);
+    }
+}
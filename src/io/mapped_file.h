@@ -0,0 +1,35 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#ifndef CONVOLUTION_MAPPED_FILE_H
+#define CONVOLUTION_MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+/**
+ * Read only memory mapped view of a file.
+ * The whole file is mapped at construction and unmapped at destruction,
+ * so the contents can be scanned by many threads without any copy.
+ */
+class MappedFile{
+    std::string _filename;
+    const char* _data{nullptr};
+    size_t _size{};
+public:
+    ~MappedFile();
+    explicit MappedFile(const std::string& filename);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return _data;}
+    const char* begin() const { return _data;}
+    const char* end() const { return _data + _size;}
+    size_t size() const { return _size;}
+    const std::string& filename() const { return _filename;}
+};
+
+
+#endif //CONVOLUTION_MAPPED_FILE_H
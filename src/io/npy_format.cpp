@@ -0,0 +1,477 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#include "npy_format.h"
+
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <map>
+
+using namespace std;
+
+namespace {
+    const char NPY_MAGIC[6] = {'\x93', 'N', 'U', 'M', 'P', 'Y'};
+    const size_t ALIGNMENT = 64;
+
+    const uint32_t ZIP_LOCAL_HEADER   = 0x04034b50;
+    const uint32_t ZIP_CENTRAL_HEADER = 0x02014b50;
+    const uint32_t ZIP_END            = 0x06054b50;
+    const uint32_t ZIP64_END          = 0x06064b50;
+    const uint32_t ZIP64_LOCATOR      = 0x07064b50;
+    const uint16_t ZIP64_EXTRA        = 0x0001;
+    const uint64_t ZIP32_LIMIT        = 0xFFFFFFFFULL;
+
+    template <typename T>
+    T read_at(const char* p){
+        T x;
+        memcpy(&x, p, sizeof(T));
+        return x;
+    }
+
+    template <typename T>
+    void put(string& s, T x){
+        s.append(reinterpret_cast<const char*>(&x), sizeof(T));
+    }
+
+    /**
+     * Standard CRC-32 that is used by zip files
+     */
+    uint32_t crc32_update(uint32_t crc, const char* data, size_t n){
+        static uint32_t table[256];
+        static bool initialized = [](){
+            for(uint32_t i{}; i < 256; ++i){
+                uint32_t c = i;
+                for(int k{}; k < 8; ++k) c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+                table[i] = c;
+            }
+            return true;
+        }();
+        (void)initialized;
+        crc = ~crc;
+        for(size_t i{}; i < n; ++i){
+            crc = table[(crc ^ (unsigned char)data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    /**
+     * Parse the header of a .npy array that starts at `p`
+     * @param p    : start of the array
+     * @param size : bytes available after `p`
+     * @return : array without the name
+     */
+    NpyArray parse_npy(const char* p, size_t size){
+        if(size < 10 || memcmp(p, NPY_MAGIC, sizeof(NPY_MAGIC)) != 0){
+            throw std::runtime_error("Not a .npy array");
+        }
+        int major = (unsigned char)p[6];
+        size_t header_len, prefix;
+        if(major == 1){
+            header_len = read_at<uint16_t>(p + 8);
+            prefix = 10;
+        }else if(major == 2 || major == 3){
+            if(size < 12) throw std::runtime_error("Corrupted .npy array");
+            header_len = read_at<uint32_t>(p + 8);
+            prefix = 12;
+        }else{
+            throw std::runtime_error("Unsupported .npy version " + to_string(major));
+        }
+        if(prefix + header_len > size) throw std::runtime_error("Corrupted .npy header");
+        string header(p + prefix, header_len);
+
+        NpyArray array;
+        size_t d = header.find("'descr'");
+        size_t q1 = header.find('\'', header.find(':', d) + 1);
+        size_t q2 = header.find('\'', q1 + 1);
+        if(d == string::npos || q1 == string::npos || q2 == string::npos){
+            throw std::runtime_error("dtype not found in .npy header");
+        }
+        string descr = header.substr(q1 + 1, q2 - q1 - 1);
+        if(descr.size() < 3 || descr[0] == '>' || (descr[1] != 'f' && descr[1] != 'i')){
+            throw std::runtime_error("Unsupported dtype " + descr + ". Only little endian float and int are supported");
+        }
+        array.kind = descr[1];
+        array.item_size = size_t(stoi(descr.substr(2)));
+        if(!((array.kind == 'f' && (array.item_size == 4 || array.item_size == 8)) ||
+             (array.kind == 'i' && (array.item_size == 4 || array.item_size == 8)))){
+            throw std::runtime_error("Unsupported dtype " + descr);
+        }
+        size_t f = header.find("'fortran_order'");
+        array.fortran_order = f != string::npos && header.find("True", f) < header.find(',', f);
+
+        size_t s = header.find("'shape'");
+        size_t b1 = header.find('(', s);
+        size_t b2 = header.find(')', b1);
+        if(s == string::npos || b1 == string::npos || b2 == string::npos){
+            throw std::runtime_error("shape not found in .npy header");
+        }
+        vector<size_t> shape;
+        istringstream dims(header.substr(b1 + 1, b2 - b1 - 1));
+        string dim;
+        while (getline(dims, dim, ',')){
+            if(dim.find_first_of("0123456789") != string::npos) shape.push_back(stoull(dim));
+        }
+        if(shape.empty() || shape.size() > 2){
+            throw std::runtime_error("Only one and two dimensional arrays are supported");
+        }
+        array.n_rows = shape[0];
+        array.n_columns = shape.size() == 2 ? shape[1] : 1;
+        array.data = p + prefix + header_len;
+        if(prefix + header_len + array.n_rows * array.n_columns * array.item_size > size){
+            throw std::runtime_error("Truncated .npy array");
+        }
+        return array;
+    }
+
+    /**
+     * Header of a .npy array padded so that the data starts at a multiple of 64 bytes
+     * from the start of the array
+     */
+    string npy_header(const string& descr, size_t n_rows, size_t n_columns, bool two_dimensional){
+        ostringstream dict;
+        dict << "{'descr': '" << descr << "', 'fortran_order': False, 'shape': (" << n_rows << ",";
+        if(two_dimensional) dict << " " << n_columns;
+        dict << "), }";
+        string header = dict.str();
+        size_t total = 10 + header.size() + 1;
+        header.append((ALIGNMENT - total % ALIGNMENT) % ALIGNMENT, ' ');
+        header += '\n';
+
+        string out(NPY_MAGIC, sizeof(NPY_MAGIC));
+        out += char(1);
+        out += char(0);
+        put<uint16_t>(out, uint16_t(header.size()));
+        return out + header;
+    }
+
+    /**
+     * Name of a .npz entry. Only letters, digits and '_' are kept so that it is a valid python identifier
+     */
+    string entry_name(const string& name, map<string, int>& used){
+        string key;
+        for(char c : name){
+            bool valid = isalnum((unsigned char)c) || c == '_';
+            if(valid) key += c;
+            else if(!key.empty() && key.back() != '_') key += '_';
+        }
+        while (!key.empty() && key.back() == '_') key.pop_back();
+        if(key.empty() || isdigit((unsigned char)key[0])) key = "c_" + key;
+        int n = used[key]++;
+        if(n > 0) key += "_" + to_string(n);
+        return key;
+    }
+
+    struct ZipEntry{
+        string name;
+        uint32_t crc;
+        uint64_t size;
+        uint64_t offset;
+    };
+}
+
+double NpyArray::value(size_t row, size_t col) const {
+    size_t index = fortran_order ? col * n_rows + row : row * n_columns + col;
+    const char* p = data + index * item_size;
+    if(kind == 'f'){
+        return item_size == 4 ? double(read_at<float>(p)) : read_at<double>(p);
+    }
+    return item_size == 4 ? double(read_at<int32_t>(p)) : double(read_at<int64_t>(p));
+}
+
+bool is_npy_file(const std::string& filename){
+    ifstream fin(filename, ios::binary);
+    char magic[sizeof(NPY_MAGIC)];
+    return fin.read(magic, sizeof(magic)) && memcmp(magic, NPY_MAGIC, sizeof(magic)) == 0;
+}
+
+bool is_npz_file(const std::string& filename){
+    ifstream fin(filename, ios::binary);
+    char magic[4];
+    return fin.read(magic, sizeof(magic)) && read_at<uint32_t>(magic) == ZIP_LOCAL_HEADER;
+}
+
+/**
+ * Maps the file and locates every array.
+ * Entries of a .npz file must be stored without compression, i.e. written by `np.savez`.
+ * @param filename : name of a .npy or .npz file
+ */
+NpyReader::NpyReader(const std::string& filename) : _file(filename) {
+    const char* p = _file.data();
+    size_t size = _file.size();
+    if(size >= sizeof(NPY_MAGIC) && memcmp(p, NPY_MAGIC, sizeof(NPY_MAGIC)) == 0){
+        _arrays.push_back(parse_npy(p, size));
+        _arrays.back().name = "arr_0";
+    }else{
+        // end of central directory record is in the last 65557 bytes
+        if(size < 22) throw std::runtime_error("Not a .npy or .npz file " + filename);
+        size_t eocd = size - 22;
+        size_t lowest = size > 22 + 65535 ? size - 22 - 65535 : 0;
+        while (eocd > lowest && read_at<uint32_t>(p + eocd) != ZIP_END) --eocd;
+        if(read_at<uint32_t>(p + eocd) != ZIP_END) throw std::runtime_error("Not a .npy or .npz file " + filename);
+
+        uint64_t n_entries = read_at<uint16_t>(p + eocd + 10);
+        uint64_t cd_offset = read_at<uint32_t>(p + eocd + 16);
+        if(eocd >= 20 && read_at<uint32_t>(p + eocd - 20) == ZIP64_LOCATOR){
+            uint64_t z64 = read_at<uint64_t>(p + eocd - 20 + 8);
+            if(z64 + 56 > size || read_at<uint32_t>(p + z64) != ZIP64_END){
+                throw std::runtime_error("Corrupted zip64 record in " + filename);
+            }
+            n_entries = read_at<uint64_t>(p + z64 + 32);
+            cd_offset = read_at<uint64_t>(p + z64 + 48);
+        }
+
+        size_t q = cd_offset;
+        for(uint64_t e{}; e < n_entries; ++e){
+            if(q + 46 > size || read_at<uint32_t>(p + q) != ZIP_CENTRAL_HEADER){
+                throw std::runtime_error("Corrupted central directory in " + filename);
+            }
+            uint16_t method = read_at<uint16_t>(p + q + 10);
+            uint64_t comp_size = read_at<uint32_t>(p + q + 20);
+            uint64_t uncomp_size = read_at<uint32_t>(p + q + 24);
+            uint16_t name_len = read_at<uint16_t>(p + q + 28);
+            uint16_t extra_len = read_at<uint16_t>(p + q + 30);
+            uint16_t comment_len = read_at<uint16_t>(p + q + 32);
+            uint64_t local = read_at<uint32_t>(p + q + 42);
+            string name(p + q + 46, name_len);
+
+            // 64 bit values are in the zip64 extra field, only for the fields that overflowed
+            const char* x = p + q + 46 + name_len;
+            const char* x_end = x + extra_len;
+            while (x + 4 <= x_end){
+                uint16_t id = read_at<uint16_t>(x);
+                uint16_t len = read_at<uint16_t>(x + 2);
+                if(id == ZIP64_EXTRA){
+                    const char* v = x + 4;
+                    if(uncomp_size == ZIP32_LIMIT) { uncomp_size = read_at<uint64_t>(v); v += 8;}
+                    if(comp_size == ZIP32_LIMIT) { comp_size = read_at<uint64_t>(v); v += 8;}
+                    if(local == ZIP32_LIMIT) { local = read_at<uint64_t>(v);}
+                }
+                x += 4 + len;
+            }
+            if(method != 0){
+                throw std::runtime_error("entry " + name + " is compressed. only uncompressed .npz (np.savez) is supported");
+            }
+            if(local + 30 > size || read_at<uint32_t>(p + local) != ZIP_LOCAL_HEADER){
+                throw std::runtime_error("Corrupted local header in " + filename);
+            }
+            size_t start = local + 30 + read_at<uint16_t>(p + local + 26) + read_at<uint16_t>(p + local + 28);
+            if(start + comp_size > size) throw std::runtime_error("Truncated entry " + name);
+
+            NpyArray array = parse_npy(p + start, comp_size);
+            if(name.size() > 4 && name.substr(name.size() - 4) == ".npy") name.resize(name.size() - 4);
+            array.name = name;
+            _arrays.push_back(array);
+            q += 46 + name_len + extra_len + comment_len;
+        }
+    }
+
+    if(_arrays.empty()) throw std::runtime_error("No array found in " + filename);
+    _n_rows = _arrays[0].n_rows;
+    for(size_t a{}; a < _arrays.size(); ++a){
+        if(_arrays[a].n_rows != _n_rows){
+            throw std::runtime_error("arrays of " + filename + " have different number of rows");
+        }
+        for(size_t c{}; c < _arrays[a].n_columns; ++c){
+            _column_map.emplace_back(a, c);
+        }
+    }
+}
+
+/**
+ * Reads columns in the row major layout that is returned by `loadtxt`.
+ * The arrays stay mapped, the requested columns are converted to double and
+ * copied once into the rows the kernels take.
+ * Columns that do not exist are ignored.
+ * @param usecols : columns to read
+ * @return : data of the columns
+ */
+std::vector<std::vector<double>> NpyReader::load(const std::vector<int>& usecols) const {
+    vector<int> cols;
+    for(auto c : usecols){
+        if(size_t(c) < _column_map.size()) cols.push_back(c);
+    }
+    vector<vector<double>> data(_n_rows);
+#pragma omp parallel for schedule(static)
+    for(long r=0; r < long(_n_rows); ++r){
+        data[r].resize(cols.size());
+        for(size_t k{}; k < cols.size(); ++k){
+            auto& m = _column_map[cols[k]];
+            data[r][k] = _arrays[m.first].value(size_t(r), m.second);
+        }
+    }
+    return data;
+}
+
+/**
+ * Names of the columns. Array name for one dimensional arrays and "<array>[<column>]" otherwise
+ */
+std::vector<std::string> NpyReader::names() const {
+    vector<string> n;
+    for(auto& m : _column_map){
+        const NpyArray& a = _arrays[m.first];
+        n.push_back(a.n_columns == 1 ? a.name : a.name + "[" + to_string(m.second) + "]");
+    }
+    return n;
+}
+
+/**
+ * Write columns as a single two dimensional float64 array of shape (rows, columns) in C order,
+ * i.e. with the same layout as the text output.
+ * @param filename : name of the output file
+ * @param columns  : columns to write. all must have the same number of rows
+ */
+void savenpy(const std::string& filename, const std::vector<BinaryColumnOut>& columns){
+    size_t n_rows = columns.empty() ? 0 : columns[0].rows->size();
+    ofstream fout(filename, ios::binary);
+    if(!fout) throw std::runtime_error("Could not create file " + filename);
+    fout << npy_header("<f8", n_rows, columns.size(), true);
+
+    // rows are written in blocks to keep the number of write calls small
+    const size_t block = 1 << 14;
+    vector<double> buffer;
+    for(size_t r0{}; r0 < n_rows; r0 += block){
+        size_t r1 = min(n_rows, r0 + block);
+        buffer.resize((r1 - r0) * columns.size());
+        for(size_t r{r0}; r < r1; ++r){
+            for(size_t c{}; c < columns.size(); ++c){
+                buffer[(r - r0) * columns.size() + c] = (*columns[c].rows)[r][columns[c].index];
+            }
+        }
+        fout.write(reinterpret_cast<const char*>(buffer.data()), buffer.size() * sizeof(double));
+    }
+    if(!fout) throw std::runtime_error("Could not write file " + filename);
+}
+
+/**
+ * Write every column as a one dimensional float64 array of an uncompressed .npz file,
+ * which is what `np.savez` writes. Entry names are made from the column names.
+ * Data of every entry starts at a multiple of 64 bytes from the start of the file, so each
+ * array can be memory mapped at its offset. Zip64 records are written for files larger than 4 GB.
+ * @param filename : name of the output file
+ * @param columns  : columns to write. all must have the same number of rows
+ */
+void savenpz(const std::string& filename, const std::vector<BinaryColumnOut>& columns){
+    size_t n_rows = columns.empty() ? 0 : columns[0].rows->size();
+    ofstream fout(filename, ios::binary);
+    if(!fout) throw std::runtime_error("Could not create file " + filename);
+
+    map<string, int> used;
+    vector<ZipEntry> entries;
+    uint64_t offset{};
+    vector<double> values(n_rows);
+    for(auto& column : columns){
+        for(size_t r{}; r < n_rows; ++r) values[r] = (*column.rows)[r][column.index];
+        string header = npy_header("<f8", n_rows, 1, false);
+        const char* data = reinterpret_cast<const char*>(values.data());
+        size_t data_bytes = n_rows * sizeof(double);
+
+        ZipEntry entry;
+        entry.name = entry_name(column.name, used) + ".npy";
+        entry.size = header.size() + data_bytes;
+        entry.offset = offset;
+        entry.crc = crc32_update(crc32_update(0, header.data(), header.size()), data, data_bytes);
+        bool zip64 = entry.size >= ZIP32_LIMIT || offset >= ZIP32_LIMIT;
+
+        string extra;
+        if(zip64){
+            put<uint16_t>(extra, ZIP64_EXTRA);
+            put<uint16_t>(extra, 16);
+            put<uint64_t>(extra, entry.size);
+            put<uint64_t>(extra, entry.size);
+        }
+        // zero bytes after the extra fields align the entry data, as zipalign does.
+        // no extra field id is claimed for it
+        size_t unpadded = offset + 30 + entry.name.size() + extra.size();
+        size_t padding = (ALIGNMENT - unpadded % ALIGNMENT) % ALIGNMENT;
+        extra.append(padding, '\0');
+
+        string local;
+        put<uint32_t>(local, ZIP_LOCAL_HEADER);
+        put<uint16_t>(local, zip64 ? 45 : 20); // version needed
+        put<uint16_t>(local, 0);               // flags
+        put<uint16_t>(local, 0);               // stored
+        put<uint16_t>(local, 0);               // time
+        put<uint16_t>(local, 0x21);            // date 1980-01-01
+        put<uint32_t>(local, entry.crc);
+        put<uint32_t>(local, zip64 ? uint32_t(ZIP32_LIMIT) : uint32_t(entry.size));
+        put<uint32_t>(local, zip64 ? uint32_t(ZIP32_LIMIT) : uint32_t(entry.size));
+        put<uint16_t>(local, uint16_t(entry.name.size()));
+        put<uint16_t>(local, uint16_t(extra.size()));
+        local += entry.name;
+        local += extra;
+
+        fout << local << header;
+        fout.write(data, data_bytes);
+        offset += local.size() + entry.size;
+        entries.push_back(entry);
+    }
+
+    // central directory
+    uint64_t cd_offset = offset;
+    string cd;
+    for(auto& entry : entries){
+        bool zip64 = entry.size >= ZIP32_LIMIT || entry.offset >= ZIP32_LIMIT;
+        string extra;
+        if(zip64){
+            put<uint16_t>(extra, ZIP64_EXTRA);
+            put<uint16_t>(extra, 24);
+            put<uint64_t>(extra, entry.size);
+            put<uint64_t>(extra, entry.size);
+            put<uint64_t>(extra, entry.offset);
+        }
+        put<uint32_t>(cd, ZIP_CENTRAL_HEADER);
+        put<uint16_t>(cd, 45);                 // version made by
+        put<uint16_t>(cd, zip64 ? 45 : 20);    // version needed
+        put<uint16_t>(cd, 0);
+        put<uint16_t>(cd, 0);
+        put<uint16_t>(cd, 0);
+        put<uint16_t>(cd, 0x21);
+        put<uint32_t>(cd, entry.crc);
+        put<uint32_t>(cd, zip64 ? uint32_t(ZIP32_LIMIT) : uint32_t(entry.size));
+        put<uint32_t>(cd, zip64 ? uint32_t(ZIP32_LIMIT) : uint32_t(entry.size));
+        put<uint16_t>(cd, uint16_t(entry.name.size()));
+        put<uint16_t>(cd, uint16_t(extra.size()));
+        put<uint16_t>(cd, 0);                  // comment
+        put<uint16_t>(cd, 0);                  // disk
+        put<uint16_t>(cd, 0);                  // internal attributes
+        put<uint32_t>(cd, 0);                  // external attributes
+        put<uint32_t>(cd, zip64 ? uint32_t(ZIP32_LIMIT) : uint32_t(entry.offset));
+        cd += entry.name;
+        cd += extra;
+    }
+    fout << cd;
+
+    bool zip64 = cd_offset >= ZIP32_LIMIT || cd.size() >= ZIP32_LIMIT || entries.size() >= 0xFFFF;
+    string end;
+    if(zip64){
+        uint64_t z64 = cd_offset + cd.size();
+        put<uint32_t>(end, ZIP64_END);
+        put<uint64_t>(end, 44);
+        put<uint16_t>(end, 45);
+        put<uint16_t>(end, 45);
+        put<uint32_t>(end, 0);
+        put<uint32_t>(end, 0);
+        put<uint64_t>(end, entries.size());
+        put<uint64_t>(end, entries.size());
+        put<uint64_t>(end, cd.size());
+        put<uint64_t>(end, cd_offset);
+        put<uint32_t>(end, ZIP64_LOCATOR);
+        put<uint32_t>(end, 0);
+        put<uint64_t>(end, z64);
+        put<uint32_t>(end, 1);
+    }
+    put<uint32_t>(end, ZIP_END);
+    put<uint16_t>(end, 0);
+    put<uint16_t>(end, 0);
+    put<uint16_t>(end, zip64 ? 0xFFFF : uint16_t(entries.size()));
+    put<uint16_t>(end, zip64 ? 0xFFFF : uint16_t(entries.size()));
+    put<uint32_t>(end, zip64 ? uint32_t(ZIP32_LIMIT) : uint32_t(cd.size()));
+    put<uint32_t>(end, zip64 ? uint32_t(ZIP32_LIMIT) : uint32_t(cd_offset));
+    put<uint16_t>(end, 0);
+    fout << end;
+    if(!fout) throw std::runtime_error("Could not write file " + filename);
+}
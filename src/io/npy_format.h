@@ -0,0 +1,62 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#ifndef CONVOLUTION_NPY_FORMAT_H
+#define CONVOLUTION_NPY_FORMAT_H
+
+/**
+ * NumPy .npy and uncompressed .npz files.
+ * Input files are memory mapped. Output files are laid out so that the array data starts
+ * at a multiple of 64 bytes, so `np.load(filename, mmap_mode='r')` maps them without a copy.
+ */
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include "mapped_file.h"
+#include "binary_format.h"
+
+/**
+ * An array of a .npy file or of an entry of a .npz file. `data` points into the memory map.
+ */
+struct NpyArray{
+    std::string name;
+    char kind{'f'};        // 'f' floating point, 'i' signed integer
+    size_t item_size{8};
+    bool fortran_order{false};
+    size_t n_rows{};
+    size_t n_columns{};    // 1 for one dimensional arrays
+    const char* data{nullptr};
+
+    double value(size_t row, size_t col) const;
+};
+
+/**
+ * Reads .npy and .npz files through a memory map.
+ * Columns of all arrays are numbered one after another, in the order they are stored.
+ */
+class NpyReader{
+    MappedFile _file;
+    std::vector<NpyArray> _arrays;
+    size_t _n_rows{};
+    std::vector<std::pair<size_t, size_t>> _column_map; // (array, column of the array) of each column
+public:
+    ~NpyReader() = default;
+    explicit NpyReader(const std::string& filename);
+
+    size_t rows() const { return _n_rows;}
+    size_t columns() const { return _column_map.size();}
+    const std::vector<NpyArray>& arrays() const { return _arrays;}
+
+    std::vector<std::vector<double>> load(const std::vector<int>& usecols) const;
+    std::vector<std::string> names() const;
+};
+
+bool is_npy_file(const std::string& filename);
+bool is_npz_file(const std::string& filename);
+
+void savenpy(const std::string& filename, const std::vector<BinaryColumnOut>& columns);
+void savenpz(const std::string& filename, const std::vector<BinaryColumnOut>& columns);
+
+#endif //CONVOLUTION_NPY_FORMAT_H
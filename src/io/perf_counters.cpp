@@ -0,0 +1,105 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#include "perf_counters.h"
+
+#include <atomic>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <dirent.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+using namespace std;
+
+namespace {
+    atomic<bool> perf_enabled{false};
+
+    const int N_EVENTS = 4; // in the order of the fields of PerfValues
+
+#ifdef __linux__
+    int open_counter(int event, pid_t tid){
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.inherit = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        switch (event) {
+            case 0: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+            case 1: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+            case 2: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_CACHE_MISSES; break;
+            default: attr.type = PERF_TYPE_SOFTWARE; attr.config = PERF_COUNT_SW_TASK_CLOCK; break;
+        }
+        return int(syscall(SYS_perf_event_open, &attr, tid, -1, -1, 0));
+    }
+#endif
+
+    /**
+     * Ids of the threads of the process
+     */
+    vector<pid_t> threads_of_process(){
+        vector<pid_t> tids;
+        DIR* dir = opendir("/proc/self/task");
+        if(dir == nullptr) return tids;
+        while (dirent* entry = readdir(dir)){
+            if(entry->d_name[0] == '.') continue;
+            tids.push_back(pid_t(atoi(entry->d_name)));
+        }
+        closedir(dir);
+        return tids;
+    }
+}
+
+void set_perf_counters(bool enabled){
+    perf_enabled = enabled;
+}
+
+bool perf_counters_enabled(){
+    return perf_enabled;
+}
+
+/**
+ * Opens all counters on all threads. Counters that cannot be opened are left out
+ */
+PerfCounters::PerfCounters() {
+#ifdef __linux__
+    for(pid_t tid : threads_of_process()){
+        for(int e{}; e < N_EVENTS; ++e){
+            int fd = open_counter(e, tid);
+            if(fd >= 0) _counters.push_back({fd, e});
+        }
+    }
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+    for(auto& c : _counters) close(c.fd);
+}
+
+/**
+ * Sum over the threads. Values are scaled up if the kernel had to share the counters between events
+ */
+PerfValues PerfCounters::read() const {
+    long long values[N_EVENTS] = {-1, -1, -1, -1};
+    for(auto& c : _counters){
+        uint64_t data[3]{}; // value, time enabled, time running
+        if(::read(c.fd, data, sizeof(data)) != ssize_t(sizeof(data))) continue;
+        double value = double(data[0]);
+        if(data[2] > 0 && data[2] < data[1]) value *= double(data[1]) / double(data[2]);
+        if(values[c.event] < 0) values[c.event] = 0;
+        values[c.event] += (long long)(value);
+    }
+    PerfValues v;
+    v.cycles = values[0];
+    v.instructions = values[1];
+    v.llc_misses = values[2];
+    v.task_clock = values[3];
+    return v;
+}
@@ -0,0 +1,54 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#ifndef CONVOLUTION_PERF_COUNTERS_H
+#define CONVOLUTION_PERF_COUNTERS_H
+
+/**
+ * Hardware performance counters of the whole process with perf_event_open (Linux).
+ * Enabled with `--perf`. Every phase of the run report then records cycles, instructions,
+ * last level cache misses and cpu time, from which IPC and memory bandwidth are derived.
+ * Counters that the machine or the permissions do not give are reported as missing,
+ * e.g. in virtual machines without a PMU only the cpu time is known.
+ */
+#include <vector>
+#include <string>
+
+/**
+ * Values of the counters. -1 if a counter is not available
+ */
+struct PerfValues{
+    long long cycles{-1};
+    long long instructions{-1};
+    long long llc_misses{-1};
+    long long task_clock{-1};   // cpu time of all threads in nanoseconds
+
+    bool any() const { return cycles >= 0 || instructions >= 0 || llc_misses >= 0 || task_clock >= 0;}
+};
+
+/**
+ * Counters of every thread of the process, counting from construction.
+ * Threads started afterwards are counted by the counters of the thread that started them,
+ * but only once they exit.
+ */
+class PerfCounters{
+    struct Counter{
+        int fd;
+        int event;
+    };
+    std::vector<Counter> _counters;
+public:
+    ~PerfCounters();
+    PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    PerfValues read() const;
+};
+
+void set_perf_counters(bool enabled);
+bool perf_counters_enabled();
+
+#endif //CONVOLUTION_PERF_COUNTERS_H
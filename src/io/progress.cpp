@@ -0,0 +1,109 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#include "progress.h"
+
+#include <cstdio>
+#include <iostream>
+#include <unistd.h>
+
+using namespace std;
+
+namespace {
+    /**
+     * Number of counters. Threads beyond it share counters, which is still correct, only slower
+     */
+    const size_t PROGRESS_SLOTS = 64;
+
+    atomic<size_t> next_slot{};
+    thread_local size_t thread_slot = next_slot++;
+
+    atomic<bool> reporting{true};
+}
+
+ProgressCounter::ProgressCounter(size_t rows, size_t parts_per_row) : _slots(PROGRESS_SLOTS) {
+    reset(rows, parts_per_row);
+}
+
+/**
+ * Start counting from zero. Must not be called while threads add to the counter
+ */
+void ProgressCounter::reset(size_t rows, size_t parts_per_row) {
+    for(auto& s: _slots) s.done.store(0, memory_order_relaxed);
+    _parts = max<size_t>(1, parts_per_row);
+    _total = rows;
+}
+
+size_t ProgressCounter::slot() const {
+    return thread_slot % _slots.size();
+}
+
+size_t ProgressCounter::rows_done() const {
+    size_t done{};
+    for(const auto& s: _slots) done += s.done.load(memory_order_relaxed);
+    return done / _parts;
+}
+
+/**
+ * Fraction of the rows done. Can be read from any thread while the rows are computed
+ */
+double ProgressCounter::fraction() const {
+    size_t total = _total;
+    return total == 0 ? 1 : double(rows_done()) / total;
+}
+
+bool stdout_is_terminal() {
+    return isatty(fileno(stdout)) != 0;
+}
+
+/**
+ * Turn progress output off, e.g. in benchmarks that run the kernels many times. On by default
+ */
+void set_progress_reporting(bool enabled) {
+    reporting = enabled;
+}
+
+bool progress_reporting() {
+    return reporting;
+}
+
+ProgressReporter::ProgressReporter(const ProgressCounter &counter, std::chrono::milliseconds interval)
+        : _counter(counter), _interval{interval}, _start{chrono::steady_clock::now()} {
+    if(progress_reporting() && stdout_is_terminal()){
+        _thread = thread(&ProgressReporter::report, this);
+    }
+}
+
+ProgressReporter::~ProgressReporter() {
+    if(!_thread.joinable()) return;
+    {
+        lock_guard<mutex> lock(_mutex);
+        _stop = true;
+    }
+    _stopped.notify_one();
+    _thread.join();
+    print();
+    cout << endl;
+}
+
+void ProgressReporter::report() {
+    unique_lock<mutex> lock(_mutex);
+    while (!_stopped.wait_for(lock, _interval, [this]{ return _stop;})){
+        print();
+    }
+}
+
+void ProgressReporter::print() const {
+    size_t done = _counter.rows_done();
+    size_t total = _counter.rows();
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - _start).count();
+    double rate = seconds > 0 ? done / seconds : 0;
+    cout << "\33[2K"; // erase the current line
+    cout << '\r'; // return the cursor to the start of the line
+    cout << "progress " << _counter.fraction() * 100 << " % " << size_t(rate) << " rows/s";
+    if(rate > 0 && done < total){
+        cout << " ETA " << size_t((total - done) / rate + 0.5) << " sec";
+    }
+    std::fflush(stdout);
+}
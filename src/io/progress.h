@@ -0,0 +1,84 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#ifndef CONVOLUTION_PROGRESS_H
+#define CONVOLUTION_PROGRESS_H
+
+/**
+ * Progress of a parallel loop. Threads only add to a counter of their own, on its own cache line,
+ * and a separate thread prints the sum at a fixed interval. So the loops never take the lock of
+ * the output stream and never write to a cache line that another thread writes to.
+ */
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <condition_variable>
+
+/**
+ * Number of rows done, out of a total, counted by any number of threads
+ */
+class ProgressCounter{
+    struct alignas(64) Slot{
+        std::atomic<size_t> done{};
+    };
+    std::vector<Slot> _slots;
+    std::atomic<size_t> _total{};
+    std::atomic<size_t> _parts{1};
+public:
+    ~ProgressCounter() = default;
+    explicit ProgressCounter(size_t rows=0, size_t parts_per_row=1);
+
+    ProgressCounter(const ProgressCounter&) = delete;
+    ProgressCounter& operator=(const ProgressCounter&) = delete;
+
+    void reset(size_t rows, size_t parts_per_row=1);
+
+    /**
+     * Count `parts` more parts of rows as done. Rows computed in panels of columns count one part per panel
+     */
+    void add(size_t parts=1) {
+        _slots[slot()].done.fetch_add(parts, std::memory_order_relaxed);
+    }
+
+    size_t rows() const { return _total;}
+    size_t rows_done() const;
+    double fraction() const;
+private:
+    size_t slot() const;
+};
+
+/**
+ * Prints a counter every `interval` on a thread of its own, as long as it exists:
+ * percentage, rows per second and the estimated time left.
+ * Prints nothing when standard output is not a terminal, e.g. redirected to a log file.
+ */
+class ProgressReporter{
+    const ProgressCounter& _counter;
+    std::chrono::milliseconds _interval;
+    std::chrono::steady_clock::time_point _start;
+    bool _stop{false};
+    std::mutex _mutex;
+    std::condition_variable _stopped;
+    std::thread _thread;
+
+    void report();
+    void print() const;
+public:
+    ~ProgressReporter();
+    explicit ProgressReporter(const ProgressCounter& counter,
+                              std::chrono::milliseconds interval=std::chrono::milliseconds(200));
+
+    ProgressReporter(const ProgressReporter&) = delete;
+    ProgressReporter& operator=(const ProgressReporter&) = delete;
+};
+
+bool stdout_is_terminal();
+void set_progress_reporting(bool enabled);
+bool progress_reporting();
+
+#endif //CONVOLUTION_PROGRESS_H
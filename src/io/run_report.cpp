@@ -0,0 +1,219 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#include "run_report.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <sys/resource.h>
+
+using namespace std;
+
+namespace {
+    string json_string(const string& text){
+        ostringstream out;
+        out << '"';
+        for(char c : text){
+            switch (c) {
+                case '"':  out << "\\\""; break;
+                case '\\': out << "\\\\"; break;
+                case '\n': out << "\\n"; break;
+                case '\t': out << "\\t"; break;
+                case '\r': out << "\\r"; break;
+                default:
+                    if((unsigned char)c < 0x20){
+                        out << "\\u" << hex << setw(4) << setfill('0') << int(c) << dec << setfill(' ');
+                    }else{
+                        out << c;
+                    }
+            }
+        }
+        out << '"';
+        return out.str();
+    }
+
+    string json_number(double value){
+        ostringstream out;
+        out << setprecision(10) << value;
+        return out.str();
+    }
+
+    /**
+     * null for a counter that is not available
+     */
+    string json_counter(long long value){
+        return value < 0 ? "null" : to_string(value);
+    }
+
+    /**
+     * Counters and what follows from them. IPC tells whether the kernel is limited by latency
+     * (low IPC, few misses) or compute (high IPC), and the memory traffic of the cache misses
+     * whether it is limited by bandwidth
+     */
+    string json_perf(const PhaseRecord& p){
+        ostringstream out;
+        const PerfValues& v = p.perf;
+        out << ", \"cycles\": " << json_counter(v.cycles)
+            << ", \"instructions\": " << json_counter(v.instructions)
+            << ", \"ipc\": " << (v.cycles > 0 && v.instructions >= 0 ? json_number(double(v.instructions) / v.cycles) : "null")
+            << ", \"llc_misses\": " << json_counter(v.llc_misses)
+            << ", \"gb_per_second\": " << (v.llc_misses >= 0 && p.seconds > 0 ? json_number(v.llc_misses * 64.0 / p.seconds / 1e9) : "null")
+            << ", \"cpu_seconds\": " << (v.task_clock >= 0 ? json_number(v.task_clock / 1e9) : "null");
+        return out.str();
+    }
+}
+
+RunReport::RunReport() : _start{chrono::steady_clock::now()} {}
+
+/**
+ * Seconds since the start of the program
+ */
+double RunReport::elapsed() const {
+    return chrono::duration<double>(chrono::steady_clock::now() - _start).count();
+}
+
+void RunReport::add(const PhaseRecord &phase) {
+    lock_guard<mutex> lock(_mutex);
+    _phases.push_back(phase);
+}
+
+/**
+ * Phases in the order they started. A phase can contain others, e.g. the weights of a round
+ */
+std::vector<PhaseRecord> RunReport::phases() const {
+    lock_guard<mutex> lock(_mutex);
+    auto phases = _phases;
+    stable_sort(phases.begin(), phases.end(), [](const PhaseRecord& a, const PhaseRecord& b){
+        return a.start < b.start;
+    });
+    return phases;
+}
+
+/**
+ * Field of the run, e.g. the input file. Setting a key again replaces its value
+ */
+void RunReport::set(const std::string &key, const std::string &value) {
+    lock_guard<mutex> lock(_mutex);
+    for(auto& f : _fields){
+        if(f.first == key){
+            f.second = json_string(value);
+            return;
+        }
+    }
+    _fields.emplace_back(key, json_string(value));
+}
+
+void RunReport::set(const std::string &key, double value) {
+    lock_guard<mutex> lock(_mutex);
+    for(auto& f : _fields){
+        if(f.first == key){
+            f.second = json_number(value);
+            return;
+        }
+    }
+    _fields.emplace_back(key, json_number(value));
+}
+
+void RunReport::write_json(std::ostream &out) const {
+    auto phases = this->phases();
+    vector<pair<string, string>> fields;
+    {
+        lock_guard<mutex> lock(_mutex);
+        fields = _fields;
+    }
+    out << "{\n";
+    for(auto& f : fields){
+        out << "  " << json_string(f.first) << ": " << f.second << ",\n";
+    }
+    out << "  \"wall_seconds\": " << json_number(elapsed()) << ",\n";
+    out << "  \"peak_rss_bytes\": " << peak_rss_bytes() << ",\n";
+    out << "  \"phases\": [";
+    for(size_t i{}; i < phases.size(); ++i){
+        auto& p = phases[i];
+        double rate = p.seconds > 0 ? p.rows / p.seconds : 0;
+        out << (i == 0 ? "\n" : ",\n");
+        out << "    {\"name\": " << json_string(p.name)
+            << ", \"start\": " << json_number(p.start)
+            << ", \"seconds\": " << json_number(p.seconds)
+            << ", \"threads\": " << p.threads
+            << ", \"rows\": " << p.rows
+            << ", \"rows_per_second\": " << json_number(rate)
+            << ", \"bytes_in\": " << p.bytes_in
+            << ", \"bytes_out\": " << p.bytes_out
+            << ", \"weights\": " << p.weights;
+        if(p.flops > 0){
+            out << ", \"flops\": " << p.flops
+                << ", \"gflops\": " << json_number(p.seconds > 0 ? p.flops / p.seconds / 1e9 : 0);
+        }
+        if(perf_counters_enabled()){
+            out << json_perf(p);
+        }
+        out << ", \"peak_rss_bytes\": " << p.peak_rss << "}";
+    }
+    out << (phases.empty() ? "]\n" : "\n  ]\n");
+    out << "}\n";
+}
+
+void RunReport::save(const std::string &filename) const {
+    ofstream fout(filename);
+    if(!fout) throw std::runtime_error("Could not create file " + filename);
+    write_json(fout);
+    fout.close();
+    if(!fout) throw std::runtime_error("Could not write to " + filename);
+}
+
+/**
+ * Report of the process. Started with the first call, i.e. at the start of the program
+ */
+RunReport& run_report(){
+    static RunReport report;
+    return report;
+}
+
+/**
+ * Most resident memory of the process so far
+ */
+size_t peak_rss_bytes(){
+    rusage usage{};
+    if(getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return size_t(usage.ru_maxrss) * 1024; // kilobytes on Linux
+}
+
+PhaseTimer::PhaseTimer(std::string name, int threads) {
+    // counters are opened first, so that opening them is not part of the phase
+    if(perf_counters_enabled()) _perf.reset(new PerfCounters());
+    _t0 = chrono::steady_clock::now();
+    _record.name = std::move(name);
+    _record.threads = threads;
+    _record.start = chrono::duration<double>(_t0 - run_report().start()).count();
+}
+
+PhaseTimer::~PhaseTimer() {
+    stop();
+}
+
+/**
+ * End the phase before the end of the scope. Nothing is recorded afterwards
+ */
+void PhaseTimer::stop() {
+    if(_stopped) return;
+    _stopped = true;
+    if(_perf) _record.perf = _perf->read();
+    _record.seconds = chrono::duration<double>(chrono::steady_clock::now() - _t0).count();
+    _record.peak_rss = peak_rss_bytes();
+    run_report().add(_record);
+}
+
+ReportOnExit::~ReportOnExit() {
+    try {
+        run_report().save(_filename);
+    } catch (std::exception& e) {
+        cerr << e.what() << endl;
+    }
+}
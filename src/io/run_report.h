@@ -0,0 +1,107 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#ifndef CONVOLUTION_RUN_REPORT_H
+#define CONVOLUTION_RUN_REPORT_H
+
+/**
+ * Time and throughput of the phases of a run (parsing, weights, convolution rounds, writing),
+ * collected by scoped timers and written as JSON with `--report`, so that throughput can be
+ * compared across runs by other programs.
+ */
+#include <mutex>
+#include <memory>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <ostream>
+
+#include "perf_counters.h"
+
+struct PhaseRecord{
+    std::string name;
+    double start{};          // seconds since the start of the program
+    double seconds{};
+    int threads{1};
+    size_t rows{};
+    size_t bytes_in{};
+    size_t bytes_out{};
+    size_t weights{};        // binomial weights evaluated. 0 if not counted
+    size_t flops{};          // floating point operations of the kernel. 0 if not counted
+    size_t peak_rss{};       // bytes. most memory the process had used by the end of the phase
+    PerfValues perf;         // hardware counters with `--perf`
+};
+
+/**
+ * Phases of the whole process. Timers of any thread add to it
+ */
+class RunReport{
+    std::chrono::steady_clock::time_point _start;
+    mutable std::mutex _mutex;
+    std::vector<PhaseRecord> _phases;
+    std::vector<std::pair<std::string, std::string>> _fields; // values already in JSON
+public:
+    ~RunReport() = default;
+    RunReport();
+
+    RunReport(const RunReport&) = delete;
+    RunReport& operator=(const RunReport&) = delete;
+
+    double elapsed() const;
+    std::chrono::steady_clock::time_point start() const { return _start;}
+
+    void add(const PhaseRecord& phase);
+    std::vector<PhaseRecord> phases() const;
+
+    void set(const std::string& key, const std::string& value);
+    void set(const std::string& key, double value);
+
+    void write_json(std::ostream& out) const;
+    void save(const std::string& filename) const;
+};
+
+RunReport& run_report();
+size_t peak_rss_bytes();
+
+/**
+ * Measures the time from its construction to its destruction and adds it to `run_report()`.
+ * Reads the hardware counters over the same time if they are enabled, see `set_perf_counters`
+ */
+class PhaseTimer{
+    PhaseRecord _record;
+    std::unique_ptr<PerfCounters> _perf;
+    std::chrono::steady_clock::time_point _t0;
+    bool _stopped{false};
+public:
+    ~PhaseTimer();
+    explicit PhaseTimer(std::string name, int threads=1);
+
+    void stop();
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    void rows(size_t n) { _record.rows += n;}
+    void bytes_in(size_t n) { _record.bytes_in += n;}
+    void bytes_out(size_t n) { _record.bytes_out += n;}
+    void weights(size_t n) { _record.weights += n;}
+    void flops(size_t n) { _record.flops += n;}
+};
+
+/**
+ * Saves `run_report()` to a file when it goes out of scope, whichever way the run ends
+ */
+class ReportOnExit{
+    std::string _filename;
+public:
+    explicit ReportOnExit(std::string filename) : _filename(std::move(filename)) {}
+    ~ReportOnExit();
+
+    ReportOnExit(const ReportOnExit&) = delete;
+    ReportOnExit& operator=(const ReportOnExit&) = delete;
+};
+
+#endif //CONVOLUTION_RUN_REPORT_H
@@ -0,0 +1,189 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#include "stream_io.h"
+#include "compression.h"
+
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <cerrno>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+FileSource::FileSource(const std::string &filename) {
+    if(filename == "-"){
+        _file = stdin;
+        return;
+    }
+    _file = fopen(filename.c_str(), "rb");
+    if(_file == nullptr) throw std::runtime_error("Could not find/open file " + filename);
+    _owned = true;
+}
+
+FileSource::~FileSource() {
+    if(_owned) fclose(_file);
+}
+
+/**
+ * Returns what is available, instead of waiting until `size` bytes have arrived through a pipe
+ */
+size_t FileSource::read(char *buffer, size_t size) {
+    while (true){
+        ssize_t n = ::read(fileno(_file), buffer, size);
+        if(n >= 0) return size_t(n);
+        if(errno != EINTR) throw std::runtime_error("Could not read the input");
+    }
+}
+
+FileSink::FileSink(const std::string &filename) : _filename{filename} {
+    if(filename == "-"){
+        _file = stdout;
+    }else{
+        _file = fopen(filename.c_str(), "wb");
+        if(_file == nullptr) throw std::runtime_error("Could not create file " + filename);
+        _owned = true;
+    }
+    struct stat status{};
+    _interactive = fstat(fileno(_file), &status) == 0 && !S_ISREG(status.st_mode);
+}
+
+FileSink::~FileSink() {
+    if(_owned && _file != nullptr) fclose(_file);
+}
+
+void FileSink::write(const char *data, size_t size) {
+    if(fwrite(data, 1, size, _file) != size){
+        throw std::runtime_error("Could not write to " + _filename);
+    }
+}
+
+void FileSink::flush() {
+    if(_interactive && fflush(_file) != 0){
+        throw std::runtime_error("Could not write to " + _filename);
+    }
+}
+
+void FileSink::close() {
+    if(_file == nullptr) return;
+    bool failed = fflush(_file) != 0;
+    if(_owned) failed |= fclose(_file) != 0;
+    _file = nullptr;
+    if(failed) throw std::runtime_error("Could not write to " + _filename);
+}
+
+LineReader::LineReader(ByteSource &source, size_t buffer_size) : _source(source), _buffer(buffer_size) {}
+
+/**
+ * Next line without the new line character.
+ * A line longer than the buffer makes the buffer grow.
+ * @param line : start of the line
+ * @param eol  : end of the line
+ * @return : false at the end of the stream
+ */
+bool LineReader::next(const char *&line, const char *&eol) {
+    while (true){
+        auto nl = (const char*)memchr(_buffer.data() + _begin, '\n', _end - _begin);
+        if(nl != nullptr){
+            line = _buffer.data() + _begin;
+            eol = nl;
+            _begin = size_t(nl - _buffer.data()) + 1;
+            return true;
+        }
+        if(_eof){
+            if(_begin == _end) return false;
+            // last line without a new line character
+            line = _buffer.data() + _begin;
+            eol = _buffer.data() + _end;
+            _begin = _end;
+            return true;
+        }
+        // move the partial line to the front and read more
+        memmove(_buffer.data(), _buffer.data() + _begin, _end - _begin);
+        _end -= _begin;
+        _begin = 0;
+        if(_end == _buffer.size()) _buffer.resize(2 * _buffer.size());
+        size_t n = _source.read(_buffer.data() + _end, _buffer.size() - _end);
+        if(n == 0) _eof = true;
+        _end += n;
+    }
+}
+
+namespace {
+    /**
+     * Bytes that were already read from a source to look at them, followed by the rest of the source
+     */
+    class PrefixedSource : public ByteSource{
+        std::unique_ptr<ByteSource> _source;
+        std::string _prefix;
+        size_t _position{};
+    public:
+        PrefixedSource(std::unique_ptr<ByteSource> source, std::string prefix)
+                : _source(std::move(source)), _prefix(std::move(prefix)) {}
+
+        size_t read(char* buffer, size_t size) override {
+            if(_position < _prefix.size()){
+                size_t n = min(size, _prefix.size() - _position);
+                memcpy(buffer, _prefix.data() + _position, n);
+                _position += n;
+                return n;
+            }
+            return _source->read(buffer, size);
+        }
+    };
+}
+
+/**
+ * Open a file or, for "-", standard input.
+ * gzip and zstd input is detected from the first bytes and decompressed on a separate thread.
+ */
+std::unique_ptr<ByteSource> open_source(const std::string& filename){
+    std::unique_ptr<ByteSource> file(new FileSource(filename));
+    std::string magic(4, '\0');
+    size_t n{};
+    while (n < magic.size()){
+        size_t r = file->read(&magic[n], magic.size() - n);
+        if(r == 0) break;
+        n += r;
+    }
+    magic.resize(n);
+    Codec codec = detect_codec(magic.data(), magic.size());
+    std::unique_ptr<ByteSource> source(new PrefixedSource(std::move(file), std::move(magic)));
+    return decompressing_source(std::move(source), codec);
+}
+
+/**
+ * Create a file or, for "-", use standard output
+ * @param filename    : name of the file
+ * @param compression : codec to compress the output with
+ */
+std::unique_ptr<ByteSink> open_sink(const std::string& filename, const Compression& compression){
+    std::unique_ptr<ByteSink> file(new FileSink(filename));
+    return compressing_sink(std::move(file), compression);
+}
+
+/**
+ * Codec a file is compressed with, from its first bytes. Codec::none for "-" and files that cannot be read
+ */
+Codec file_codec(const std::string& filename){
+    if(filename == "-") return Codec::none;
+    FILE* file = fopen(filename.c_str(), "rb");
+    if(file == nullptr) return Codec::none;
+    char magic[4];
+    size_t n = fread(magic, 1, sizeof(magic), file);
+    fclose(file);
+    return detect_codec(magic, n);
+}
+
+/**
+ * Size of a file in bytes. 0 for "-" and files that do not exist
+ */
+size_t file_size(const std::string& filename){
+    if(filename == "-") return 0;
+    struct stat st{};
+    if(stat(filename.c_str(), &st) != 0) return 0;
+    return size_t(st.st_size);
+}
@@ -0,0 +1,114 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#ifndef CONVOLUTION_STREAM_IO_H
+#define CONVOLUTION_STREAM_IO_H
+
+/**
+ * Sequential byte streams for reading and writing without knowing the size in advance,
+ * e.g. from standard input or to standard output. The name "-" stands for stdin or stdout.
+ */
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdio>
+#include <cstddef>
+
+/**
+ * Source of bytes that can only be read from start to end
+ */
+class ByteSource{
+public:
+    virtual ~ByteSource() = default;
+
+    /**
+     * Read up to `size` bytes.
+     * @return : number of bytes read. 0 only at the end of the stream
+     */
+    virtual size_t read(char* buffer, size_t size) = 0;
+};
+
+/**
+ * Destination of bytes that can only be written from start to end
+ */
+class ByteSink{
+public:
+    virtual ~ByteSink() = default;
+
+    virtual void write(const char* data, size_t size) = 0;
+    void write(const std::string& text) { write(text.data(), text.size());}
+
+    /**
+     * Pass on what is written so far when the destination is read while it is written, e.g. a pipe.
+     * Does nothing otherwise
+     */
+    virtual void flush() {}
+
+    /**
+     * Write everything that is buffered. Nothing can be written after it
+     */
+    virtual void close() = 0;
+};
+
+/**
+ * File or standard input
+ */
+class FileSource : public ByteSource{
+    FILE* _file{nullptr};
+    bool _owned{false};
+public:
+    ~FileSource() override;
+    explicit FileSource(const std::string& filename);
+
+    FileSource(const FileSource&) = delete;
+    FileSource& operator=(const FileSource&) = delete;
+
+    size_t read(char* buffer, size_t size) override;
+};
+
+/**
+ * File or standard output
+ */
+class FileSink : public ByteSink{
+    FILE* _file{nullptr};
+    bool _owned{false};
+    bool _interactive{false};  // pipe or terminal
+    std::string _filename;
+public:
+    ~FileSink() override;
+    explicit FileSink(const std::string& filename);
+
+    FileSink(const FileSink&) = delete;
+    FileSink& operator=(const FileSink&) = delete;
+
+    void write(const char* data, size_t size) override;
+    void flush() override;
+    void close() override;
+};
+
+/**
+ * Splits a byte stream into lines. A line is valid until the next call of `next`.
+ */
+class LineReader{
+    ByteSource& _source;
+    std::vector<char> _buffer;
+    size_t _begin{};  // start of the first line that is not returned yet
+    size_t _end{};    // end of the bytes read into the buffer
+    bool _eof{false};
+public:
+    ~LineReader() = default;
+    explicit LineReader(ByteSource& source, size_t buffer_size=size_t(1) << 20);
+
+    bool next(const char*& line, const char*& eol);
+};
+
+enum class Codec;
+struct Compression;
+
+std::unique_ptr<ByteSource> open_source(const std::string& filename);
+std::unique_ptr<ByteSink> open_sink(const std::string& filename, const Compression& compression);
+Codec file_codec(const std::string& filename);
+size_t file_size(const std::string& filename);
+
+#endif //CONVOLUTION_STREAM_IO_H
@@ -0,0 +1,167 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#include "synthetic_data.h"
+#include "text_formatter.h"
+#include "stream_io.h"
+
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+    const double PC = 0.592746;         // site percolation threshold of the square lattice
+    const double NU = 4.0 / 3.0;        // correlation length exponent
+    const double GAMMA = 43.0 / 18.0;   // susceptibility exponent
+
+    /**
+     * Observable of a column after the p column. Kinds repeat for more columns
+     */
+    enum class Observable{
+        empty_fraction,     // 1 - p
+        entropy,            // falls from ln(L^2) to 0 through pc
+        spanning,           // sigmoid from 0 to 1 at pc
+        susceptibility      // peak at pc
+    };
+
+    Observable observable_of(size_t column){
+        if(column == 1) return Observable::empty_fraction;
+        switch ((column - 2) % 3){
+            case 0: return Observable::entropy;
+            case 1: return Observable::spanning;
+            default: return Observable::susceptibility;
+        }
+    }
+
+    /**
+     * splitmix64, to get independent random numbers for every value from its position alone
+     */
+    uint64_t mix(uint64_t x){
+        x += 0x9e3779b97f4a7c15ULL;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    /**
+     * Standard normal number of a value, by the Box-Muller transform
+     */
+    double gaussian(uint64_t seed, size_t row, size_t column){
+        uint64_t a = mix(seed ^ mix(uint64_t(row) * 0x100000001b3ULL + column));
+        uint64_t b = mix(a);
+        double u1 = (double(a >> 11) + 1) * 0x1.0p-53;  // (0, 1]
+        double u2 = double(b >> 11) * 0x1.0p-53;        // [0, 1)
+        return sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+    }
+}
+
+/**
+ * Names of the columns, as in the comment line of the files of the simulation
+ */
+std::vector<std::string> synthetic_column_names(size_t columns){
+    vector<string> names;
+    for(size_t c{}; c < columns; ++c){
+        if(c == 0){
+            names.emplace_back("p");
+            continue;
+        }
+        size_t repeat = c < 2 ? 0 : (c - 2) / 3;
+        string suffix = repeat == 0 ? "" : to_string(repeat + 1);
+        switch (observable_of(c)){
+            case Observable::empty_fraction: names.push_back("H(p,L)"); break;
+            case Observable::entropy:        names.push_back("P" + suffix + "(p,L)"); break;
+            case Observable::spanning:       names.push_back("C" + suffix + "(p,L)"); break;
+            case Observable::susceptibility: names.push_back("X" + suffix + "(p,L)"); break;
+        }
+    }
+    return names;
+}
+
+/**
+ * Value of a row and column. p runs from 1/rows to 1 in the first column.
+ * Observables depend on p through the scaling variable x = (p - pc) L^(1/nu), and columns of
+ * the same kind get a slightly different pc each so that they are not copies of each other
+ */
+double synthetic_value(const SyntheticData& spec, size_t row, size_t column){
+    double p = double(row + 1) / double(spec.rows);
+    if(column == 0) return p;
+    double L = spec.length;
+    size_t repeat = column < 2 ? 0 : (column - 2) / 3;
+    double pc = PC + 0.01 * double(repeat);
+    double x = (p - pc) * pow(L, 1 / NU);
+    double spanning = 1 / (1 + exp(-x / 0.9));
+    double noise = spec.noise * gaussian(spec.seed, row, column) / sqrt(double(max(1u, spec.ensemble_size)));
+
+    switch (observable_of(column)){
+        case Observable::empty_fraction:
+            return 1 - p;
+        case Observable::entropy:
+            return max(0.0, log(L * L) * (1 - 0.5 * p) * (1 - spanning) * (1 + noise));
+        case Observable::spanning:
+            // binomial noise of the fraction of spanning samples
+            return min(1.0, max(0.0, spanning + sqrt(spanning * (1 - spanning)) * noise));
+        case Observable::susceptibility: {
+            double peak = 0.0045 * pow(L, GAMMA / NU) * exp(-x * x / 2);
+            return max(0.0, (3 * (1 - p) + peak) * (1 + 3 * noise));
+        }
+    }
+    return 0;
+}
+
+/**
+ * Header and comment lines in the format of the files of the simulation
+ */
+std::string synthetic_header(const SyntheticData& spec){
+    ostringstream oss;
+    string names;
+    for(auto& name : synthetic_column_names(spec.columns)){
+        names += (names.empty() ? "#<" : string(1, spec.delimiter) + "<") + name + ">";
+    }
+    if(spec.header == "json"){
+        oss << "{\"length\":" << spec.length << ",\"ensemble_size\":" << spec.ensemble_size << "}" << '\n';
+        oss << names << '\n';
+        oss << "#Synthetic percolation data. seed " << spec.seed << '\n';
+    }else if(spec.header == "raw"){
+        oss << names << '\n';
+        oss << "#Synthetic percolation data. seed " << spec.seed << '\n';
+        oss << "BEGIN_HEADER" << '\n';
+        oss << "length\t" << spec.length << '\n';
+        oss << "ensemble_size\t" << spec.ensemble_size << '\n';
+        oss << "data_line\t" << 8 << '\n';
+        oss << "END_HEADER" << '\n';
+    }else if(spec.header == "none"){
+        oss << names << '\n';
+    }else{
+        throw std::invalid_argument("unknown header " + spec.header + ". use json, raw or none");
+    }
+    return oss.str();
+}
+
+/**
+ * Write a synthetic data file. Values are written with the shortest text that reads back the same
+ * @param filename     : name of the file. "-" for standard output
+ * @param spec         : size and shape of the data
+ * @param thread_count : number of threads that format rows
+ * @param compression  : codec to compress the file with
+ */
+void write_synthetic_data(const std::string& filename, const SyntheticData& spec, int thread_count,
+                          const Compression& compression){
+    if(spec.columns < 1) throw std::invalid_argument("at least one column is needed");
+    auto header = synthetic_header(spec);
+    auto out = open_sink(filename, compression);
+    out->write(header);
+    TextFormatter formatter(-1);
+    size_t max_row_chars = spec.columns * (formatter.max_chars() + 1);
+    write_row_blocks(*out, spec.rows, max_row_chars, thread_count, [&](size_t row, char* p){
+        for(size_t c{}; c < spec.columns; ++c){
+            if(c > 0) *p++ = spec.delimiter;
+            p = formatter.write(p, synthetic_value(spec, row, c));
+        }
+        *p++ = '\n';
+        return p;
+    });
+    out->close();
+}
@@ -0,0 +1,39 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#ifndef CONVOLUTION_SYNTHETIC_DATA_H
+#define CONVOLUTION_SYNTHETIC_DATA_H
+
+/**
+ * Deterministic data files that look like the output of a percolation simulation, for workloads
+ * of any size: the occupation probability p in the first column followed by observables near the
+ * threshold pc of site percolation on the square lattice, with the statistical noise of an ensemble.
+ * Every value depends only on the seed, its row and its column, so files are the same for any
+ * number of threads, and on any platform since the random numbers do not use the standard distributions.
+ */
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "compression.h"
+
+struct SyntheticData{
+    size_t rows{10000};
+    size_t columns{5};               // including the p column
+    unsigned length{100};            // linear size L of the lattice
+    unsigned ensemble_size{10000};   // sets the noise, which falls as 1/sqrt(ensemble_size)
+    uint64_t seed{1};
+    double noise{1};                 // scale of the noise. 0 gives smooth curves
+    std::string header{"json"};      // "json", "raw" (BEGIN_HEADER ... END_HEADER) or "none"
+    char delimiter{'\t'};
+};
+
+std::vector<std::string> synthetic_column_names(size_t columns);
+double synthetic_value(const SyntheticData& spec, size_t row, size_t column);
+std::string synthetic_header(const SyntheticData& spec);
+void write_synthetic_data(const std::string& filename, const SyntheticData& spec, int thread_count=1,
+                          const Compression& compression=Compression());
+
+#endif //CONVOLUTION_SYNTHETIC_DATA_H
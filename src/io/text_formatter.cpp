@@ -0,0 +1,24 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#include "text_formatter.h"
+
+#include <charconv>
+
+using namespace std;
+
+/**
+ * Write `value` at `first`. At most `max_chars()` characters are written.
+ * @param first : where to write
+ * @param value : value to write
+ * @return : end of the written text
+ */
+char* TextFormatter::write(char* first, double value) const {
+    char* last = first + max_chars();
+    if(_precision < 0){
+        return to_chars(first, last, value).ptr;
+    }
+    // same as the default floatfield of ostream, i.e. printf("%.*g")
+    return to_chars(first, last, value, chars_format::general, _precision).ptr;
+}
@@ -0,0 +1,76 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#ifndef CONVOLUTION_TEXT_FORMATTER_H
+#define CONVOLUTION_TEXT_FORMATTER_H
+
+/**
+ * Floating point to text conversion for the text output files.
+ * Values are formatted with std::to_chars (Ryu based in libstdc++) straight into a buffer,
+ * which is many times faster than formatting through an ostream and gives exactly the
+ * same characters as `ostream << setprecision(precision)`.
+ */
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+
+#include "stream_io.h"
+#include "../parallel/parallel.h"
+#include "trace.h"
+
+class TextFormatter{
+    int _precision;
+public:
+    /**
+     * @param precision : number of significant digits as in `setprecision`.
+     *                    negative value gives the shortest text that reads back to the same value
+     */
+    explicit TextFormatter(int precision) : _precision{precision} {}
+
+    int precision() const { return _precision;}
+    size_t max_chars() const { return size_t(std::max(_precision, 17)) + 16;}
+
+    char* write(char* first, double value) const;
+};
+
+/**
+ * Formats rows in blocks and writes the blocks in order with one write call each.
+ * With more than one thread, `thread_count` blocks are formatted at the same time and then
+ * written one after another, so the output is the same for any number of threads.
+ * @param out           : output
+ * @param n_rows        : number of rows
+ * @param max_row_chars : upper bound of the number of characters of a row
+ * @param thread_count  : number of threads to format with
+ * @param format_row    : `char* format_row(size_t row, char* first)` writes the row at `first`
+ *                        and returns the end of the row
+ */
+template <typename RowFormatter>
+void write_row_blocks(ByteSink& out, size_t n_rows, size_t max_row_chars, int thread_count,
+                      RowFormatter format_row){
+    const size_t block_chars = size_t(1) << 20;
+    size_t rows_per_block = std::max<size_t>(1, block_chars / max_row_chars);
+    size_t n_blocks = size_t(std::max(1, thread_count));
+
+    std::vector<std::vector<char>> buffers(n_blocks, std::vector<char>(rows_per_block * max_row_chars));
+    std::vector<size_t> lengths(n_blocks);
+    for(size_t r0{}; r0 < n_rows; r0 += rows_per_block * n_blocks){
+        parallel_for_each(long(n_blocks), int(n_blocks), [&](long b){
+            size_t first = std::min(n_rows, r0 + size_t(b) * rows_per_block);
+            size_t last = std::min(n_rows, first + rows_per_block);
+            TraceScope trace("format block", long(first), long(last));
+            char* p = buffers[b].data();
+            for(size_t r{first}; r < last; ++r){
+                p = format_row(r, p);
+            }
+            lengths[b] = size_t(p - buffers[b].data());
+        });
+        for(size_t b{}; b < n_blocks; ++b){
+            TraceScope trace("write block", long(std::min(n_rows, r0 + b * rows_per_block)),
+                             long(std::min(n_rows, r0 + (b + 1) * rows_per_block)));
+            out.write(buffers[b].data(), lengths[b]);
+        }
+    }
+}
+
+#endif //CONVOLUTION_TEXT_FORMATTER_H
@@ -0,0 +1,135 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#include "trace.h"
+
+#include <mutex>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace trace_detail {
+    std::atomic<bool> enabled{false};
+}
+
+namespace {
+    struct TraceEvent{
+        const char* name;
+        long long begin;  // nanoseconds since the start of the trace
+        long long end;
+        long first;
+        long last;
+    };
+
+    /**
+     * Events of one thread. Only that thread appends to it
+     */
+    struct ThreadTrace{
+        size_t index;
+        vector<TraceEvent> events;
+    };
+
+    const auto trace_start = chrono::steady_clock::now();
+
+    // buffers outlive their threads, so that threads that ended are in the trace as well
+    mutex registry_mutex;
+    vector<unique_ptr<ThreadTrace>> registry;
+
+    ThreadTrace* register_thread(){
+        lock_guard<mutex> lock(registry_mutex);
+        registry.emplace_back(new ThreadTrace{registry.size(), {}});
+        registry.back()->events.reserve(4096);
+        return registry.back().get();
+    }
+
+    thread_local ThreadTrace* local_trace = nullptr;
+}
+
+void set_tracing(bool enabled){
+    trace_detail::enabled = enabled;
+}
+
+/**
+ * Nanoseconds since the start of the program
+ */
+long long trace_clock(){
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - trace_start).count();
+}
+
+/**
+ * Append an event to the buffer of the calling thread. The buffer is registered on the first event
+ */
+void trace_event(const char* name, long long begin, long long end, long first, long last){
+    if(local_trace == nullptr) local_trace = register_thread();
+    local_trace->events.push_back({name, begin, end, first, last});
+}
+
+/**
+ * Write all events as Chrome trace events ("X" events with microsecond timestamps),
+ * one thread id per thread that recorded events.
+ * Must not be called while threads record events.
+ */
+void save_trace(const std::string& filename){
+    ofstream fout(filename);
+    if(!fout) throw std::runtime_error("Could not create file " + filename);
+    lock_guard<mutex> lock(registry_mutex);
+    fout << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    bool first_event = true;
+    auto separator = [&]{
+        fout << (first_event ? "\n" : ",\n");
+        first_event = false;
+    };
+    fout.setf(ios::fixed);
+    fout.precision(3);
+    for(auto& t : registry){
+        separator();
+        fout << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << t->index
+             << ", \"args\": {\"name\": \"thread " << t->index << "\"}}";
+        for(auto& e : t->events){
+            separator();
+            fout << "{\"name\": \"" << e.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << t->index
+                 << ", \"ts\": " << e.begin / 1e3 << ", \"dur\": " << (e.end - e.begin) / 1e3
+                 << ", \"args\": {\"first\": " << e.first << ", \"last\": " << e.last << "}}";
+        }
+    }
+    fout << "\n]}\n";
+    fout.close();
+    if(!fout) throw std::runtime_error("Could not write to " + filename);
+}
+
+/**
+ * Time every thread spent in events of one name, e.g. to see how evenly rows were shared.
+ * Must not be called while threads record events.
+ * @param name  : name of the events
+ * @param since : only events that began at or after this `trace_clock` time
+ * @return : seconds of every thread that recorded events, in the order the threads started tracing
+ */
+std::vector<double> trace_busy_seconds(const char* name, long long since){
+    lock_guard<mutex> lock(registry_mutex);
+    vector<double> seconds(registry.size());
+    for(size_t t{}; t < registry.size(); ++t){
+        for(auto& e : registry[t]->events){
+            if(e.begin >= since && strcmp(e.name, name) == 0) seconds[t] += double(e.end - e.begin) / 1e9;
+        }
+    }
+    return seconds;
+}
+
+TraceOnExit::TraceOnExit(std::string filename) : _filename(std::move(filename)) {
+    set_tracing(true);
+}
+
+TraceOnExit::~TraceOnExit() {
+    set_tracing(false);
+    try {
+        save_trace(_filename);
+    } catch (std::exception& e) {
+        cerr << e.what() << endl;
+    }
+}
@@ -0,0 +1,70 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#ifndef CONVOLUTION_TRACE_H
+#define CONVOLUTION_TRACE_H
+
+/**
+ * Timeline of the work of every thread: row ranges of the convolution, parse blocks and write blocks.
+ * Enabled with `--trace` and saved in the Chrome trace event format, which Perfetto and
+ * chrome://tracing show as one lane per thread, so that threads that wait for others are visible.
+ * Every thread appends to a buffer of its own without locking. When tracing is off a scope
+ * costs one relaxed load of a flag.
+ */
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace trace_detail {
+    extern std::atomic<bool> enabled;
+}
+
+inline bool tracing_enabled() { return trace_detail::enabled.load(std::memory_order_relaxed);}
+
+void set_tracing(bool enabled);
+long long trace_clock();
+void trace_event(const char* name, long long begin, long long end, long first, long last);
+void save_trace(const std::string& filename);
+std::vector<double> trace_busy_seconds(const char* name, long long since=0);
+
+/**
+ * One event from construction to destruction on the calling thread
+ */
+class TraceScope{
+    const char* _name;
+    long _first;
+    long _last;
+    long long _begin{-1};
+public:
+    /**
+     * @param name  : name of the event. must outlive the program, e.g. a string literal
+     * @param first : first row or index of a block, shown with the event
+     * @param last  : one past the last row, shown with the event
+     */
+    explicit TraceScope(const char* name, long first=0, long last=0) : _name{name}, _first{first}, _last{last} {
+        if(tracing_enabled()) _begin = trace_clock();
+    }
+    ~TraceScope() {
+        if(_begin >= 0) trace_event(_name, _begin, trace_clock(), _first, _last);
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+};
+
+/**
+ * Saves the trace to a file when it goes out of scope, whichever way the run ends
+ */
+class TraceOnExit{
+    std::string _filename;
+public:
+    explicit TraceOnExit(std::string filename);
+    ~TraceOnExit();
+
+    TraceOnExit(const TraceOnExit&) = delete;
+    TraceOnExit& operator=(const TraceOnExit&) = delete;
+};
+
+#endif //CONVOLUTION_TRACE_H
@@ -16,6 +16,7 @@
 #include "io/data_writer.h"
 #include "tests/test1.h"
 #include "tests/test2.h"
+#include "tests/test3.h"
 #include "cmd_args.h"
 #include "io/logger.h"
 #include "args/process.h"
@@ -116,8 +117,6 @@ void on_age(int age)
 }
 
 
-Logging* Logging::_instance=nullptr;
-
 /***
  *
  * @param argc
@@ -125,17 +124,19 @@ Logging* Logging::_instance=nullptr;
  * @return
  */
 int main(int argc, char* argv[]) {
+    messages_to_stderr(argc, argv);
     cout << "Convolution of big data" << endl;
 
     auto t0 = std::chrono::system_clock::now();
 
 //    cmd_args(argc, argv);
 //    cmd_args_v2(argc, argv);
-    cmd_args_v3(argc, argv);
+    int status = cmd_args_v3(argc, argv);
 //    test1_convolution();
 //    test2_convolution();
 //      test3_convolution();
 //    test4_convolution();
+//    test3_paths();
 //    test_process(argc, argv);
 
     auto t1 = std::chrono::system_clock::now();
@@ -154,6 +155,6 @@ int main(int argc, char* argv[]) {
 #endif
     cout << "Program finished at " << std::ctime(&end_time) << endl;
     cout << "Total Time elapsed " << elapsed_seconds.count()/60 << " minutes" << endl;
-    return 0;
+    return status;
 }
 
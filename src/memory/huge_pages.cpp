@@ -0,0 +1,152 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#include "huge_pages.h"
+
+#include <new>
+#include <cstdint>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+#include <sys/mman.h>
+
+using namespace std;
+
+namespace {
+    const size_t HUGE_PAGE = size_t(2) << 20;
+
+    HugePageMode mode = HugePageMode::transparent;
+    atomic<size_t> hugetlb_bytes{};
+    atomic<size_t> transparent_bytes{};
+    atomic<size_t> normal_bytes{};
+    atomic<size_t> small_bytes{};
+    atomic<size_t> hugetlb_failures{};
+    atomic<size_t> peak_anon_huge{};
+
+    size_t round_up(size_t bytes){
+        return (bytes + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+    }
+
+    /**
+     * Anonymous mapping of `size` bytes that starts at a huge page boundary,
+     * so that every 2 MB of it can become one huge page
+     */
+    void* map_aligned(size_t size){
+        void* p = mmap(nullptr, size + HUGE_PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(p == MAP_FAILED) return nullptr;
+        auto start = reinterpret_cast<uintptr_t>(p);
+        uintptr_t aligned = (start + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+        if(aligned > start) munmap(p, aligned - start);
+        size_t tail = start + size + HUGE_PAGE - (aligned + size);
+        if(tail > 0) munmap(reinterpret_cast<void*>(aligned + size), tail);
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    /**
+     * AnonHugePages of /proc/self/smaps_rollup in bytes. 0 if not available
+     */
+    size_t anon_huge_pages(){
+        ifstream fin("/proc/self/smaps_rollup");
+        string line;
+        while (getline(fin, line)){
+            if(line.compare(0, 14, "AnonHugePages:") == 0){
+                istringstream iss(line.substr(14));
+                size_t kb{};
+                iss >> kb;
+                return kb * 1024;
+            }
+        }
+        return 0;
+    }
+}
+
+/**
+ * @param name : "off", "thp" or "hugetlb"
+ */
+HugePageMode parse_huge_page_mode(const std::string& name) {
+    if(name == "off") return HugePageMode::off;
+    if(name.empty() || name == "thp") return HugePageMode::transparent;
+    if(name == "hugetlb") return HugePageMode::hugetlb;
+    throw std::invalid_argument("unknown huge page mode " + name + ". use off, thp or hugetlb");
+}
+
+void set_huge_page_mode(HugePageMode selected) {
+    mode = selected;
+}
+
+HugePageMode huge_page_mode() {
+    return mode;
+}
+
+HugePageStats huge_page_stats() {
+    HugePageStats stats;
+    stats.hugetlb_bytes = hugetlb_bytes;
+    stats.transparent_bytes = transparent_bytes;
+    stats.normal_bytes = normal_bytes;
+    stats.small_bytes = small_bytes;
+    stats.hugetlb_failures = hugetlb_failures;
+    stats.anon_huge_bytes = max<size_t>(peak_anon_huge, anon_huge_pages());
+    return stats;
+}
+
+/**
+ * Looks up how much of the process is on transparent huge pages. Called once at the end of a run,
+ * while its weight tables are still allocated, since they are gone when the statistics are printed
+ */
+void sample_huge_pages() {
+    size_t anon = anon_huge_pages();
+    size_t peak = peak_anon_huge;
+    while (anon > peak && !peak_anon_huge.compare_exchange_weak(peak, anon)) {}
+}
+
+void HugePageStats::print(std::ostream &out) const {
+    const double MB = 1 << 20;
+    out << "huge pages : hugetlbfs " << hugetlb_bytes / MB << " MB"
+        << ", transparent " << transparent_bytes / MB << " MB advised (" << anon_huge_bytes / MB << " MB backed)"
+        << ", normal pages " << normal_bytes / MB << " MB";
+    if(hugetlb_failures > 0){
+        out << ", " << hugetlb_failures << " hugetlbfs requests fell back";
+    }
+    out << std::endl;
+}
+
+/**
+ * Allocate `bytes` bytes. Buffers of at least one huge page are mapped on their own
+ * according to `huge_page_mode()`, smaller ones come from operator new.
+ * Must be released with `deallocate_huge` with the same size.
+ */
+void* allocate_huge(size_t bytes) {
+    if(bytes < HUGE_PAGE){
+        small_bytes += bytes;
+        return ::operator new(bytes);
+    }
+    size_t size = round_up(bytes);
+    if(mode == HugePageMode::hugetlb){
+        void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if(p != MAP_FAILED){
+            hugetlb_bytes += size;
+            return p;
+        }
+        ++hugetlb_failures;
+    }
+    void* p = map_aligned(size);
+    if(p == nullptr) throw std::bad_alloc();
+    if(mode != HugePageMode::off && madvise(p, size, MADV_HUGEPAGE) == 0){
+        transparent_bytes += size;
+    }else{
+        normal_bytes += size;
+    }
+    return p;
+}
+
+void deallocate_huge(void* p, size_t bytes) {
+    if(p == nullptr) return;
+    if(bytes < HUGE_PAGE){
+        ::operator delete(p);
+        return;
+    }
+    munmap(p, round_up(bytes));
+}
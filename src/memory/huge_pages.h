@@ -0,0 +1,73 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#ifndef CONVOLUTION_HUGE_PAGES_H
+#define CONVOLUTION_HUGE_PAGES_H
+
+/**
+ * Allocation of large buffers on huge pages. With N of 10^7 to 10^8 rows the weight tables alone
+ * are hundreds of MB, and walking them with 4 KB pages misses the TLB on almost every page.
+ * Buffers of at least one huge page (2 MB) are mapped on their own and either advised for
+ * transparent huge pages (madvise) or taken from hugetlbfs (MAP_HUGETLB), falling back to
+ * normal pages when the system has none. Smaller buffers use operator new.
+ */
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <ostream>
+
+enum class HugePageMode{
+    off,          // normal pages
+    transparent,  // madvise(MADV_HUGEPAGE). the kernel backs the buffer with huge pages when it can
+    hugetlb       // pages from the hugetlbfs pool. transparent when the pool is empty
+};
+
+/**
+ * Bytes allocated since the start of the program, by the kind of pages obtained
+ */
+struct HugePageStats{
+    size_t hugetlb_bytes{};       // on hugetlbfs pages
+    size_t transparent_bytes{};   // advised for transparent huge pages
+    size_t normal_bytes{};        // mapped on their own on normal pages
+    size_t small_bytes{};         // smaller than a huge page, from operator new
+    size_t hugetlb_failures{};    // hugetlbfs requests that fell back
+    size_t anon_huge_bytes{};     // most transparent huge pages the process had (AnonHugePages), seen at
+                                  // the end of the runs and now
+
+    void print(std::ostream& out) const;
+};
+
+HugePageMode parse_huge_page_mode(const std::string& name);
+void set_huge_page_mode(HugePageMode mode);
+HugePageMode huge_page_mode();
+HugePageStats huge_page_stats();
+void sample_huge_pages();
+
+void* allocate_huge(size_t bytes);
+void deallocate_huge(void* p, size_t bytes);
+
+/**
+ * Allocator for std containers that puts large buffers on huge pages
+ */
+template <typename T>
+struct HugePageAllocator{
+    typedef T value_type;
+
+    HugePageAllocator() = default;
+    template <typename U>
+    HugePageAllocator(const HugePageAllocator<U>&) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(allocate_huge(n * sizeof(T)));}
+    void deallocate(T* p, size_t n) { deallocate_huge(p, n * sizeof(T));}
+};
+
+template <typename T, typename U>
+bool operator==(const HugePageAllocator<T>&, const HugePageAllocator<U>&) { return true;}
+template <typename T, typename U>
+bool operator!=(const HugePageAllocator<T>&, const HugePageAllocator<U>&) { return false;}
+
+template <typename T>
+using HugeVector = std::vector<T, HugePageAllocator<T>>;
+
+#endif //CONVOLUTION_HUGE_PAGES_H
@@ -0,0 +1,51 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#include "scratch_arena.h"
+
+#include <atomic>
+
+using namespace std;
+
+namespace {
+    atomic<size_t> next_arena_id{1};
+
+    /**
+     * Last arena the thread asked for its buffer. Ids are never reused, so an arena
+     * at the address of a destroyed one does not find the old buffer
+     */
+    struct LocalBuffer{
+        size_t arena_id{};
+        double* data{nullptr};
+    };
+    thread_local LocalBuffer last_buffer;
+}
+
+ScratchArena::ScratchArena(size_t size) : _size{size}, _id{next_arena_id++} {}
+
+/**
+ * Buffer of the calling thread, allocated by that thread the first time it asks,
+ * so that it is placed on the thread's NUMA node. The same buffer on every later call.
+ * No lock after the first call as long as the thread uses one arena at a time.
+ * @return : `size()` values. contents are left from the previous use
+ */
+double* ScratchArena::local() {
+    if(last_buffer.arena_id != _id){
+        last_buffer.data = acquire();
+        last_buffer.arena_id = _id;
+    }
+    return last_buffer.data;
+}
+
+double* ScratchArena::acquire() {
+    lock_guard<mutex> lock(_mutex);
+    auto id = this_thread::get_id();
+    auto found = _owners.find(id);
+    if(found != _owners.end()) return found->second;
+    // 8 more values so that buffers of different threads never share a cache line
+    _buffers.emplace_back(_size + 8);
+    double* data = _buffers.back().data();
+    _owners[id] = data;
+    return data;
+}
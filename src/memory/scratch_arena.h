@@ -0,0 +1,44 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#ifndef CONVOLUTION_SCRATCH_ARENA_H
+#define CONVOLUTION_SCRATCH_ARENA_H
+
+/**
+ * Work space of the threads of a run, allocated once per thread instead of once per row.
+ * A row of the convolution needs a buffer of one value per column; allocating it for every row
+ * makes all threads contend on the allocator, most of all for the short rows near p=0 and p=1.
+ */
+#include <mutex>
+#include <deque>
+#include <thread>
+#include <cstddef>
+#include <unordered_map>
+
+#include "huge_pages.h"
+
+class ScratchArena{
+    size_t _size;
+    size_t _id;
+    std::mutex _mutex;
+    std::deque<HugeVector<double>> _buffers;
+    std::unordered_map<std::thread::id, double*> _owners;
+
+    double* acquire();
+public:
+    ~ScratchArena() = default;
+    /**
+     * @param size : number of values of the buffer of each thread
+     */
+    explicit ScratchArena(size_t size);
+
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+    size_t size() const { return _size;}
+
+    double* local();
+};
+
+#endif //CONVOLUTION_SCRATCH_ARENA_H
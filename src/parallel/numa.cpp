@@ -0,0 +1,199 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#include "numa.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+#include <thread>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+using namespace std;
+
+namespace {
+    NumaPolicy policy = NumaPolicy::off;
+
+    /**
+     * Cpus of a list like "0-3,8-11"
+     */
+    vector<int> parse_cpu_list(const string& list){
+        vector<int> cpus;
+        stringstream ss(list);
+        string item;
+        while (getline(ss, item, ',')){
+            if(item.empty() || !isdigit((unsigned char)item[0])) continue;
+            auto dash = item.find('-');
+            int first = stoi(item.substr(0, dash));
+            int last = dash == string::npos ? first : stoi(item.substr(dash + 1));
+            for(int c{first}; c <= last; ++c) cpus.push_back(c);
+        }
+        return cpus;
+    }
+
+    /**
+     * Cpus this process may run on
+     */
+    vector<int> allowed_cpus(){
+        vector<int> cpus;
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if(sched_getaffinity(0, sizeof(set), &set) == 0){
+            for(int c{}; c < CPU_SETSIZE; ++c){
+                if(CPU_ISSET(c, &set)) cpus.push_back(c);
+            }
+        }
+#endif
+        if(cpus.empty()){
+            for(int c{}; c < int(max(1u, thread::hardware_concurrency())); ++c) cpus.push_back(c);
+        }
+        return cpus;
+    }
+}
+
+/**
+ * Reads the nodes from /sys/devices/system/node. Cpus the process may not run on are left out
+ */
+NumaTopology::NumaTopology() {
+    vector<int> allowed = allowed_cpus();
+    for(int node{}; ; ++node){
+        ifstream fin("/sys/devices/system/node/node" + to_string(node) + "/cpulist");
+        if(!fin) break;
+        string list;
+        getline(fin, list);
+        vector<int> cpus;
+        for(int c : parse_cpu_list(list)){
+            if(find(allowed.begin(), allowed.end(), c) != allowed.end()) cpus.push_back(c);
+        }
+        if(!cpus.empty()) _node_cpus.push_back(cpus);
+    }
+    if(_node_cpus.empty()){
+        _node_cpus.push_back(allowed);
+    }
+    for(size_t n{}; n < _node_cpus.size(); ++n){
+        for(int c : _node_cpus[n]){
+            if(c >= int(_cpu_node.size())) _cpu_node.resize(c + 1, -1);
+            _cpu_node[c] = int(n);
+        }
+    }
+}
+
+/**
+ * Topology of this machine, read once
+ */
+const NumaTopology& NumaTopology::system() {
+    static NumaTopology topology;
+    return topology;
+}
+
+int NumaTopology::node_of_cpu(int cpu) const {
+    if(cpu < 0 || cpu >= int(_cpu_node.size())) return -1;
+    return _cpu_node[cpu];
+}
+
+/**
+ * @param name : "off", "first-touch" or "replicate"
+ */
+NumaPolicy parse_numa_policy(const std::string& name) {
+    if(name.empty() || name == "off") return NumaPolicy::off;
+    if(name == "first-touch") return NumaPolicy::first_touch;
+    if(name == "replicate") return NumaPolicy::replicate;
+    throw std::invalid_argument("unknown numa policy " + name + ". use off, first-touch or replicate");
+}
+
+/**
+ * @param name : "none", "compact" or "spread"
+ */
+PinMode parse_pin_mode(const std::string& name) {
+    if(name.empty() || name == "none") return PinMode::none;
+    if(name == "compact") return PinMode::compact;
+    if(name == "spread") return PinMode::spread;
+    throw std::invalid_argument("unknown pinning " + name + ". use none, compact or spread");
+}
+
+void set_numa_policy(NumaPolicy selected) {
+    policy = selected;
+}
+
+NumaPolicy numa_policy() {
+    return policy;
+}
+
+/**
+ * Cpu of every thread for a pinning mode. More threads than cpus wrap around
+ * @param mode    : see `PinMode`
+ * @param threads : number of threads
+ * @return : cpu of thread i at index i. empty for `PinMode::none`
+ */
+std::vector<int> pin_order(PinMode mode, size_t threads) {
+    if(mode == PinMode::none) return {};
+    const auto& topology = NumaTopology::system();
+    vector<int> order;
+    if(mode == PinMode::compact){
+        for(size_t n{}; n < topology.nodes(); ++n){
+            order.insert(order.end(), topology.cpus(n).begin(), topology.cpus(n).end());
+        }
+    }else{
+        size_t most{};
+        for(size_t n{}; n < topology.nodes(); ++n){
+            most = max(most, topology.cpus(n).size());
+        }
+        // i-th cpu of every node in turn
+        for(size_t i{}; i < most; ++i){
+            for(size_t n{}; n < topology.nodes(); ++n){
+                if(i < topology.cpus(n).size()) order.push_back(topology.cpus(n)[i]);
+            }
+        }
+    }
+    vector<int> cpus(threads);
+    for(size_t t{}; t < threads; ++t){
+        cpus[t] = order[t % order.size()];
+    }
+    return cpus;
+}
+
+/**
+ * Keep the calling thread on one cpu
+ * @return : false if the system does not allow it
+ */
+bool pin_current_thread(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Keep the calling thread on the cpus of one node
+ * @return : false if the system does not allow it
+ */
+bool pin_current_thread_to_node(size_t node) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for(int c : NumaTopology::system().cpus(node)) CPU_SET(c, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+/**
+ * Node of the cpu the calling thread runs on. 0 if not known
+ */
+size_t current_numa_node() {
+#ifdef __linux__
+    int node = NumaTopology::system().node_of_cpu(sched_getcpu());
+    if(node >= 0) return size_t(node);
+#endif
+    return 0;
+}
@@ -0,0 +1,77 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#ifndef CONVOLUTION_NUMA_H
+#define CONVOLUTION_NUMA_H
+
+/**
+ * NUMA placement of the convolution. Memory is placed on the node of the thread that touches it
+ * first, so rows are copied by the threads that later read them (first touch) or copied once per
+ * node (replication), and threads are pinned so that they stay next to their memory.
+ * The topology is read from /sys/devices/system/node. Without it the machine is one node.
+ */
+#include <string>
+#include <vector>
+#include <thread>
+
+enum class NumaPolicy{
+    off,          // input is read wherever the reader put it
+    first_touch,  // input and output rows are allocated by the threads that convolve them
+    replicate     // one copy of the input per node. threads read the copy of their node
+};
+
+enum class PinMode{
+    none,     // threads move freely
+    compact,  // thread i on the i-th cpu, filling one node after another
+    spread    // threads take turns between the nodes
+};
+
+/**
+ * Cpus of every NUMA node
+ */
+class NumaTopology{
+    std::vector<std::vector<int>> _node_cpus;
+    std::vector<int> _cpu_node;  // node of every cpu. -1 if not known
+public:
+    ~NumaTopology() = default;
+    NumaTopology();
+
+    static const NumaTopology& system();
+
+    size_t nodes() const { return _node_cpus.size();}
+    const std::vector<int>& cpus(size_t node) const { return _node_cpus[node];}
+    int node_of_cpu(int cpu) const;
+};
+
+NumaPolicy parse_numa_policy(const std::string& name);
+PinMode parse_pin_mode(const std::string& name);
+
+void set_numa_policy(NumaPolicy policy);
+NumaPolicy numa_policy();
+
+std::vector<int> pin_order(PinMode mode, size_t threads);
+bool pin_current_thread(int cpu);
+bool pin_current_thread_to_node(size_t node);
+size_t current_numa_node();
+
+/**
+ * One copy of `data` per NUMA node, each made by a thread running on that node so that its memory
+ * is placed there. Read it with `copies[current_numa_node()]`.
+ */
+template <typename T>
+std::vector<T> replicate_per_node(const T& data){
+    size_t nodes = NumaTopology::system().nodes();
+    std::vector<T> copies(nodes);
+    std::vector<std::thread> threads;
+    for(size_t n{}; n < nodes; ++n){
+        threads.emplace_back([&, n](){
+            pin_current_thread_to_node(n);
+            copies[n] = data;
+        });
+    }
+    for(auto& t : threads) t.join();
+    return copies;
+}
+
+#endif //CONVOLUTION_NUMA_H
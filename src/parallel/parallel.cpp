@@ -0,0 +1,153 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#include "parallel.h"
+#include "numa.h"
+
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <omp.h>
+
+using namespace std;
+
+namespace {
+    ParallelBackend backend = ParallelBackend::openmp;
+    int pool_threads = 0;           // size of the task pool. all OpenMP threads if not positive
+    vector<int> pool_cpus;          // cpus of the threads of the task pool. not pinned if empty
+    unique_ptr<ThreadPool> pool;
+}
+
+/**
+ * @param name : "omp" or "openmp", "tasks"
+ */
+ParallelBackend parse_parallel_backend(const std::string& name) {
+    if(name == "omp" || name == "openmp") return ParallelBackend::openmp;
+    if(name == "tasks") return ParallelBackend::tasks;
+    throw std::invalid_argument("unknown parallel backend " + name + ". use omp or tasks");
+}
+
+/**
+ * Choose how parallel loops run. Must be called before any parallel work starts.
+ * @param backend : OpenMP loops or tasks on the process-wide pool
+ * @param threads : number of threads of the pool. all OpenMP threads if not positive
+ * @param cpus    : cpu of every thread (see `pin_order`). the first one is left for the calling thread,
+ *                  which is not pinned, since the threads it starts later would inherit a single cpu.
+ *                  with OpenMP, the other threads of a team of `threads` threads are pinned. not pinned if empty
+ */
+void set_parallel_backend(ParallelBackend selected, int threads, const std::vector<int>& cpus) {
+    backend = selected;
+    if(pool && (threads != pool_threads || cpus != pool_cpus)){
+        pool.reset();
+    }
+    pool_threads = threads;
+    pool_cpus = cpus;
+    if(cpus.empty()) return;
+    if(backend == ParallelBackend::openmp){
+        // libgomp keeps the threads of a team for later regions of the same size
+#pragma omp parallel num_threads(max(1, threads))
+        {
+            int t = omp_get_thread_num();
+            if(t > 0) pin_current_thread(cpus[size_t(t) % cpus.size()]);
+        }
+    }
+}
+
+ParallelBackend parallel_backend() {
+    return backend;
+}
+
+/**
+ * The process-wide pool, started on first use
+ */
+ThreadPool& task_pool() {
+    if(!pool){
+        pool.reset(new ThreadPool(pool_threads > 0 ? pool_threads : omp_get_max_threads(), pool_cpus));
+    }
+    return *pool;
+}
+
+/**
+ * Call `body(i)` for i in [0, n), one iteration per task or per OpenMP chunk.
+ * For a few coarse iterations, e.g. one per block of a file.
+ * @param n            : number of iterations
+ * @param thread_count : number of threads to use
+ * @param body         : one iteration
+ */
+void parallel_for_each(long n, int thread_count, const std::function<void(long)>& body) {
+    if(backend == ParallelBackend::tasks){
+        task_pool().parallel_for(0, n, 1, [&](long first, long last){
+            for(long i{first}; i < last; ++i) body(i);
+        });
+        return;
+    }
+    thread_count = max(1, thread_count);
+    exception_ptr error;
+#pragma omp parallel for schedule(dynamic) num_threads(thread_count) if(thread_count > 1)
+    for(long i=0; i < n; ++i){
+        try {
+            body(i);
+        } catch (...) {
+#pragma omp critical
+            if(!error) error = current_exception();
+        }
+    }
+    if(error) rethrow_exception(error);
+}
+
+/**
+ * Call `body(bounds[k], bounds[k+1])` for every range k, e.g. ranges of equal cost from `cost_partition`.
+ * @param bounds       : increasing boundaries of the ranges
+ * @param thread_count : number of threads to use
+ * @param body         : work on a range of indices
+ */
+void parallel_ranges(const std::vector<long>& bounds, int thread_count, const std::function<void(long, long)>& body) {
+    if(backend == ParallelBackend::tasks){
+        task_pool().parallel_ranges(bounds, body, thread_count);
+        return;
+    }
+    long n = long(bounds.size()) - 1;
+    thread_count = max(1, thread_count);
+    exception_ptr error;
+#pragma omp parallel for schedule(dynamic) num_threads(thread_count) if(thread_count > 1)
+    for(long k=0; k < n; ++k){
+        try {
+            if(bounds[k] < bounds[k+1]) body(bounds[k], bounds[k+1]);
+        } catch (...) {
+#pragma omp critical
+            if(!error) error = current_exception();
+        }
+    }
+    if(error) rethrow_exception(error);
+}
+
+/**
+ * Same as `parallel_ranges`, but range k always runs on the same thread for the same bounds and
+ * `thread_count`, instead of on whichever thread is free. For passes that first touch memory which
+ * later passes over the same bounds work on, so that it stays on the NUMA node of that thread.
+ * @param bounds       : increasing boundaries of the ranges
+ * @param thread_count : number of threads to use
+ * @param body         : work on a range of indices
+ */
+void parallel_ranges_static(const std::vector<long>& bounds, int thread_count,
+                            const std::function<void(long, long)>& body) {
+    if(backend == ParallelBackend::tasks){
+        task_pool().parallel_ranges_static(bounds, body, thread_count);
+        return;
+    }
+    long n = long(bounds.size()) - 1;
+    thread_count = max(1, thread_count);
+    exception_ptr error;
+    // libgomp keeps the same threads, in the same order, for regions of the same size
+#pragma omp parallel for schedule(static) num_threads(thread_count) if(thread_count > 1)
+    for(long k=0; k < n; ++k){
+        try {
+            if(bounds[k] < bounds[k+1]) body(bounds[k], bounds[k+1]);
+        } catch (...) {
+#pragma omp critical
+            if(!error) error = current_exception();
+        }
+    }
+    if(error) rethrow_exception(error);
+}
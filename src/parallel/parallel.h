@@ -0,0 +1,36 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#ifndef CONVOLUTION_PARALLEL_H
+#define CONVOLUTION_PARALLEL_H
+
+/**
+ * Loops of the kernels, the text parser and the text writer run either as OpenMP loops or as
+ * tasks on one process-wide work-stealing `ThreadPool`, chosen at run time.
+ * On the pool, loops that run inside other parallel work (a parser inside a pipeline stage,
+ * several files at once) share the same threads instead of starting a team each.
+ */
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "thread_pool.h"
+
+enum class ParallelBackend{
+    openmp,
+    tasks
+};
+
+ParallelBackend parse_parallel_backend(const std::string& name);
+void set_parallel_backend(ParallelBackend backend, int threads=0, const std::vector<int>& cpus={});
+ParallelBackend parallel_backend();
+
+ThreadPool& task_pool();
+
+void parallel_for_each(long n, int thread_count, const std::function<void(long)>& body);
+void parallel_ranges(const std::vector<long>& bounds, int thread_count, const std::function<void(long, long)>& body);
+void parallel_ranges_static(const std::vector<long>& bounds, int thread_count,
+                            const std::function<void(long, long)>& body);
+
+#endif //CONVOLUTION_PARALLEL_H
@@ -0,0 +1,113 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#include "partition.h"
+
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+/**
+ * Narrowest panel of columns. The weights are computed again for every panel, and below about
+ * this many columns that costs more than the columns themselves.
+ */
+const size_t MIN_PANEL_WIDTH = 32;
+
+/**
+ * Least work of a tile, in multiply-adds, so that scheduling a tile costs next to nothing
+ */
+const double MIN_TILE_COST = 1 << 14;
+
+/**
+ * Estimated cost of convolving row `row`, in number of input rows visited.
+ * The binomial weights around row `row` fall off like a gaussian of variance N p(1-p), p = row/N,
+ * and the loops stop where the weight relative to the center drops below `threshold`,
+ * i.e. sqrt(2 ln(1/threshold)) standard deviations away on each side.
+ * @param n_rows    : number of rows
+ * @param row       : row
+ * @param threshold : see `convolve_2d_fast`. negative value (full convolution) gives the same cost for all rows
+ * @return : estimated number of input rows, at least 1
+ */
+double row_cost(size_t n_rows, long row, double threshold) {
+    double n = double(n_rows);
+    if(threshold <= 0 || threshold >= 1){
+        return n;
+    }
+    double p = double(row) / n;
+    double sigma = sqrt(n * p * (1 - p));
+    double width = 2 * sigma * sqrt(2 * log(1 / threshold));
+    return min(n, 2 + width); // 2 for the row itself and the one where each loop stops
+}
+
+/**
+ * Split [0, N) into `parts` ranges of about the same cost.
+ * @param prefix_cost : N+1 values. `prefix_cost[i]` is the cost of rows 0 to i-1
+ * @param parts       : number of ranges
+ * @return : `parts`+1 increasing boundaries from 0 to N. range k is [bounds[k], bounds[k+1]).
+ *           ranges are empty if there are fewer rows than parts
+ */
+std::vector<long> balanced_bounds(const std::vector<double>& prefix_cost, size_t parts) {
+    long n_rows = long(prefix_cost.size()) - 1;
+    parts = max<size_t>(1, parts);
+    double total = prefix_cost.back();
+    vector<long> bounds(parts + 1);
+    bounds[0] = 0;
+    for(size_t k{1}; k < parts; ++k){
+        double target = total * double(k) / double(parts);
+        // first row whose prefix reaches the target
+        auto it = lower_bound(prefix_cost.begin(), prefix_cost.end(), target);
+        bounds[k] = max(bounds[k-1], min(n_rows, long(it - prefix_cost.begin())));
+    }
+    bounds[parts] = n_rows;
+    return bounds;
+}
+
+/**
+ * Boundaries of `parts` ranges of rows of about the same cost for a convolution of `n_rows` rows.
+ * The last range ends at `n_rows`, so no rows are left out when `n_rows` is not a multiple of `parts`.
+ * @param n_rows    : number of rows
+ * @param threshold : see `row_cost`
+ * @param parts     : number of ranges
+ * @return : see `balanced_bounds`
+ */
+std::vector<long> cost_partition(size_t n_rows, double threshold, size_t parts) {
+    vector<double> prefix(n_rows + 1);
+    for(size_t i{}; i < n_rows; ++i){
+        prefix[i+1] = prefix[i] + row_cost(n_rows, long(i), threshold);
+    }
+    return balanced_bounds(prefix, parts);
+}
+
+/**
+ * Number of row ranges and column panels for about `tasks` tiles of equal cost.
+ * Tall tables are split by rows only. Tables with fewer rows than tasks, or too little work per row,
+ * are also split into panels of columns, so that short and wide tables keep all threads busy.
+ * @param n_rows    : number of rows
+ * @param n_columns : number of columns
+ * @param threshold : see `row_cost`
+ * @param tasks     : number of tiles wanted, e.g. a few per thread
+ * @return : row ranges (see `cost_partition`) and column panels (see `panel_begin`)
+ */
+Tiles choose_tiles(size_t n_rows, size_t n_columns, double threshold, size_t tasks) {
+    double total{};
+    for(size_t i{}; i < n_rows; ++i){
+        total += row_cost(n_rows, long(i), threshold);
+    }
+    total *= double(n_columns);
+    tasks = max<size_t>(1, min(tasks, size_t(total / MIN_TILE_COST)));
+
+    Tiles tiles;
+    tiles.row_ranges = max<size_t>(1, min(n_rows, tasks));
+    size_t max_panels = max<size_t>(1, n_columns / MIN_PANEL_WIDTH);
+    tiles.column_panels = min(max_panels, (tasks + tiles.row_ranges - 1) / tiles.row_ranges);
+    return tiles;
+}
+
+/**
+ * First column of panel `panel` of `panels` panels of about the same width. `panel_begin(n, panels, panels)` is n
+ */
+size_t panel_begin(size_t n_columns, size_t panels, size_t panel) {
+    return n_columns * panel / panels;
+}
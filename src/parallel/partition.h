@@ -0,0 +1,33 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#ifndef CONVOLUTION_PARTITION_H
+#define CONVOLUTION_PARTITION_H
+
+/**
+ * Splitting the rows of a convolution into chunks of about the same cost.
+ * The cost of a row is the number of input rows its kernel covers. With a threshold that is
+ * about sqrt(N p(1-p)), so rows near p=0.5 cost far more than rows near the ends,
+ * and equal numbers of rows are not equal amounts of work.
+ */
+#include <vector>
+#include <cstddef>
+
+double row_cost(size_t n_rows, long row, double threshold);
+
+std::vector<long> balanced_bounds(const std::vector<double>& prefix_cost, size_t parts);
+std::vector<long> cost_partition(size_t n_rows, double threshold, size_t parts);
+
+/**
+ * Decomposition of a table into tiles of a range of rows by a panel of columns
+ */
+struct Tiles{
+    size_t row_ranges{1};
+    size_t column_panels{1};
+};
+
+Tiles choose_tiles(size_t n_rows, size_t n_columns, double threshold, size_t tasks);
+size_t panel_begin(size_t n_columns, size_t panels, size_t panel);
+
+#endif //CONVOLUTION_PARTITION_H
@@ -0,0 +1,361 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#include "thread_pool.h"
+#include "numa.h"
+
+#include <chrono>
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+    // pool and queue of the worker thread that is running, if any
+    thread_local const ThreadPool* current_pool = nullptr;
+    thread_local size_t current_queue = 0;
+}
+
+/**
+ * @param threads : number of threads that work on a `parallel_for`. The calling thread is one of them,
+ *                  so `threads - 1` threads are started
+ * @param cpus    : cpu of every thread, the calling thread first (see `pin_order`). threads are not pinned if empty
+ */
+ThreadPool::ThreadPool(int threads, std::vector<int> cpus) {
+    size_t n_workers = size_t(max(1, threads) - 1);
+    for(size_t i{}; i <= n_workers; ++i){
+        _queues.emplace_back(new Queue);
+    }
+    for(size_t i{}; i < n_workers; ++i){
+        int cpu = i + 1 < cpus.size() ? cpus[i + 1] : -1;
+        _workers.emplace_back(&ThreadPool::work, this, i, cpu);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lock(_sleep_mutex);
+        _stop = true;
+    }
+    _task_ready.notify_all();
+    for(auto& w : _workers) w.join();
+}
+
+void ThreadPool::work(size_t index, int cpu) {
+    if(cpu >= 0) pin_current_thread(cpu);
+    current_pool = this;
+    current_queue = index;
+    while (true){
+        if(run_pending_task()) continue;
+        unique_lock<mutex> lock(_sleep_mutex);
+        Queue& own = *_queues[index];
+        _task_ready.wait(lock, [&](){ return _stop || _queued > 0 || own.own_queued > 0;});
+        if(_stop && _queued == 0 && own.own_queued == 0) return; // stopped and nothing left to do
+    }
+}
+
+/**
+ * Queue of the calling thread. The shared queue for threads that are not workers of this pool
+ */
+size_t ThreadPool::own_queue() const {
+    return current_pool == this ? current_queue : _queues.size() - 1;
+}
+
+/**
+ * Oldest task given to the calling thread with `submit_to`, otherwise the newest task of the own queue,
+ * otherwise the oldest task of another queue
+ */
+bool ThreadPool::take(std::function<void()>& task) {
+    size_t self = own_queue();
+    if(_queues[self]->own_queued > 0){
+        Queue& q = *_queues[self];
+        lock_guard<mutex> lock(q.mutex);
+        if(!q.own_tasks.empty()){
+            task = std::move(q.own_tasks.front());
+            q.own_tasks.pop_front();
+            --q.own_queued;
+            return true;
+        }
+    }
+    if(_queued == 0) return false;
+    for(size_t k{}; k < _queues.size(); ++k){
+        Queue& q = *_queues[(self + k) % _queues.size()];
+        lock_guard<mutex> lock(q.mutex);
+        if(q.tasks.empty()) continue;
+        if(k == 0){
+            task = std::move(q.tasks.back());
+            q.tasks.pop_back();
+        }else{
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+        }
+        --_queued;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Run `task` on one of the threads of the pool. Without threads it runs right away.
+ */
+void ThreadPool::submit(std::function<void()> task) {
+    if(_workers.empty()){
+        task();
+        return;
+    }
+    {
+        Queue& q = *_queues[own_queue()];
+        lock_guard<mutex> lock(q.mutex);
+        q.tasks.push_back(std::move(task));
+    }
+    {
+        lock_guard<mutex> lock(_sleep_mutex);
+        ++_queued;
+    }
+    _task_ready.notify_one();
+}
+
+/**
+ * Run `task` on the thread `worker` of the pool, when it has finished what it is doing.
+ * Other threads do not steal it. Without threads it runs right away.
+ */
+void ThreadPool::submit_to(size_t worker, std::function<void()> task) {
+    if(_workers.empty()){
+        task();
+        return;
+    }
+    Queue& q = *_queues[worker % _workers.size()];
+    {
+        lock_guard<mutex> lock(q.mutex);
+        q.own_tasks.push_back(std::move(task));
+    }
+    {
+        lock_guard<mutex> lock(_sleep_mutex);
+        ++q.own_queued;
+    }
+    // the sleeping threads cannot be told apart. the others go back to sleep
+    _task_ready.notify_all();
+}
+
+/**
+ * Run one queued task on the calling thread
+ * @return : false if there was nothing to run
+ */
+bool ThreadPool::run_pending_task() {
+    function<void()> task;
+    if(!take(task)) return false;
+    task();
+    return true;
+}
+
+namespace {
+    /**
+     * Shared by the threads of a `parallel_ranges`.
+     * Each thread owns a contiguous run of ranges and takes them from the front. A thread that
+     * runs out takes ranges from the back of the thread with the most ranges left, so only the
+     * tail of the work moves between threads and neighbouring rows stay on one thread.
+     */
+    struct ParallelRanges{
+        struct Owned{
+            std::mutex mutex;
+            long front{}, back{};  // ranges [front, back) are not taken yet
+        };
+        const std::vector<long>& bounds;
+        const std::function<void(long, long)>& body;
+        std::vector<Owned> owned;
+        std::atomic<size_t> next_thread{};
+
+        ParallelRanges(const std::vector<long>& b, const std::function<void(long, long)>& f, size_t threads)
+                : bounds(b), body(f), owned(threads) {
+            long n = long(bounds.size()) - 1;
+            for(size_t t{}; t < threads; ++t){
+                owned[t].front = n * long(t) / long(threads);
+                owned[t].back = n * long(t + 1) / long(threads);
+            }
+        }
+
+        long take_own(size_t t){
+            lock_guard<std::mutex> lock(owned[t].mutex);
+            if(owned[t].front == owned[t].back) return -1;
+            return owned[t].front++;
+        }
+
+        long steal(){
+            while (true){
+                size_t victim{};
+                long most{};
+                for(size_t t{}; t < owned.size(); ++t){
+                    lock_guard<std::mutex> lock(owned[t].mutex);
+                    if(owned[t].back - owned[t].front > most){
+                        most = owned[t].back - owned[t].front;
+                        victim = t;
+                    }
+                }
+                if(most == 0) return -1;
+                lock_guard<std::mutex> lock(owned[victim].mutex);
+                if(owned[victim].front < owned[victim].back) return --owned[victim].back;
+            }
+        }
+
+        void run(){
+            size_t t = next_thread++ % owned.size();
+            while (true){
+                long k = take_own(t);
+                if(k < 0) k = steal();
+                if(k < 0) return;
+                if(bounds[k] < bounds[k+1]) body(bounds[k], bounds[k+1]);
+            }
+        }
+    };
+}
+
+/**
+ * Call `body(first, last)` for consecutive ranges of at most `chunk` indices that cover [begin, end).
+ * Ranges are handed out to the threads of the pool and to the calling thread, which
+ * returns when all of them are done. The first exception thrown by `body` is rethrown here.
+ * @param begin : first index
+ * @param end   : one past the last index
+ * @param chunk : number of indices per call of `body`
+ * @param body  : work on a range of indices
+ */
+void ThreadPool::parallel_for(long begin, long end, long chunk, const std::function<void(long, long)>& body) {
+    if(begin >= end) return;
+    chunk = max(1L, chunk);
+    vector<long> bounds;
+    for(long i{begin}; i < end; i += chunk){
+        bounds.push_back(i);
+    }
+    bounds.push_back(end);
+    parallel_ranges(bounds, body);
+}
+
+/**
+ * Call `body(bounds[k], bounds[k+1])` for every range k, e.g. ranges of equal cost from `cost_partition`.
+ * The threads start on equal shares of consecutive ranges and steal ranges from each other at the end.
+ * Returns when all ranges are done. The first exception thrown by `body` is rethrown here.
+ * @param bounds      : increasing boundaries of the ranges
+ * @param body        : work on a range of indices
+ * @param max_threads : use at most this many threads. all threads of the pool if not positive
+ */
+void ThreadPool::parallel_ranges(const std::vector<long>& bounds, const std::function<void(long, long)>& body,
+                                 int max_threads) {
+    if(bounds.size() < 2) return;
+    long n_ranges = long(bounds.size()) - 1;
+    long threads = min<long>(size(), n_ranges);
+    if(max_threads > 0) threads = min<long>(threads, max_threads);
+    ParallelRanges state(bounds, body, size_t(threads));
+
+    TaskGroup group(*this);
+    for(long i{1}; i < threads; ++i){
+        group.run([&state](){ state.run();});
+    }
+    try {
+        state.run();
+    } catch (...) {
+        group.wait();
+        throw;
+    }
+    group.wait();
+}
+
+/**
+ * Call `body(bounds[k], bounds[k+1])` for every range k, without stealing: the ranges are split in equal
+ * shares of consecutive ranges, and a share always runs on the same thread of the pool for the same bounds,
+ * `max_threads` and calling thread. Memory first touched by a share stays next to the thread that works on
+ * it in later calls with the same bounds. The calling thread takes the first share.
+ * The first exception thrown by `body` is rethrown here.
+ * @param bounds      : increasing boundaries of the ranges
+ * @param body        : work on a range of indices
+ * @param max_threads : use at most this many threads. all threads of the pool if not positive
+ */
+void ThreadPool::parallel_ranges_static(const std::vector<long>& bounds, const std::function<void(long, long)>& body,
+                                        int max_threads) {
+    if(bounds.size() < 2) return;
+    long n_ranges = long(bounds.size()) - 1;
+    // a worker that calls this cannot take a second share
+    size_t caller = current_pool == this ? current_queue : _workers.size();
+    long threads = min<long>(caller < _workers.size() ? size() - 1 : size(), n_ranges);
+    if(max_threads > 0) threads = min<long>(threads, max_threads);
+    threads = max(1L, threads);
+    auto share = [&, threads](long s){
+        for(long k{n_ranges * s / threads}; k < n_ranges * (s + 1) / threads; ++k){
+            if(bounds[k] < bounds[k+1]) body(bounds[k], bounds[k+1]);
+        }
+    };
+
+    TaskGroup group(*this);
+    for(long s{1}; s < threads; ++s){
+        size_t worker = size_t(s - 1);
+        if(worker >= caller) ++worker;
+        group.run_on(worker, [&share, s](){ share(s);});
+    }
+    try {
+        share(0);
+    } catch (...) {
+        group.wait();
+        throw;
+    }
+    group.wait();
+}
+
+TaskGroup::TaskGroup(ThreadPool &pool) : _pool(pool), _state(make_shared<State>()) {}
+
+TaskGroup::~TaskGroup() {
+    try {
+        wait();
+    } catch (...) {
+        // wait() was not called. the exception has nowhere to go
+    }
+}
+
+/**
+ * `task` counted as pending until it has run. Its exception is kept for `wait`
+ */
+std::function<void()> TaskGroup::counted(std::function<void()> task) {
+    ++_state->pending;
+    auto state = _state;
+    return [state, task](){
+        try {
+            task();
+        } catch (...) {
+            lock_guard<mutex> lock(state->mutex);
+            if(!state->error) state->error = current_exception();
+        }
+        if(--state->pending == 0){
+            lock_guard<mutex> lock(state->mutex);
+            state->done.notify_all();
+        }
+    };
+}
+
+/**
+ * Start `task` on the pool. The first exception thrown by a task of the group is rethrown by `wait`.
+ */
+void TaskGroup::run(std::function<void()> task) {
+    _pool.submit(counted(std::move(task)));
+}
+
+/**
+ * Start `task` on the thread `worker` of the pool (see `ThreadPool::submit_to`)
+ */
+void TaskGroup::run_on(size_t worker, std::function<void()> task) {
+    _pool.submit_to(worker, counted(std::move(task)));
+}
+
+/**
+ * Wait for all tasks of the group, running queued tasks of the pool in the meantime
+ */
+void TaskGroup::wait() {
+    while (_state->pending > 0){
+        if(_pool.run_pending_task()) continue;
+        unique_lock<mutex> lock(_state->mutex);
+        // the tasks of the group are running on other threads. they may still start new tasks to help with
+        _state->done.wait_for(lock, chrono::microseconds(200), [&](){ return _state->pending == 0;});
+    }
+    exception_ptr error;
+    {
+        lock_guard<mutex> lock(_state->mutex);
+        swap(error, _state->error);
+    }
+    if(error) rethrow_exception(error);
+}
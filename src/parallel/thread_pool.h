@@ -0,0 +1,95 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#ifndef CONVOLUTION_THREAD_POOL_H
+#define CONVOLUTION_THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <cstddef>
+
+/**
+ * Fixed set of threads that live as long as the pool and run tasks with work stealing.
+ * Every thread has its own deque: tasks it spawns go to the back of it and it takes them from
+ * the back again, while idle threads steal from the front of the others. Tasks from threads
+ * outside the pool go to a shared queue.
+ * Starting the threads once and reusing them for every run avoids paying thread creation
+ * for each call when many small data sets or many rounds are convolved in one process.
+ */
+class ThreadPool{
+    struct Queue{
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+        std::deque<std::function<void()>> own_tasks;  // run by the thread of this queue only, never stolen
+        std::atomic<long> own_queued{};
+    };
+    std::vector<std::thread> _workers;
+    std::vector<std::unique_ptr<Queue>> _queues; // one per worker, then the shared one
+    std::atomic<long> _queued{};                 // tasks in all queues
+    bool _stop{false};
+    std::mutex _sleep_mutex;
+    std::condition_variable _task_ready;
+
+    void work(size_t index, int cpu);
+    size_t own_queue() const;
+    bool take(std::function<void()>& task);
+public:
+    ~ThreadPool();
+    explicit ThreadPool(int threads, std::vector<int> cpus={});
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Number of threads that run a `parallel_for`, including the calling thread
+     */
+    int size() const { return int(_workers.size()) + 1;}
+
+    void submit(std::function<void()> task);
+    void submit_to(size_t worker, std::function<void()> task);
+    bool run_pending_task();
+
+    void parallel_for(long begin, long end, long chunk, const std::function<void(long, long)>& body);
+    void parallel_ranges(const std::vector<long>& bounds, const std::function<void(long, long)>& body,
+                         int max_threads=0);
+    void parallel_ranges_static(const std::vector<long>& bounds, const std::function<void(long, long)>& body,
+                                int max_threads=0);
+};
+
+/**
+ * Fork/join on a `ThreadPool`. Tasks started with `run` may start tasks of their own groups,
+ * and `wait` runs queued tasks instead of blocking, so nested groups never leave a thread idle
+ * and never need more threads than the pool has.
+ */
+class TaskGroup{
+    struct State{
+        std::atomic<long> pending{};
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+    ThreadPool& _pool;
+    std::shared_ptr<State> _state;
+
+    std::function<void()> counted(std::function<void()> task);
+public:
+    ~TaskGroup();
+    explicit TaskGroup(ThreadPool& pool);
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void run(std::function<void()> task);
+    void run_on(size_t worker, std::function<void()> task);
+    void wait();
+};
+
+#endif //CONVOLUTION_THREAD_POOL_H
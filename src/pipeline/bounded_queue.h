@@ -0,0 +1,55 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#ifndef CONVOLUTION_BOUNDED_QUEUE_H
+#define CONVOLUTION_BOUNDED_QUEUE_H
+
+#include <vector>
+#include <cstddef>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * Queue of numbered items that are produced in any order by many threads and consumed in order.
+ * At most `capacity` items can be waiting, so a producer that runs ahead of the consumer blocks
+ * instead of piling up items in memory.
+ */
+template <typename T>
+class OrderedQueue{
+    std::vector<T> _slots;
+    std::vector<bool> _filled;
+    size_t _next{}; // index of the next item to pop
+    std::mutex _mutex;
+    std::condition_variable _changed;
+public:
+    ~OrderedQueue() = default;
+    explicit OrderedQueue(size_t capacity) : _slots(capacity), _filled(capacity, false) {}
+
+    /**
+     * Put item `index`. Blocks until the item fits into the queue.
+     */
+    void push(size_t index, T item){
+        std::unique_lock<std::mutex> lock(_mutex);
+        _changed.wait(lock, [&](){ return index < _next + _slots.size();});
+        _slots[index % _slots.size()] = std::move(item);
+        _filled[index % _slots.size()] = true;
+        _changed.notify_all();
+    }
+
+    /**
+     * Take the next item in order. Blocks until it is pushed.
+     */
+    T pop(){
+        std::unique_lock<std::mutex> lock(_mutex);
+        size_t slot = _next % _slots.size();
+        _changed.wait(lock, [&](){ return bool(_filled[slot]);});
+        T item = std::move(_slots[slot]);
+        _filled[slot] = false;
+        ++_next;
+        _changed.notify_all();
+        return item;
+    }
+};
+
+#endif //CONVOLUTION_BOUNDED_QUEUE_H
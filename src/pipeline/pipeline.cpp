@@ -0,0 +1,352 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#include "pipeline.h"
+#include "bounded_queue.h"
+#include "../convolution/convolution.h"
+#include "../io/data_reader.h"
+#include "../io/data_writer.h"
+#include "../io/text_formatter.h"
+#include "../io/stream_io.h"
+#include "../io/trace.h"
+#include "../parallel/parallel.h"
+#include "../parallel/numa.h"
+#include "../memory/huge_pages.h"
+#include "../include/string_methods.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+    const size_t ROWS_PER_BLOCK = 1024;
+    const size_t PARSE_BLOCK_BYTES = size_t(1) << 20;
+
+    double seconds_since(chrono::steady_clock::time_point start){
+        return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+}
+
+/**
+ * Threads of the process-wide pool so that the stages of a pipeline run on its workers instead of threads
+ * of their own, with `--parallel tasks`: one worker per stage thread, and the calling thread that waits.
+ */
+int pipeline_pool_threads(const PipelineThreads& threads) {
+    return threads.parse + threads.convolve + threads.format + 2;
+}
+
+/**
+ * Thread budget of the stages from a command line value.
+ * @param spec      : "auto" or "<parse>,<convolve>,<format>", e.g. "1,6,1"
+ * @param n_threads : total number of threads split among the stages for "auto"
+ * @return : threads of each stage
+ */
+PipelineThreads pipeline_threads(const std::string& spec, int n_threads){
+    PipelineThreads threads;
+    if(spec == "auto"){
+        n_threads = max(1, n_threads);
+        threads.parse = max(1, n_threads / 4);
+        threads.format = max(1, n_threads / 4);
+        threads.convolve = max(1, n_threads - threads.parse - threads.format);
+        return threads;
+    }
+    auto values = explode_to_int(spec, ',');
+    if(values.size() != 3 || *min_element(values.begin(), values.end()) < 1){
+        throw std::invalid_argument("pipeline threads must be 'auto' or three positive numbers, e.g. 1,6,1");
+    }
+    threads.parse = values[0];
+    threads.convolve = values[1];
+    threads.format = values[2];
+    return threads;
+}
+
+/**
+ * Busy time and utilisation of each stage. Utilisation is the busy time divided by
+ * the wall time of the whole pipeline and the number of threads of the stage.
+ */
+void PipelineStats::print(std::ostream& out) const {
+    out << "pipeline finished in " << wall << " sec" << endl;
+    out << left << setw(10) << "stage" << setw(10) << "threads" << setw(12) << "busy [s]" << "utilisation" << endl;
+    for(auto& s : stages){
+        double utilisation = wall > 0 ? 100 * s.busy / (wall * s.threads) : 0;
+        out << left << setw(10) << s.name << setw(10) << s.threads << setw(12) << s.busy
+            << utilisation << " %" << endl;
+    }
+    out << right;
+}
+
+/**
+ * Convolve columns of a text file and write the result to a text file, with all stages overlapped.
+ * Data is the same as the one `cmd_args_v3` writes with `savetxt_multi`.
+ * @param in_filename : name of the input text file
+ * @param skiprows    : number of rows to be skipped (commented or uncommented)
+ * @param delimiter   : expected delimiter. detected from the first data line if it is not used there
+ * @param a_usecols   : columns that are not convolved. if empty, p = row / rows is written instead
+ * @param b_usecols   : columns that are convolved
+ * @param times       : number of times to perform convolution
+ * @param threshold   : see `convolve_2d_fast`. negative value performs the full convolution
+ * @param output      : output file and how to write it
+ * @param threads     : threads of each stage
+ * @return : time spent by each stage
+ */
+PipelineStats run_pipeline(const std::string& in_filename, int skiprows, char delimiter,
+                           const std::vector<int>& a_usecols,
+                           const std::vector<int>& b_usecols,
+                           int times, double threshold,
+                           const PipelineOutput& output,
+                           const PipelineThreads& threads){
+    auto start = chrono::steady_clock::now();
+    // rows of every block are counted up front, since the weights depend on the number of rows
+    size_t n_parse_blocks = max<size_t>(size_t(threads.parse), file_size(in_filename) / PARSE_BLOCK_BYTES);
+    TextBlockReader reader(in_filename, skiprows, delimiter, '#', n_parse_blocks,
+                           threads.parse + threads.convolve + threads.format);
+    size_t n_rows = reader.rows();
+    if(n_rows == 0){
+        throw std::runtime_error("no data rows in the input file");
+    }
+    times = max(1, times);
+    BinomialKernel kernel(n_rows, threshold);
+
+    // rounds[0] is the input, rounds[times] the output of the last convolution
+    vector<vector<vector<double>>> rounds(times + 1);
+    vector<vector<double>> a_data;
+    for(auto& r : rounds) r.resize(n_rows);
+    vector<const vector<int>*> usecols{&b_usecols};
+    vector<vector<vector<double>>*> parsed{&rounds[0]};
+    if(!a_usecols.empty()){
+        a_data.resize(n_rows);
+        usecols.push_back(&a_usecols);
+        parsed.push_back(&a_data);
+    }
+
+    size_t n_blocks = (n_rows + ROWS_PER_BLOCK - 1) / ROWS_PER_BLOCK;
+    vector<size_t> needed(n_blocks); // rows of the previous round a block of a round depends on
+    // the window of every row of the block, since it is not always widest at the last row
+    parallel_for_each(long(n_blocks), threads.parse + threads.convolve + threads.format, [&](long b){
+        long last{};
+        size_t end = min(n_rows, size_t(b + 1) * ROWS_PER_BLOCK);
+        for(size_t row{size_t(b) * ROWS_PER_BLOCK}; row < end && last < long(n_rows) - 1; ++row){
+            last = max(last, kernel.last_row(long(row)));
+        }
+        needed[b] = size_t(last) + 1;
+    });
+
+    // progress of every stage. guarded by `mutex`
+    mutex mutex;
+    condition_variable changed;
+    vector<bool> parse_done(reader.blocks(), false);
+    size_t parsed_blocks{};
+    vector<size_t> finished_rows(times + 1, 0);   // rows of each round available from the start
+    vector<size_t> next_block(times + 1, 0);      // next block to claim in each round
+    vector<vector<bool>> block_done(times + 1, vector<bool>(n_blocks, false));
+    vector<size_t> done_blocks(times + 1, 0);
+
+    // first exception of any stage. the other stages stop and the writer takes the blocks that are left
+    exception_ptr stage_error;
+    atomic<bool> failed{false};
+    auto fail = [&](exception_ptr error){
+        lock_guard<std::mutex> lock(mutex);
+        if(!stage_error) stage_error = error;
+        failed = true;
+        changed.notify_all();
+    };
+
+    atomic<size_t> next_parse{0};
+    atomic<size_t> next_format{0};
+    vector<double> busy(4, 0);
+    OrderedQueue<string> formatted(size_t(max(2, 2 * threads.format)));
+
+    auto parse_stage = [&](){
+        double my_busy{};
+        size_t b;
+        try {
+            while (!failed && (b = next_parse++) < reader.blocks()){
+                auto t = chrono::steady_clock::now();
+                {
+                    TraceScope trace("parse block", long(reader.first_row(b)), long(reader.first_row(b + 1)));
+                    reader.parse(b, usecols, parsed);
+                }
+                my_busy += seconds_since(t);
+                lock_guard<std::mutex> lock(mutex);
+                parse_done[b] = true;
+                while (parsed_blocks < reader.blocks() && parse_done[parsed_blocks]) ++parsed_blocks;
+                finished_rows[0] = reader.first_row(parsed_blocks);
+                changed.notify_all();
+            }
+        } catch (...) {
+            fail(current_exception());
+        }
+        lock_guard<std::mutex> lock(mutex);
+        busy[0] += my_busy;
+    };
+
+    auto convolve_stage = [&](){
+        double my_busy{};
+        vector<double> sum;
+        unique_lock<std::mutex> lock(mutex);
+        while (!failed){
+            // blocks of later rounds first, so that finished rows reach the output early
+            int round{-1};
+            for(int k{times}; k >= 1; --k){
+                size_t b = next_block[k];
+                if(b < n_blocks && finished_rows[k-1] >= needed[b]){
+                    round = k;
+                    break;
+                }
+            }
+            if(round < 0){
+                bool all_claimed = true;
+                for(int k{1}; k <= times; ++k) all_claimed &= next_block[k] == n_blocks;
+                if(all_claimed) break;
+                changed.wait(lock);
+                continue;
+            }
+            size_t b = next_block[round]++;
+            lock.unlock();
+
+            auto t = chrono::steady_clock::now();
+            size_t last = min(n_rows, (b + 1) * ROWS_PER_BLOCK);
+            try {
+                TraceScope trace("rows", long(b * ROWS_PER_BLOCK), long(last));
+                for(size_t row{b * ROWS_PER_BLOCK}; row < last; ++row){
+                    kernel.convolve_row(rounds[round-1], long(row), sum, rounds[round][row]);
+                }
+            } catch (...) {
+                fail(current_exception());
+            }
+            my_busy += seconds_since(t);
+
+            lock.lock();
+            block_done[round][b] = true;
+            while (done_blocks[round] < n_blocks && block_done[round][done_blocks[round]]) ++done_blocks[round];
+            finished_rows[round] = min(n_rows, done_blocks[round] * ROWS_PER_BLOCK);
+            if(done_blocks[round] == n_blocks && round - 1 >= 1){
+                // an intermediate round is not needed once the next round is done
+                vector<vector<double>>().swap(rounds[round-1]);
+            }
+            changed.notify_all();
+        }
+        busy[1] += my_busy;
+    };
+
+    auto format_stage = [&](){
+        double my_busy{};
+        TextFormatter formatter(output.precision);
+        const auto& b_in = rounds[0];
+        const auto& b_out = rounds[times];
+        size_t b;
+        while ((b = next_format++) < n_blocks){
+            size_t first = b * ROWS_PER_BLOCK;
+            size_t last = min(n_rows, first + ROWS_PER_BLOCK);
+            {
+                unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&](){ return finished_rows[times] >= last || failed;});
+            }
+            auto t = chrono::steady_clock::now();
+            // an empty block after an error, so that the writer can take all of them
+            string text;
+            if(!failed){
+                try {
+                    TraceScope trace("format block", long(first), long(last));
+                    vector<char> line;
+                    for(size_t i{first}; i < last; ++i){
+                        size_t n_a = a_usecols.empty() ? b_in[i].size() : a_data[i].size();
+                        size_t n_b = b_in[i].size();
+                        line.resize((n_a + 2 * n_b) * (formatter.max_chars() + 1) + 1);
+                        char* p = line.data();
+                        for(size_t j{}; j < n_a; ++j){
+                            p = formatter.write(p, a_usecols.empty() ? double(i) / n_rows : a_data[i][j]);
+                            *p++ = reader.delimiter();
+                        }
+                        for(size_t j{}; j < n_b; ++j){
+                            if(output.write_input_data){
+                                p = formatter.write(p, b_in[i][j]);
+                                *p++ = reader.delimiter();
+                            }
+                            p = formatter.write(p, b_out[i][j]);
+                            *p++ = reader.delimiter();
+                        }
+                        *p++ = '\n';
+                        text.append(line.data(), p);
+                    }
+                } catch (...) {
+                    fail(current_exception());
+                    text.clear();
+                }
+            }
+            my_busy += seconds_since(t);
+            formatted.push(b, std::move(text));
+        }
+        lock_guard<std::mutex> lock(mutex);
+        busy[2] += my_busy;
+    };
+
+    auto fout = open_sink(output.filename, output.compression);
+    auto write_stage = [&](){
+        size_t popped{};
+        try {
+            fout->write(text_output_header(output.write_header_and_comment ? reader.header() : "", output.info));
+            for(size_t b{}; b < n_blocks; ++b){
+                string text = formatted.pop();
+                ++popped;
+                if(failed) continue;
+                auto t = chrono::steady_clock::now();
+                {
+                    TraceScope trace("write block", long(b * ROWS_PER_BLOCK), long(min(n_rows, (b + 1) * ROWS_PER_BLOCK)));
+                    fout->write(text);
+                }
+                busy[3] += seconds_since(t);
+            }
+            if(!failed) fout->close();
+        } catch (...) {
+            // keep taking the blocks that are left, so that the other stages can finish
+            fail(current_exception());
+            for(; popped < n_blocks; ++popped) formatted.pop();
+        }
+    };
+
+    vector<function<void()>> stages;
+    for(int i{}; i < threads.parse; ++i) stages.emplace_back(parse_stage);
+    for(int i{}; i < threads.convolve; ++i) stages.emplace_back(convolve_stage);
+    for(int i{}; i < threads.format; ++i) stages.emplace_back(format_stage);
+    stages.emplace_back(write_stage);
+    if(parallel_backend() == ParallelBackend::tasks && size_t(task_pool().size()) > stages.size()){
+        // one worker of the process-wide pool per stage thread, since stages wait for each other.
+        // see `pipeline_pool_threads`
+        TaskGroup group(task_pool());
+        for(size_t i{}; i < stages.size(); ++i) group.run_on(i, stages[i]);
+        group.wait();
+    }else{
+        vector<thread> workers;
+        // every stage thread takes the next cpu
+        for(auto& stage : stages){
+            int cpu = threads.cpus.empty() ? -1 : threads.cpus[workers.size() % threads.cpus.size()];
+            workers.emplace_back([cpu, &stage](){
+                if(cpu >= 0) pin_current_thread(cpu);
+                stage();
+            });
+        }
+        for(auto& w : workers) w.join();
+    }
+    if(stage_error){
+        std::rethrow_exception(stage_error);
+    }
+    sample_huge_pages(); // the kernel is still allocated
+
+    PipelineStats stats;
+    stats.wall = seconds_since(start);
+    stats.stages = {{"parse", threads.parse, busy[0]},
+                    {"convolve", threads.convolve, busy[1]},
+                    {"format", threads.format, busy[2]},
+                    {"write", 1, busy[3]}};
+    return stats;
+}
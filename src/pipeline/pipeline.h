@@ -0,0 +1,74 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#ifndef CONVOLUTION_PIPELINE_H
+#define CONVOLUTION_PIPELINE_H
+
+/**
+ * Pipelined driver for a text file to text file convolution.
+ * Row blocks go through four stages that run at the same time, each with its own threads:
+ *   parse    : blocks of the input file are parsed in any order
+ *   convolve : a block of rows is convolved as soon as every input row of its kernel window is parsed.
+ *              with several rounds, round k works on the rows that round k-1 has finished
+ *   format   : finished rows are formatted to text
+ *   write    : formatted blocks are written in order
+ * Formatted blocks wait in a bounded queue for the writer, so the text in memory stays bounded.
+ * With the task backend the stage threads are workers of the process-wide pool, see `pipeline_pool_threads`.
+ * Output is the same as the one written by `cmd_args_v3` without the pipeline.
+ */
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include "../io/compression.h"
+
+/**
+ * Number of threads of each stage. The write stage always has one thread
+ */
+struct PipelineThreads{
+    int parse{1};
+    int convolve{1};
+    int format{1};
+    std::vector<int> cpus;  // cpu of every stage thread, parse stage first (see `pin_order`). not pinned if empty
+};
+
+PipelineThreads pipeline_threads(const std::string& spec, int n_threads);
+int pipeline_pool_threads(const PipelineThreads& threads);
+
+/**
+ * What to write in the output file
+ */
+struct PipelineOutput{
+    std::string filename;
+    std::string info;                    // written as a comment
+    bool write_header_and_comment{true}; // copy the header and comment lines of the input file
+    bool write_input_data{false};
+    int precision{10};
+    Compression compression;             // codec of the output file
+};
+
+/**
+ * Time spent by each stage
+ */
+struct StageStats{
+    std::string name;
+    int threads{};
+    double busy{};  // seconds, summed over the threads of the stage
+};
+
+struct PipelineStats{
+    double wall{};  // seconds
+    std::vector<StageStats> stages;
+
+    void print(std::ostream& out) const;
+};
+
+PipelineStats run_pipeline(const std::string& in_filename, int skiprows, char delimiter,
+                           const std::vector<int>& a_usecols,
+                           const std::vector<int>& b_usecols,
+                           int times, double threshold,
+                           const PipelineOutput& output,
+                           const PipelineThreads& threads);
+
+#endif //CONVOLUTION_PIPELINE_H
@@ -0,0 +1,149 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#include "stream.h"
+#include "../convolution/sliding_window.h"
+#include "../io/data_reader.h"
+#include "../io/data_writer.h"
+#include "../io/binary_format.h"
+#include "../io/text_formatter.h"
+
+#include <deque>
+#include <memory>
+#include <chrono>
+#include <stdexcept>
+
+using namespace std;
+
+/**
+ * Convolve a text stream and write the result as text while the input is still being read.
+ * The weights depend on the number of rows, so it must be known before the first row can be computed.
+ * It is taken from `n_rows` or else from the "rows" key of the header line of the input.
+ * If neither is given, the whole input is read first.
+ * If the input has more or fewer rows than that, an exception is thrown. The rows written until then
+ * were computed with the weights of a wrong number of rows and are not valid.
+ * Output is the same as the one written by `cmd_args_v3` for the same data in a file.
+ * @param in        : input stream
+ * @param out       : output stream
+ * @param skiprows  : number of rows to be skipped (commented or uncommented)
+ * @param delimiter : expected delimiter. detected from the first data line if it is not used there
+ * @param a_usecols : columns that are not convolved. if empty, p = row / rows is written instead
+ * @param b_usecols : columns that are convolved
+ * @param times     : number of times to perform convolution
+ * @param threshold : see `convolve_2d_fast`. negative value performs the full convolution
+ * @param n_rows    : number of data rows of the input. 0 if not known
+ * @param output    : how to write the output. `output.filename` is not used
+ * @return : rows written and the size of the kernel window kept in memory
+ */
+StreamStats run_stream(ByteSource& in, ByteSink& out, int skiprows, char delimiter,
+                       const std::vector<int>& a_usecols,
+                       const std::vector<int>& b_usecols,
+                       int times, double threshold, size_t n_rows,
+                       const PipelineOutput& output){
+    auto start = chrono::steady_clock::now();
+    times = max(1, times);
+    StreamStats stats;
+
+    LineReader lines(in);
+    TextLineParser parser(skiprows, delimiter);
+    vector<double> a_row, b_row;
+    vector<const vector<int>*> usecols{&b_usecols, &a_usecols};
+    vector<vector<double>*> rows{&b_row, &a_row};
+
+    vector<unique_ptr<SlidingWindowConvolution>> rounds;
+    deque<pair<vector<double>, vector<double>>> pending; // a and b columns of rows not written yet
+    size_t written{};
+    TextFormatter formatter(output.precision);
+    string text;
+    vector<char> line_buffer;
+    bool header_written{false};
+
+    auto write_row = [&](const vector<double>& b_out){
+        if(!header_written){
+            out.write(text_output_header(output.write_header_and_comment ? parser.header() : "", output.info));
+            header_written = true;
+        }
+        auto& a = pending.front().first;
+        auto& b_in = pending.front().second;
+        size_t n_a = a_usecols.empty() ? b_in.size() : a.size();
+        line_buffer.resize((n_a + 2 * b_in.size()) * (formatter.max_chars() + 1) + 1);
+        char* p = line_buffer.data();
+        for(size_t j{}; j < n_a; ++j){
+            p = formatter.write(p, a_usecols.empty() ? double(written) / rounds[0]->rows() : a[j]);
+            *p++ = parser.delimiter();
+        }
+        for(size_t j{}; j < b_in.size(); ++j){
+            if(output.write_input_data){
+                p = formatter.write(p, b_in[j]);
+                *p++ = parser.delimiter();
+            }
+            p = formatter.write(p, b_out[j]);
+            *p++ = parser.delimiter();
+        }
+        *p++ = '\n';
+        text.append(line_buffer.data(), p);
+        pending.pop_front();
+        ++written;
+    };
+
+    // move every row that is ready through the rounds of convolution.
+    // finished rows are passed on at once, so that a reader at the other end of a pipe gets them
+    auto advance = [&](){
+        for(size_t k{}; k < rounds.size(); ++k){
+            while (rounds[k]->ready()){
+                auto row = rounds[k]->pop();
+                if(k + 1 < rounds.size()) rounds[k+1]->push(std::move(row));
+                else write_row(row);
+            }
+        }
+        if(!text.empty()){
+            out.write(text);
+            out.flush();
+            text.clear();
+        }
+    };
+
+    auto start_rounds = [&](size_t n){
+        for(int k{}; k < times; ++k){
+            rounds.emplace_back(new SlidingWindowConvolution(n, threshold));
+        }
+    };
+
+    const char *line, *eol;
+    while (lines.next(line, eol)){
+        if(!parser.parse(line, eol, usecols, rows)) continue;
+        if(rounds.empty()){
+            // header is complete once the data starts
+            if(n_rows == 0){
+                auto header = header_from_text(parser.header());
+                if(header.count("rows")) n_rows = stoull(header["rows"]);
+            }
+            if(n_rows > 0) start_rounds(n_rows);
+        }
+        pending.emplace_back(a_row, b_row);
+        if(!rounds.empty()){
+            rounds[0]->push(b_row);
+            advance();
+        }
+    }
+    if(rounds.empty()){
+        // number of rows was not known. every row is still pending
+        stats.buffered = true;
+        if(pending.empty()) throw std::runtime_error("no data rows in the input");
+        start_rounds(pending.size());
+        for(auto& r : pending) rounds[0]->push(r.second);
+        advance();
+    }
+    if(written != rounds[0]->rows()){
+        throw std::runtime_error("input has " + to_string(rounds[0]->pushed()) + " rows but "
+                                 + to_string(rounds[0]->rows()) + " rows were expected");
+    }
+    out.write(text);
+    out.close();
+
+    stats.rows = written;
+    for(auto& r : rounds) stats.max_window = max(stats.max_window, r->max_window());
+    stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return stats;
+}
@@ -0,0 +1,34 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#ifndef CONVOLUTION_STREAM_H
+#define CONVOLUTION_STREAM_H
+
+/**
+ * Streaming driver, e.g. for `--in -` and `--out -` in a shell pipeline.
+ * Input lines are parsed as they arrive and every output row is written as soon as the kernel
+ * window of every round of convolution is complete, so only about one kernel window of rows
+ * is kept in memory and nothing touches the disk.
+ */
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include "pipeline.h"
+#include "../io/stream_io.h"
+
+struct StreamStats{
+    size_t rows{};
+    size_t max_window{};   // largest number of input rows kept by a round of convolution
+    bool buffered{false};  // number of rows was not known in advance, so the whole input was kept
+    double seconds{};
+};
+
+StreamStats run_stream(ByteSource& in, ByteSink& out, int skiprows, char delimiter,
+                       const std::vector<int>& a_usecols,
+                       const std::vector<int>& b_usecols,
+                       int times, double threshold, size_t n_rows,
+                       const PipelineOutput& output);
+
+#endif //CONVOLUTION_STREAM_H
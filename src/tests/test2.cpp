@@ -7,6 +7,7 @@
 #include "../io/data_reader.h"
 #include "../convolution/convolution.h"
 #include "../io/logger.h"
+#include "../io/synthetic_data.h"
 
 std::vector<double> factorials(size_t N){
     std::vector<double> fact(N+1);
@@ -214,7 +215,14 @@ void test3_convolution(){
 }
 
 void test4_convolution(){
-    string filename="sq_lattice_site_percolation_periodic__400_2018.6.30_7.51.51.txt";
+    // synthetic stand-in for the L=400 simulation output, the same on every machine
+    string filename="synthetic_percolation_L400.txt";
+    SyntheticData spec;
+    spec.length = 400;
+    spec.header = "none";
+    spec.delimiter = ' ';
+    write_synthetic_data(filename, spec);
+//    filename="sq_lattice_site_percolation_periodic__400_2018.6.30_7.51.51.txt";
 //    filename ="sq_lattice_site_percolation_periodic_free-energy_L400_2019-11-13_205909.txt_convoluted.txt_derivative.txt";
 //    filename="sq_lattice_site_percolation_periodic_free-energy_L400_2019-11-13_205909.txt_convoluted.txt_derivative.txt_convoluted.txt";
     auto delimeter = analyze_delimeter(filename, 0, ' ');
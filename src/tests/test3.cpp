@@ -0,0 +1,337 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#include "test3.h"
+#include "../convolution/convolution.h"
+#include "../io/data_reader.h"
+#include "../io/data_writer.h"
+#include "../io/binary_format.h"
+#include "../io/npy_format.h"
+#include "../io/stream_io.h"
+#include "../io/compression.h"
+#include "../io/synthetic_data.h"
+#include "../pipeline/pipeline.h"
+#include "../pipeline/stream.h"
+#include "../parallel/parallel.h"
+#include "../parallel/partition.h"
+#include "../parallel/numa.h"
+
+#include <iostream>
+#include <cstdio>
+#include <cmath>
+
+using namespace std;
+
+namespace {
+    const string INPUT = "test3_input.txt";
+    const double THRESHOLD = 1e-15;
+    const int SKIPROWS = 1; // json header line
+    const vector<int> A_USECOLS{0};
+    const vector<int> B_USECOLS{1, 2, 3};
+
+    SyntheticData test_data(size_t rows, size_t columns){
+        SyntheticData spec;
+        spec.rows = rows;
+        spec.columns = columns;
+        spec.length = 64;
+        spec.seed = 7;
+        return spec;
+    }
+
+    bool check(const string& name, bool ok){
+        cout << name << " : " << (ok ? "ok" : "FAILED") << endl;
+        return ok;
+    }
+
+    /**
+     * Whole contents of a file, decompressed if it is compressed
+     */
+    string read_all(const string& filename){
+        auto source = open_source(filename);
+        string text;
+        vector<char> buffer(1 << 16);
+        size_t n;
+        while ((n = source->read(buffer.data(), buffer.size())) > 0){
+            text.append(buffer.data(), n);
+        }
+        return text;
+    }
+
+    vector<vector<double>> convolve_times(vector<vector<double>> data, int times){
+        for(int i{}; i < times; ++i){
+            data = convolve_2d_fast(data, 1, THRESHOLD);
+        }
+        return data;
+    }
+
+    /**
+     * Text output of the program without pipeline or stream, written to `out_filename`
+     */
+    void reference_output(const string& in_filename, const string& out_filename, int times){
+        TextIngest input = ingest_text(in_filename, A_USECOLS, B_USECOLS, SKIPROWS);
+        auto b_data_out = convolve_times(input.b_data, times);
+        savetxt_multi(input.header, out_filename, "", input.delimiter, false,
+                      input.a_data, input.b_data, b_data_out, 10);
+    }
+
+    /**
+     * Columns in the order they are written to a binary file: a columns, then every b column
+     * followed by its convolved values if `write_input_data`, otherwise only the convolved values
+     */
+    vector<vector<double>> output_rows(const vector<vector<double>>& a_data,
+                                       const vector<vector<double>>& b_data_in,
+                                       const vector<vector<double>>& b_data_out,
+                                       bool write_input_data){
+        vector<vector<double>> rows(a_data.size());
+        for(size_t r{}; r < rows.size(); ++r){
+            rows[r] = a_data[r];
+            for(size_t j{}; j < b_data_in[r].size(); ++j){
+                if(write_input_data) rows[r].push_back(b_data_in[r][j]);
+                rows[r].push_back(b_data_out[r][j]);
+            }
+        }
+        return rows;
+    }
+
+    vector<int> all_columns(size_t n){
+        vector<int> cols(n);
+        for(size_t i{}; i < n; ++i) cols[i] = int(i);
+        return cols;
+    }
+
+    vector<string> names(const string& prefix, size_t n){
+        vector<string> v;
+        for(size_t i{}; i < n; ++i) v.push_back(prefix + to_string(i));
+        return v;
+    }
+
+    /**
+     * Largest difference relative to the largest value. infinite if the shapes differ
+     */
+    double max_difference(const vector<vector<double>>& x, const vector<vector<double>>& y){
+        if(x.size() != y.size()) return INFINITY;
+        double diff{}, scale{};
+        for(size_t r{}; r < x.size(); ++r){
+            if(x[r].size() != y[r].size()) return INFINITY;
+            for(size_t c{}; c < x[r].size(); ++c){
+                diff = max(diff, fabs(x[r][c] - y[r][c]));
+                scale = max(scale, fabs(x[r][c]));
+            }
+        }
+        return scale > 0 ? diff / scale : diff;
+    }
+}
+
+/**
+ * Pipeline output is the same text as the output without it, for a few stage thread counts and rounds
+ */
+bool test_pipeline(){
+    write_synthetic_data(INPUT, test_data(3000, 4));
+    bool ok{true};
+    for(int times{1}; times <= 2; ++times) {
+        reference_output(INPUT, "test3_reference.txt", times);
+        string expected = read_all("test3_reference.txt");
+        for (auto spec : {"1,1,1", "2,3,1"}) {
+            PipelineOutput output;
+            output.filename = "test3_pipeline.txt";
+            run_pipeline(INPUT, SKIPROWS, ' ', A_USECOLS, B_USECOLS, times, THRESHOLD, output,
+                         pipeline_threads(spec, 4));
+            ok &= check("pipeline " + string(spec) + " times " + to_string(times),
+                        read_all(output.filename) == expected);
+        }
+    }
+    remove("test3_reference.txt");
+    remove("test3_pipeline.txt");
+    remove(INPUT.c_str());
+    return ok;
+}
+
+/**
+ * Stream output is the same text as the output without it, with the number of rows known in advance
+ * (rows are written while the input is read) and not known (the input is kept)
+ */
+bool test_stream(){
+    const size_t rows = 3000;
+    write_synthetic_data(INPUT, test_data(rows, 4));
+    bool ok{true};
+    for(int times{1}; times <= 2; ++times) {
+        reference_output(INPUT, "test3_reference.txt", times);
+        string expected = read_all("test3_reference.txt");
+        for (size_t n_rows : {rows, size_t(0)}) {
+            FileSource in(INPUT);
+            FileSink out("test3_stream.txt");
+            PipelineOutput output;
+            auto stats = run_stream(in, out, SKIPROWS, ' ', A_USECOLS, B_USECOLS, times, THRESHOLD, n_rows, output);
+            ok &= check("stream rows " + to_string(n_rows) + " times " + to_string(times),
+                        read_all("test3_stream.txt") == expected && stats.rows == rows
+                        && stats.buffered == (n_rows == 0));
+        }
+    }
+    remove("test3_reference.txt");
+    remove("test3_stream.txt");
+    remove(INPUT.c_str());
+    return ok;
+}
+
+/**
+ * .cbin files give back exactly what was written, in float64, and within float precision in float32
+ */
+bool test_binary_round_trip(){
+    write_synthetic_data(INPUT, test_data(2000, 4));
+    TextIngest input = ingest_text(INPUT, A_USECOLS, B_USECOLS, SKIPROWS);
+    auto b_data_out = convolve_times(input.b_data, 1);
+    auto a_names = names("a", A_USECOLS.size());
+    auto b_names = names("b", B_USECOLS.size());
+    map<string, string> header{{"length", "64"}};
+    bool ok{true};
+    for(bool write_input_data : {false, true}) {
+        auto expected = output_rows(input.a_data, input.b_data, b_data_out, write_input_data);
+        for (bool float32 : {false, true}) {
+            savebin_multi(header, "test3.cbin", a_names, b_names, write_input_data,
+                          input.a_data, input.b_data, b_data_out, float32);
+            BinaryReader reader("test3.cbin");
+            auto data = reader.load(all_columns(reader.columns()));
+            bool same = float32 ? max_difference(expected, data) < 1e-6 : data == expected;
+            ok &= check(string("binary ") + (float32 ? "float32" : "float64") + (write_input_data ? " with input" : ""),
+                        same && reader.header().at("length") == "64" && reader.names()[0] == "a0");
+        }
+    }
+    // convolving what was read back gives the same as convolving the text input
+    savebin_multi(header, "test3.cbin", a_names, b_names, true, input.a_data, input.b_data, b_data_out, false);
+    BinaryReader reader("test3.cbin");
+    auto b_data = reader.load({1, 3, 5});
+    ok &= check("binary input", convolve_times(b_data, 1) == b_data_out);
+    remove("test3.cbin");
+    remove(INPUT.c_str());
+    return ok;
+}
+
+/**
+ * .npy and .npz files give back exactly what was written
+ */
+bool test_npz_round_trip(){
+    write_synthetic_data(INPUT, test_data(2000, 4));
+    TextIngest input = ingest_text(INPUT, A_USECOLS, B_USECOLS, SKIPROWS);
+    auto b_data_out = convolve_times(input.b_data, 1);
+    auto a_names = names("a", A_USECOLS.size());
+    auto b_names = names("b", B_USECOLS.size());
+    bool ok{true};
+    for(bool npz : {false, true}) {
+        string filename = npz ? "test3.npz" : "test3.npy";
+        for (bool write_input_data : {false, true}) {
+            auto expected = output_rows(input.a_data, input.b_data, b_data_out, write_input_data);
+            savenpy_multi(filename, a_names, b_names, write_input_data,
+                          input.a_data, input.b_data, b_data_out, npz);
+            NpyReader reader(filename);
+            auto data = reader.load(all_columns(reader.columns()));
+            bool detected = npz ? is_npz_file(filename) : is_npy_file(filename);
+            ok &= check(filename + (write_input_data ? " with input" : ""), detected && data == expected);
+        }
+        remove(filename.c_str());
+    }
+    remove(INPUT.c_str());
+    return ok;
+}
+
+/**
+ * Compressed input is read as the same data, and compressed output holds the same text
+ */
+bool test_compression(){
+    if(!codec_available(Codec::gzip)){
+        cout << "compression : gzip is not available. skipped" << endl;
+        return true;
+    }
+    auto spec = test_data(60000, 4); // more than one block of the compressed reader
+    write_synthetic_data(INPUT, spec);
+    write_synthetic_data(INPUT + ".gz", spec, 2, parse_compression("gzip"));
+    TextIngest plain = ingest_text(INPUT, A_USECOLS, B_USECOLS, SKIPROWS);
+    TextIngest compressed = ingest_text(INPUT + ".gz", A_USECOLS, B_USECOLS, SKIPROWS);
+    bool ok = check("compressed input",
+                    compressed.a_data == plain.a_data && compressed.b_data == plain.b_data
+                    && compressed.header == plain.header && compressed.delimiter == plain.delimiter);
+
+    auto b_data_out = convolve_times(plain.b_data, 1);
+    savetxt_multi(plain.header, "test3_reference.txt", "", plain.delimiter, false,
+                  plain.a_data, plain.b_data, b_data_out, 10);
+    savetxt_multi(plain.header, "test3_output.txt.gz", "", plain.delimiter, false,
+                  plain.a_data, plain.b_data, b_data_out, 10, 2, parse_compression("gzip"));
+    ok &= check("compressed output", file_codec("test3_output.txt.gz") == Codec::gzip
+                                     && read_all("test3_output.txt.gz") == read_all("test3_reference.txt"));
+    remove("test3_reference.txt");
+    remove("test3_output.txt.gz");
+    remove((INPUT + ".gz").c_str());
+    remove(INPUT.c_str());
+    return ok;
+}
+
+/**
+ * Tiles of rows and column panels give the same values as `convolve_2d_fast`,
+ * for a tall table (row ranges only) and a short and wide one (column panels as well)
+ */
+bool test_tiles(){
+    bool ok{true};
+    for(auto shape : {make_pair(size_t(5000), size_t(4)), make_pair(size_t(8), size_t(8192))}) {
+        auto spec = test_data(shape.first, shape.second);
+        vector<vector<double>> data(spec.rows, vector<double>(spec.columns));
+        for (size_t r{}; r < spec.rows; ++r) {
+            for (size_t c{}; c < spec.columns; ++c) data[r][c] = synthetic_value(spec, r, c);
+        }
+        auto expected = convolve_2d_fast(data, 1, THRESHOLD);
+        for (int threads : {1, 3, 4}) {
+            // the same number of tiles as `Convolution::run_multi_fast`, a few per thread
+            size_t panels = choose_tiles(spec.rows, spec.columns, THRESHOLD, size_t(threads) * 8).column_panels;
+            Convolution convolution(threads);
+            ok &= check("tiles " + to_string(spec.rows) + "x" + to_string(spec.columns) + ", " + to_string(panels)
+                        + " panels, " + to_string(threads) + " threads",
+                        convolution.run_multi_fast(data, THRESHOLD) == expected);
+        }
+    }
+    // otherwise the panels are not tested
+    ok &= check("tiles with panels", choose_tiles(8, 8192, THRESHOLD, 4 * 8).column_panels > 1);
+    return ok;
+}
+
+/**
+ * Every NUMA policy and both parallel backends give the same values as `convolve_2d_fast`
+ */
+bool test_numa_policies(){
+    auto spec = test_data(4000, 4);
+    vector<vector<double>> data(spec.rows, vector<double>(spec.columns));
+    for (size_t r{}; r < spec.rows; ++r) {
+        for (size_t c{}; c < spec.columns; ++c) data[r][c] = synthetic_value(spec, r, c);
+    }
+    auto expected = convolve_2d_fast(data, 1, THRESHOLD);
+    NumaPolicy policy = numa_policy();
+    ParallelBackend backend = parallel_backend();
+    bool ok{true};
+    for(auto backend_name : {"openmp", "tasks"}) {
+        set_parallel_backend(parse_parallel_backend(backend_name), 3);
+        for (auto policy_name : {"off", "first-touch", "replicate"}) {
+            set_numa_policy(parse_numa_policy(policy_name));
+            Convolution convolution(3);
+            ok &= check(string("numa ") + policy_name + " " + backend_name,
+                        convolution.run_multi_fast(data, THRESHOLD) == expected);
+        }
+    }
+    set_numa_policy(policy);
+    set_parallel_backend(backend);
+    return ok;
+}
+
+/**
+ * Runs all the checks above
+ * @return : number of checks that failed
+ */
+int test3_paths(){
+    int failed{};
+    failed += !test_pipeline();
+    failed += !test_stream();
+    failed += !test_binary_round_trip();
+    failed += !test_npz_round_trip();
+    failed += !test_compression();
+    failed += !test_tiles();
+    failed += !test_numa_policies();
+    cout << failed << " of 7 checks failed" << endl;
+    return failed;
+}
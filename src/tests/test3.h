@@ -0,0 +1,25 @@
+//
+// Created by shahnoor on 10/19/26.
+//
+
+#ifndef CONVOLUTION_TEST3_H
+#define CONVOLUTION_TEST3_H
+
+/**
+ * Checks of the pipeline, stream, binary, compression, tiling and NUMA paths.
+ * Each path is run on generated data and compared with `convolve_2d_fast` and `savetxt_multi`,
+ * which give the output of the program without any of these options.
+ * Every check prints its name and "ok" or "FAILED" and returns false when it failed.
+ */
+
+bool test_pipeline();
+bool test_stream();
+bool test_binary_round_trip();
+bool test_npz_round_trip();
+bool test_compression();
+bool test_tiles();
+bool test_numa_policies();
+
+int test3_paths();
+
+#endif //CONVOLUTION_TEST3_H